@@ -0,0 +1,286 @@
+#ifndef _BINARY_IO_HH_
+#define _BINARY_IO_HH_
+
+#include <fstream>
+
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#include <sstream>
+
+#include <stdexcept>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+ * Plain binary files for snapshots of in-memory structures. A file
+ * starts with a format name and a version and holds values, arrays and
+ * strings in host byte order, so files move between machines of the
+ * same endianness only.
+ *
+ * A writer fills filename.tmp and renames it over filename in commit(),
+ * syncing the file before the rename and its directory after, so a
+ * crash while saving leaves either the previous file or the new one,
+ * complete. Both
+ * classes report failures as runtime_errors naming the file. A buffer
+ * takes the same calls as a writer and keeps the bytes in memory, to be
+ * written out later in one piece.
+ */
+namespace binary_io {
+	class buffer {
+		public:
+			typedef size_t size_type;
+
+			/*
+			 * Capacity
+			 */
+			size_type size() const {
+				return contents.size();
+			}
+
+			size_type capacity() const {
+				return contents.capacity();
+			}
+
+			/*
+			 * Element Access
+			 */
+			const char * data() const {
+				return contents.empty() ? NULL : &contents[0];
+			}
+
+			/*
+			 * Modifiers
+			 */
+			template <typename T>
+			void value(const T &data) {
+				static_assert(std::is_trivially_copyable<T>::value, "binary_io writes trivially copyable types only");
+				bytes(&data, sizeof(T));
+			}
+
+			template <typename T>
+			void array(const std::vector<T> &data) {
+				static_assert(std::is_trivially_copyable<T>::value, "binary_io writes trivially copyable types only");
+				value((uint64_t)data.size());
+				if(!data.empty()) {
+					bytes(&data[0], data.size() * sizeof(T));
+				}
+			}
+
+			void text(const std::string &data) {
+				value((uint64_t)data.size());
+				bytes(data.data(), data.size());
+			}
+
+			void bytes(const void *data, size_t length) {
+				const char *source = static_cast<const char *>(data);
+				contents.insert(contents.end(), source, source + length);
+			}
+
+			/* keeps the capacity for the next round */
+			void clear() {
+				contents.clear();
+			}
+
+			void swap(buffer &other) {
+				contents.swap(other.contents);
+			}
+
+		protected:
+			std::vector<char> contents;
+	};
+
+	class writer {
+		public:
+			writer(const std::string &filename, const std::string &format, uint32_t version) : filename(filename), partial(filename + ".tmp"), output(partial.c_str(), std::ios::binary | std::ios::trunc), committed(false) {
+				if(!output) {
+					fail("cannot open for writing");
+				}
+				text(format);
+				value(version);
+			}
+
+			~writer() {
+				if(!committed) {
+					output.close();
+					std::remove(partial.c_str());
+				}
+			}
+
+			writer(const writer &other) = delete;
+			writer & operator=(const writer &other) = delete;
+
+			template <typename T>
+			void value(const T &data) {
+				static_assert(std::is_trivially_copyable<T>::value, "binary_io writes trivially copyable types only");
+				bytes(&data, sizeof(T));
+			}
+
+			template <typename T>
+			void array(const std::vector<T> &data) {
+				static_assert(std::is_trivially_copyable<T>::value, "binary_io writes trivially copyable types only");
+				value((uint64_t)data.size());
+				if(!data.empty()) {
+					bytes(&data[0], data.size() * sizeof(T));
+				}
+			}
+
+			void text(const std::string &data) {
+				value((uint64_t)data.size());
+				bytes(data.data(), data.size());
+			}
+
+			void bytes(const void *data, size_t length) {
+				output.write(static_cast<const char *>(data), (std::streamsize)length);
+				if(!output) {
+					fail("write failed");
+				}
+			}
+
+			/* flushes the file to disk and moves it into place */
+			void commit() {
+				output.close();
+				if(!output) {
+					fail("write failed");
+				}
+				sync(partial, O_RDONLY, "cannot sync file");
+				if(std::rename(partial.c_str(), filename.c_str()) != 0) {
+					fail("cannot replace file");
+				}
+				committed = true;
+
+				/* the rename itself is durable only once the directory is */
+				std::string::size_type slash = filename.rfind('/');
+				std::string directory = slash == std::string::npos ? "." : filename.substr(0, slash == 0 ? 1 : slash);
+				sync(directory, O_RDONLY | O_DIRECTORY, "cannot sync directory");
+			}
+
+		protected:
+			std::string filename;
+			std::string partial;
+			std::ofstream output;
+			bool committed;
+
+			void fail(const char *message) const {
+				std::ostringstream oss;
+				oss << filename << ": " << message;
+
+				throw std::runtime_error(oss.str());
+			}
+
+			void sync(const std::string &path, int flags, const char *message) const {
+				int fd = ::open(path.c_str(), flags);
+				if(fd < 0) {
+					fail(message);
+				}
+				int result;
+				do {
+					result = ::fsync(fd);
+				} while(result != 0 && errno == EINTR);
+				::close(fd);
+				if(result != 0) {
+					fail(message);
+				}
+			}
+	};
+
+	class reader {
+		public:
+			/* checks the format name and returns the version through version */
+			reader(const std::string &filename, const std::string &format, uint32_t &version) : filename(filename), input(filename.c_str(), std::ios::binary) {
+				if(!input) {
+					fail("cannot open for reading");
+				}
+
+				uint64_t length = 0;
+				bytes(&length, sizeof(length));
+				if(length != format.size()) {
+					fail("not a " + format + " file");
+				}
+				std::string found(format.size(), '\0');
+				bytes(&found[0], found.size());
+				if(found != format) {
+					fail("not a " + format + " file");
+				}
+				value(version);
+			}
+
+			reader(const reader &other) = delete;
+			reader & operator=(const reader &other) = delete;
+
+			template <typename T>
+			void value(T &data) {
+				static_assert(std::is_trivially_copyable<T>::value, "binary_io reads trivially copyable types only");
+				bytes(&data, sizeof(T));
+			}
+
+			/* max_size guards against allocating for a corrupt length */
+			template <typename T>
+			void array(std::vector<T> &data, uint64_t max_size=UINT64_MAX) {
+				static_assert(std::is_trivially_copyable<T>::value, "binary_io reads trivially copyable types only");
+				uint64_t length = 0;
+				value(length);
+				if(length > max_size || length > remaining() / sizeof(T)) {
+					fail("array length out of range");
+				}
+				data.resize((size_t)length);
+				if(length != 0) {
+					bytes(&data[0], (size_t)length * sizeof(T));
+				}
+			}
+
+			void text(std::string &data) {
+				uint64_t length = 0;
+				value(length);
+				if(length > remaining()) {
+					fail("string length out of range");
+				}
+				data.resize((size_t)length);
+				if(length != 0) {
+					bytes(&data[0], (size_t)length);
+				}
+			}
+
+			void bytes(void *data, size_t length) {
+				input.read(static_cast<char *>(data), (std::streamsize)length);
+				if((size_t)input.gcount() != length) {
+					fail("unexpected end of file");
+				}
+			}
+
+			/* fails unless the whole file has been read */
+			void finish() {
+				if(input.peek() != std::ifstream::traits_type::eof()) {
+					fail("trailing data");
+				}
+			}
+
+			void fail(const std::string &message) const {
+				std::ostringstream oss;
+				oss << filename << ": " << message;
+
+				throw std::runtime_error(oss.str());
+			}
+
+		protected:
+			std::string filename;
+			std::ifstream input;
+
+			uint64_t remaining() {
+				std::streampos here = input.tellg();
+				input.seekg(0, std::ios::end);
+				std::streampos end = input.tellg();
+				input.seekg(here);
+				return (uint64_t)(end - here);
+			}
+	};
+}
+
+#endif
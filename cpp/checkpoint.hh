@@ -0,0 +1,228 @@
+#ifndef _CHECKPOINT_HH_
+#define _CHECKPOINT_HH_
+
+#include <string>
+#include <memory>
+
+#include <sstream>
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include <stdexcept>
+
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+
+#include "binary_io.hh"
+#include "hashing.hh"
+
+/*
+ * Periodic checkpoints for long-running engines.
+ *
+ * An engine asks due() between units of work; when it is, the engine
+ * serializes its state into state() and calls submit(). The state is
+ * written to the checkpoint file by a background thread while the engine
+ * carries on, and the engine fills the other of the two buffers the next
+ * time, so it only waits if a checkpoint is still being written when the
+ * next one is ready. Each file replaces the previous one by rename, so
+ * the file on disk is always a complete checkpoint.
+ *
+ * A checkpoint starts with the engine's kind and a fingerprint of the
+ * graph, which resume() checks, so that a run never continues from the
+ * state of another engine or another graph. complete() removes the file
+ * once the run has finished.
+ */
+class checkpointer {
+	public:
+		typedef size_t size_type;
+
+		static const uint32_t VERSION = 1;
+
+		/* interval is the least time between checkpoints, in seconds */
+		checkpointer(const std::string &filename, double interval) : filename(filename), interval(interval), last(clock::now()), pending(false), stopping(false), written(0) {
+			writer = std::thread(&checkpointer::work, this);
+		}
+
+		~checkpointer() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+				changed.notify_all();
+			}
+			writer.join();
+		}
+
+		checkpointer(const checkpointer &other) = delete;
+		checkpointer & operator=(const checkpointer &other) = delete;
+
+		/*
+		 * Capacity
+		 */
+
+		/* checkpoints written so far */
+		size_type size_written() const {
+			std::lock_guard<std::mutex> lock(mutex);
+			return written;
+		}
+
+		const std::string & path() const {
+			return filename;
+		}
+
+		/*
+		 * Operations
+		 */
+		bool due() const {
+			return std::chrono::duration<double>(clock::now() - last).count() >= interval;
+		}
+
+		/* the buffer for the next checkpoint, already holding its header */
+		binary_io::buffer & state(const std::string &kind, uint64_t fingerprint) {
+			front.clear();
+			front.text(kind);
+			front.value(fingerprint);
+			return front;
+		}
+
+		/* hands the filled buffer to the background thread */
+		void submit() {
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [this]() { return !pending; });
+			rethrow();
+
+			front.swap(back);
+			pending = true;
+			last = clock::now();
+			changed.notify_all();
+		}
+
+		/* waits until every submitted checkpoint is on disk */
+		void flush() {
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [this]() { return !pending; });
+			rethrow();
+		}
+
+		/*
+		 * Opens the checkpoint for reading if there is one, checking its
+		 * kind and fingerprint. Returns false when there is no file; the
+		 * engine then starts from scratch.
+		 */
+		bool resume(std::unique_ptr<binary_io::reader> &input, const std::string &kind, uint64_t fingerprint) {
+			flush();
+
+			std::FILE *file = std::fopen(filename.c_str(), "rb");
+			if(file == NULL) {
+				return false;
+			}
+			std::fclose(file);
+
+			uint32_t version = 0;
+			input.reset(new binary_io::reader(filename, "checkpoint", version));
+			if(version != VERSION) {
+				std::ostringstream oss;
+				oss << "unsupported checkpoint version " << version;
+				input->fail(oss.str());
+			}
+
+			std::string found;
+			input->text(found);
+			if(found != kind) {
+				input->fail("checkpoint is for " + found + ", not " + kind);
+			}
+
+			uint64_t found_fingerprint = 0;
+			input->value(found_fingerprint);
+			if(found_fingerprint != fingerprint) {
+				input->fail("checkpoint is for a different graph or different settings");
+			}
+			return true;
+		}
+
+		/* the run is over: removes the checkpoint */
+		void complete() {
+			flush();
+			std::remove(filename.c_str());
+		}
+
+		/* structure of a compact_graph or compact_digraph, not its vertex values */
+		template <typename G>
+		static uint64_t fingerprint(const G &graph) {
+			uint64_t hash = hashing::mix(graph.size_vertices());
+			size_type num_arcs = graph.begin_neighbors(graph.size_vertices()) - graph.begin_neighbors(0);
+			if(num_arcs != 0) {
+				hash = hashing::bytes(reinterpret_cast<const char *>(&*graph.begin_neighbors(0)), num_arcs * sizeof(*graph.begin_neighbors(0)), hash);
+			}
+			for(size_type ii = 0; ii < graph.size_vertices(); ii++) {
+				hash = hashing::combine(hash, graph.degree(ii));
+			}
+			return hash;
+		}
+
+	protected:
+		typedef std::chrono::steady_clock clock;
+
+		std::string filename;
+		double interval;
+		clock::time_point last;
+
+		/* the engine fills front while the thread writes back */
+		binary_io::buffer front;
+		binary_io::buffer back;
+
+		mutable std::mutex mutex;
+		std::condition_variable changed;
+		bool pending;
+		bool stopping;
+		size_type written;
+		std::exception_ptr error;
+
+		std::thread writer;
+
+		/* caller holds the mutex */
+		void rethrow() {
+			if(error) {
+				std::exception_ptr current = error;
+				error = std::exception_ptr();
+				std::rethrow_exception(current);
+			}
+		}
+
+		void work() {
+			std::unique_lock<std::mutex> lock(mutex);
+			for(;;) {
+				changed.wait(lock, [this]() { return pending || stopping; });
+				if(!pending) {
+					return;
+				}
+
+				lock.unlock();
+				std::exception_ptr failure;
+				try {
+					binary_io::writer output(filename, "checkpoint", VERSION);
+					output.bytes(back.data(), back.size());
+					output.commit();
+				}
+				catch(...) {
+					failure = std::current_exception();
+				}
+				lock.lock();
+
+				if(failure) {
+					error = failure;
+				}
+				else {
+					written++;
+				}
+				pending = false;
+				changed.notify_all();
+			}
+		}
+};
+
+#endif
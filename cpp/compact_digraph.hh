@@ -0,0 +1,310 @@
+#ifndef _COMPACT_DIGRAPH_HH_
+#define _COMPACT_DIGRAPH_HH_
+
+#include <vector>
+#include <iterator>
+#include <utility>
+
+#include <algorithm>
+#include <numeric>
+
+#include <cstddef>
+
+#include "memory_usage.hh"
+#include "parallel.hh"
+
+/*
+ * Read-only directed graph in adjacency array (CSR) form, with the
+ * successors and the predecessors of every vertex each kept as a sorted
+ * list. Vertices are numbered 0..n-1 in sorted order, as in
+ * compact_graph. Parallel arcs collapse; a self-loop is one arc that
+ * appears in both lists of its vertex.
+ *
+ * undirected() gives the underlying undirected graph by merging the two
+ * lists on the fly, so it needs no storage of its own.
+ */
+template <typename V>
+class compact_digraph {
+	public:
+		typedef size_t size_type;
+		typedef unsigned int index_type;
+
+		typedef V VERTEX;
+		typedef std::pair<V,V> ARC;
+
+		typedef typename std::vector<VERTEX>::const_iterator const_vertex_iterator;
+		typedef typename std::vector<index_type>::const_iterator const_neighbor_iterator;
+
+		enum direction {
+			OUTGOING,
+			INCOMING
+		};
+
+		/* union of two sorted index lists, each index once */
+		class const_merged_iterator {
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef index_type value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef const index_type * pointer;
+				typedef const index_type & reference;
+
+				const_merged_iterator() {
+
+				}
+
+				const_merged_iterator(const_neighbor_iterator first, const_neighbor_iterator first_end, const_neighbor_iterator second, const_neighbor_iterator second_end) : first(first), first_end(first_end), second(second), second_end(second_end) {
+
+				}
+
+				reference operator*() const {
+					if(first == first_end) {
+						return *second;
+					}
+					else if(second == second_end || *first <= *second) {
+						return *first;
+					}
+					return *second;
+				}
+
+				pointer operator->() const {
+					return &**this;
+				}
+
+				const_merged_iterator & operator++() {
+					index_type current = **this;
+					if(first != first_end && *first == current) {
+						++first;
+					}
+					if(second != second_end && *second == current) {
+						++second;
+					}
+					return *this;
+				}
+
+				const_merged_iterator operator++(int) {
+					const_merged_iterator tmp(*this);
+					++(*this);
+					return tmp;
+				}
+
+				bool operator==(const const_merged_iterator &other) const {
+					return first == other.first && second == other.second;
+				}
+
+				bool operator!=(const const_merged_iterator &other) const {
+					return !(*this == other);
+				}
+
+			protected:
+				const_neighbor_iterator first;
+				const_neighbor_iterator first_end;
+				const_neighbor_iterator second;
+				const_neighbor_iterator second_end;
+		};
+
+		/* the graph with arc directions dropped; valid while the digraph is */
+		class undirected_view {
+			public:
+				typedef typename compact_digraph::size_type size_type;
+				typedef typename compact_digraph::index_type index_type;
+				typedef typename compact_digraph::const_merged_iterator const_neighbor_iterator;
+
+				explicit undirected_view(const compact_digraph &digraph) : digraph(digraph) {
+
+				}
+
+				const_vertex_iterator begin_vertices() const {
+					return digraph.begin_vertices();
+				}
+
+				const_vertex_iterator end_vertices() const {
+					return digraph.end_vertices();
+				}
+
+				const_neighbor_iterator begin_neighbors(size_type vertex) const {
+					return const_neighbor_iterator(digraph.begin_neighbors(vertex, OUTGOING), digraph.end_neighbors(vertex, OUTGOING), digraph.begin_neighbors(vertex, INCOMING), digraph.end_neighbors(vertex, INCOMING));
+				}
+
+				const_neighbor_iterator end_neighbors(size_type vertex) const {
+					return const_neighbor_iterator(digraph.end_neighbors(vertex, OUTGOING), digraph.end_neighbors(vertex, OUTGOING), digraph.end_neighbors(vertex, INCOMING), digraph.end_neighbors(vertex, INCOMING));
+				}
+
+				size_type size_vertices() const {
+					return digraph.size_vertices();
+				}
+
+				size_type size_edges() const {
+					return digraph.size_arcs() - digraph.size_reciprocal();
+				}
+
+				/* linear in the number of arcs at the vertex */
+				size_type degree(size_type vertex) const {
+					return (size_type)std::distance(begin_neighbors(vertex), end_neighbors(vertex));
+				}
+
+				const VERTEX & vertex(size_type vertex) const {
+					return digraph.vertex(vertex);
+				}
+
+				size_type index(const VERTEX &vertex) const {
+					return digraph.index(vertex);
+				}
+
+				bool has_edge(size_type src, size_type dst) const {
+					return digraph.has_arc(src, dst) || digraph.has_arc(dst, src);
+				}
+
+			protected:
+				const compact_digraph &digraph;
+		};
+
+		compact_digraph() : out_offsets(1, 0), in_offsets(1, 0), reciprocal(0) {
+
+		}
+
+		/*
+		 * Adopts prebuilt arrays. vertices must be sorted, every neighbor
+		 * list sorted without repeats, and in_neighbors the transpose of
+		 * out_neighbors.
+		 */
+		void assign(std::vector<VERTEX> &&other_vertices, std::vector<size_type> &&other_out_offsets, std::vector<index_type> &&other_out_neighbors, std::vector<size_type> &&other_in_offsets, std::vector<index_type> &&other_in_neighbors) {
+			vertices = std::move(other_vertices);
+			out_offsets = std::move(other_out_offsets);
+			out_neighbors = std::move(other_out_neighbors);
+			in_offsets = std::move(other_in_offsets);
+			in_neighbors = std::move(other_in_neighbors);
+
+			/*
+			 * A vertex other than u in both lists of u is an arc each way,
+			 * and every such pair is seen from both of its ends.
+			 */
+			parallel::per_thread<size_type> common(0);
+			parallel::for_each_vertex(*this, 1 << 14, [&](size_type ii) {
+				size_type &found = common.local();
+				const_neighbor_iterator out_iter = begin_neighbors(ii, OUTGOING);
+				const_neighbor_iterator in_iter = begin_neighbors(ii, INCOMING);
+				while(out_iter != end_neighbors(ii, OUTGOING) && in_iter != end_neighbors(ii, INCOMING)) {
+					if(*out_iter < *in_iter) {
+						++out_iter;
+					}
+					else if(*in_iter < *out_iter) {
+						++in_iter;
+					}
+					else {
+						if(*out_iter != (index_type)ii) {
+							found++;
+						}
+						++out_iter;
+						++in_iter;
+					}
+				}
+			});
+
+			reciprocal = std::accumulate(common.begin(), common.end(), (size_type)0) / 2;
+		}
+
+		/*
+		 * Iterators
+		 */
+		const_vertex_iterator begin_vertices() const {
+			return vertices.begin();
+		}
+
+		const_vertex_iterator end_vertices() const {
+			return vertices.end();
+		}
+
+		const_neighbor_iterator begin_neighbors(size_type vertex, direction which=OUTGOING) const {
+			if(which == OUTGOING) {
+				return out_neighbors.begin() + out_offsets[vertex];
+			}
+			return in_neighbors.begin() + in_offsets[vertex];
+		}
+
+		const_neighbor_iterator end_neighbors(size_type vertex, direction which=OUTGOING) const {
+			if(which == OUTGOING) {
+				return out_neighbors.begin() + out_offsets[vertex+1];
+			}
+			return in_neighbors.begin() + in_offsets[vertex+1];
+		}
+
+		/*
+		 * Capacity
+		 */
+		size_type size_vertices() const {
+			return (size_type)vertices.size();
+		}
+
+		size_type size_arcs() const {
+			return (size_type)out_neighbors.size();
+		}
+
+		/* pairs of distinct vertices joined by an arc in each direction */
+		size_type size_reciprocal() const {
+			return reciprocal;
+		}
+
+		size_type degree(size_type vertex, direction which=OUTGOING) const {
+			if(which == OUTGOING) {
+				return out_offsets[vertex+1] - out_offsets[vertex];
+			}
+			return in_offsets[vertex+1] - in_offsets[vertex];
+		}
+
+		undirected_view undirected() const {
+			return undirected_view(*this);
+		}
+
+		memory_report memory_usage() const {
+			using namespace memory_accounting;
+
+			size_type offset_bytes = (out_offsets.capacity() + in_offsets.capacity()) * sizeof(size_type);
+
+			memory_report usage;
+			usage.nodes = offset_bytes + sizeof(*this);
+			usage.keys = vertices.capacity() * sizeof(VERTEX);
+			usage.payloads = (out_neighbors.capacity() + in_neighbors.capacity()) * sizeof(index_type);
+			usage.strings = heap_bytes(vertices.begin(), vertices.end(), (const VERTEX *)NULL);
+			usage.overhead = allocation_overhead(out_offsets.capacity() * sizeof(size_type)) + allocation_overhead(in_offsets.capacity() * sizeof(size_type)) + allocation_overhead(vertices.capacity() * sizeof(VERTEX)) + allocation_overhead(out_neighbors.capacity() * sizeof(index_type)) + allocation_overhead(in_neighbors.capacity() * sizeof(index_type));
+
+			return usage;
+		}
+
+		/*
+		 * Element Access
+		 */
+		const VERTEX & vertex(size_type vertex) const {
+			return vertices[vertex];
+		}
+
+		/*
+		 * Operations
+		 */
+
+		/* returns size_vertices() when the vertex is not in the graph */
+		size_type index(const VERTEX &vertex) const {
+			const_vertex_iterator vertex_iter = std::lower_bound(vertices.begin(), vertices.end(), vertex);
+			if(vertex_iter != vertices.end() && !(vertex < *vertex_iter)) {
+				return (size_type)(vertex_iter - vertices.begin());
+			}
+			return size_vertices();
+		}
+
+		bool has_arc(size_type src, size_type dst) const {
+			if(degree(src, OUTGOING) <= degree(dst, INCOMING)) {
+				return std::binary_search(begin_neighbors(src, OUTGOING), end_neighbors(src, OUTGOING), (index_type)dst);
+			}
+			return std::binary_search(begin_neighbors(dst, INCOMING), end_neighbors(dst, INCOMING), (index_type)src);
+		}
+
+	protected:
+		std::vector<VERTEX> vertices;
+		std::vector<size_type> out_offsets;
+		std::vector<index_type> out_neighbors;
+		std::vector<size_type> in_offsets;
+		std::vector<index_type> in_neighbors;
+		size_type reciprocal;
+};
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef _COMPACT_GRAPH_HH_
+#define _COMPACT_GRAPH_HH_
+
+#include <vector>
+#include <utility>
+
+#include <algorithm>
+
+#include <cstddef>
+
+#include "graph.hh"
+#include "memory_usage.hh"
+
+/*
+ * Read-only adjacency array (CSR) snapshot of a graph<V> with any
+ * storage. Vertices are numbered 0..n-1 in the same order graph<V> keeps
+ * them, and each neighbor list is sorted by index. A self-loop appears
+ * once in the neighbor list of its vertex.
+ */
+template <typename V>
+class compact_graph {
+	public:
+		typedef size_t size_type;
+		typedef unsigned int index_type;
+
+		typedef typename graph<V>::VERTEX VERTEX;
+		typedef typename graph<V>::EDGE EDGE;
+
+		typedef typename std::vector<VERTEX>::const_iterator const_vertex_iterator;
+		typedef typename std::vector<index_type>::const_iterator const_neighbor_iterator;
+
+		compact_graph() : offsets(1, 0), edges(0) {
+
+		}
+
+		template <typename Storage>
+		explicit compact_graph(const graph<V, Storage> &other) : offsets(1, 0), edges(0) {
+			assign(other);
+		}
+
+		template <typename Storage>
+		void assign(const graph<V, Storage> &other) {
+			vertices.assign(other.begin_vertices(), other.end_vertices());
+			offsets.assign(vertices.size() + 1, 0);
+			neighbors.clear();
+			edges = 0;
+
+			std::vector<std::pair<index_type,index_type> > pairs;
+			typename graph<V, Storage>::const_edge_iterator edge_iter = other.begin_edges();
+			for(; edge_iter != other.end_edges(); ++edge_iter) {
+				index_type src = (index_type)index(edge_iter->first);
+				index_type dst = (index_type)index(edge_iter->second);
+
+				pairs.push_back(std::pair<index_type,index_type>(src, dst));
+				offsets[src+1]++;
+				if(src != dst) {
+					offsets[dst+1]++;
+				}
+			}
+
+			for(size_type ii = 0; ii < vertices.size(); ii++) {
+				offsets[ii+1] += offsets[ii];
+			}
+
+			/*
+			 * Edges arrive sorted by (src,dst) with src <= dst, so
+			 * appending both directions in that order leaves every
+			 * neighbor list sorted without a separate pass.
+			 */
+			std::vector<size_type> fill(offsets.begin(), offsets.end() - 1);
+			neighbors.resize(offsets.back());
+			typename std::vector<std::pair<index_type,index_type> >::const_iterator pair_iter = pairs.begin();
+			for(; pair_iter != pairs.end(); ++pair_iter) {
+				neighbors[fill[pair_iter->first]++] = pair_iter->second;
+				if(pair_iter->first != pair_iter->second) {
+					neighbors[fill[pair_iter->second]++] = pair_iter->first;
+				}
+			}
+
+			edges = pairs.size();
+		}
+
+		/*
+		 * Adopts prebuilt arrays. vertices must be sorted, neighbor lists
+		 * sorted and symmetric, and num_edges counts every undirected edge
+		 * (self-loops included) once.
+		 */
+		void assign(std::vector<VERTEX> &&other_vertices, std::vector<size_type> &&other_offsets, std::vector<index_type> &&other_neighbors, size_type num_edges) {
+			vertices = std::move(other_vertices);
+			offsets = std::move(other_offsets);
+			neighbors = std::move(other_neighbors);
+			edges = num_edges;
+		}
+
+		/*
+		 * Iterators
+		 */
+		const_vertex_iterator begin_vertices() const {
+			return vertices.begin();
+		}
+
+		const_vertex_iterator end_vertices() const {
+			return vertices.end();
+		}
+
+		const_neighbor_iterator begin_neighbors(size_type vertex) const {
+			return neighbors.begin() + offsets[vertex];
+		}
+
+		const_neighbor_iterator end_neighbors(size_type vertex) const {
+			return neighbors.begin() + offsets[vertex+1];
+		}
+
+		/*
+		 * Capacity
+		 */
+		size_type size_vertices() const {
+			return (size_type)vertices.size();
+		}
+
+		size_type size_edges() const {
+			return edges;
+		}
+
+		size_type degree(size_type vertex) const {
+			return offsets[vertex+1] - offsets[vertex];
+		}
+
+		memory_report memory_usage() const {
+			using namespace memory_accounting;
+
+			memory_report usage;
+			usage.nodes = offsets.capacity() * sizeof(size_type) + sizeof(*this);
+			usage.keys = vertices.capacity() * sizeof(VERTEX);
+			usage.payloads = neighbors.capacity() * sizeof(index_type);
+			usage.strings = heap_bytes(vertices.begin(), vertices.end(), (const VERTEX *)NULL);
+			usage.overhead = allocation_overhead(offsets.capacity() * sizeof(size_type)) + allocation_overhead(vertices.capacity() * sizeof(VERTEX)) + allocation_overhead(neighbors.capacity() * sizeof(index_type));
+
+			return usage;
+		}
+
+		/*
+		 * Element Access
+		 */
+		const VERTEX & vertex(size_type vertex) const {
+			return vertices[vertex];
+		}
+
+		const index_type * adjacency(size_type vertex) const {
+			return neighbors.empty() ? NULL : &neighbors[offsets[vertex]];
+		}
+
+		/*
+		 * Operations
+		 */
+
+		/* returns size_vertices() when the vertex is not in the graph */
+		size_type index(const VERTEX &vertex) const {
+			const_vertex_iterator vertex_iter = std::lower_bound(vertices.begin(), vertices.end(), vertex);
+			if(vertex_iter != vertices.end() && !(vertex < *vertex_iter)) {
+				return (size_type)(vertex_iter - vertices.begin());
+			}
+			return size_vertices();
+		}
+
+		bool has_edge(size_type src, size_type dst) const {
+			if(degree(src) > degree(dst)) {
+				std::swap(src, dst);
+			}
+			return std::binary_search(begin_neighbors(src), end_neighbors(src), (index_type)dst);
+		}
+
+	protected:
+		std::vector<VERTEX> vertices;
+		std::vector<size_type> offsets;
+		std::vector<index_type> neighbors;
+		size_type edges;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef _COUNT_MIN_HH_
+#define _COUNT_MIN_HH_
+
+#include <vector>
+
+#include <sstream>
+
+#include <algorithm>
+#include <limits>
+
+#include <stdexcept>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "hashing.hh"
+
+/*
+ * Count-Min sketch (Cormode and Muthukrishnan, 2005) with conservative
+ * update. An estimate never undercounts, and with probability at least
+ * 1 - delta overcounts by at most epsilon * total(), where
+ * epsilon = e / width and delta = exp(-depth). Rows are indexed by
+ * double hashing of one 64-bit hash of the key.
+ */
+class count_min {
+	public:
+		typedef size_t size_type;
+		typedef uint64_t count_type;
+
+		count_min(size_type width=1 << 16, size_type depth=4) : columns(width), rows(depth), counters(width * depth, 0), sum(0) {
+			if(width == 0 || depth == 0) {
+				std::ostringstream oss;
+				oss << "count-min sketch needs a non-zero width and depth";
+
+				throw std::domain_error(oss.str());
+			}
+		}
+
+		/*
+		 * Capacity
+		 */
+		size_type width() const {
+			return columns;
+		}
+
+		size_type depth() const {
+			return rows;
+		}
+
+		/* sum of all increments */
+		count_type total() const {
+			return sum;
+		}
+
+		double epsilon() const {
+			return std::exp(1.0) / (double)columns;
+		}
+
+		double delta() const {
+			return std::exp(-(double)rows);
+		}
+
+		size_type memory_usage() const {
+			return counters.capacity() * sizeof(count_type) + sizeof(*this);
+		}
+
+		/*
+		 * Modifiers
+		 */
+
+		/* returns the new estimate for the key */
+		count_type insert(uint64_t hash, count_type amount=1) {
+			sum += amount;
+
+			count_type target = estimate(hash) + amount;
+			uint64_t step = stride(hash);
+			for(size_type row = 0; row < rows; row++) {
+				count_type &counter = counters[row * columns + column(hash, step, row)];
+				counter = std::max(counter, target);
+			}
+			return target;
+		}
+
+		void clear() {
+			std::fill(counters.begin(), counters.end(), 0);
+			sum = 0;
+		}
+
+		/*
+		 * Operations
+		 */
+		count_type estimate(uint64_t hash) const {
+			count_type result = std::numeric_limits<count_type>::max();
+			uint64_t step = stride(hash);
+			for(size_type row = 0; row < rows; row++) {
+				result = std::min(result, counters[row * columns + column(hash, step, row)]);
+			}
+			return result;
+		}
+
+	protected:
+		size_type columns;
+		size_type rows;
+		std::vector<count_type> counters;
+		count_type sum;
+
+		/* row r uses hash + r * stride(hash), the Kirsch-Mitzenmacher scheme */
+		static uint64_t stride(uint64_t hash) {
+			return hashing::mix(hash) | 1;
+		}
+
+		size_type column(uint64_t hash, uint64_t step, size_type row) const {
+			return (size_type)((hash + row * step) % columns);
+		}
+};
+
+#endif
@@ -0,0 +1,421 @@
+#ifndef _DISTANCE_ORACLE_HH_
+#define _DISTANCE_ORACLE_HH_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+
+#include <sstream>
+
+#include <algorithm>
+
+#include <stdexcept>
+
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+
+#include "graph.hh"
+#include "compact_graph.hh"
+#include "neighborhood_function.hh"
+#include "parallel.hh"
+#include "binary_io.hh"
+#include "checkpoint.hh"
+
+/*
+ * Landmark index for hop distances. A BFS from each of a few landmarks
+ * stores the distance from every vertex to every landmark in one byte,
+ * with a vertex's distances side by side so that a query reads two
+ * short rows. By the triangle inequality, for every landmark l
+ *
+ *   |d(l,u) - d(l,v)| <= d(u,v) <= d(l,u) + d(l,v)
+ *
+ * so bounds() costs a pass over the landmarks. Vertices of different
+ * components are told apart by a component label, so unreachable pairs
+ * come back exact. refine() closes the gap with a bidirectional BFS that
+ * stops as soon as the bounds meet, or after a given number of visits.
+ *
+ * Landmarks are the vertices of highest degree or highest harmonic
+ * centrality (estimated with neighborhood_function), skipping
+ * neighbors of landmarks already chosen so that they spread out.
+ * Distances of 255 hops or more are stored as FAR and give no bounds.
+ *
+ * The index is tied to the graph it was built for: save() records a
+ * fingerprint of the graph that load() checks.
+ */
+template <typename V>
+class distance_oracle {
+	public:
+		typedef size_t size_type;
+		typedef typename compact_graph<V>::index_type index_type;
+
+		typedef typename compact_graph<V>::VERTEX VERTEX;
+
+		static const uint32_t VERSION = 1;
+
+		/* distance stored for vertices 255 or more hops from a landmark */
+		static const uint8_t FAR = 255;
+
+		/* the distance between vertices in different components */
+		static const size_type INFINITE = (size_type)-1;
+
+		enum selection {
+			DEGREE,
+			CENTRALITY
+		};
+
+		struct estimate {
+			size_type lower;
+			size_type upper;
+
+			bool exact() const {
+				return lower == upper;
+			}
+		};
+
+		template <typename Storage>
+		explicit distance_oracle(const graph<V, Storage> &other) : adjacency(other) {
+			label_components();
+		}
+
+		explicit distance_oracle(const compact_graph<V> &other) : adjacency(other) {
+			label_components();
+		}
+
+		/*
+		 * Capacity
+		 */
+		size_type size_landmarks() const {
+			return landmarks.size();
+		}
+
+		memory_report memory_usage() const {
+			memory_report usage = adjacency.memory_usage();
+			usage.payloads += distances.capacity() * sizeof(uint8_t) + components.capacity() * sizeof(index_type) + landmarks.capacity() * sizeof(index_type);
+			return usage;
+		}
+
+		/*
+		 * Element Access
+		 */
+		const VERTEX & landmark(size_type ii) const {
+			return adjacency.vertex(landmarks[ii]);
+		}
+
+		/*
+		 * Modifiers
+		 */
+
+		/*
+		 * Picks num_landmarks landmarks and runs a BFS from each, in
+		 * parallel. Each BFS fills a column of its own, and the columns are
+		 * transposed into rows at the end, so that no two threads write
+		 * to the same cache lines.
+		 */
+		void build(size_type num_landmarks=16, selection by=DEGREE) {
+			size_type num_vertices = adjacency.size_vertices();
+			select(std::min(num_landmarks, num_vertices), by);
+
+			size_type width = landmarks.size();
+			std::vector<uint8_t> columns(num_vertices * width);
+			parallel::per_thread<std::vector<index_type> > queues;
+			parallel::parallel_for(0, width, 1, [&](size_type ii) {
+				std::vector<index_type> &queue = queues.local();
+				bfs(landmarks[ii], &columns[ii * num_vertices], queue);
+			});
+
+			std::vector<uint8_t> table(num_vertices * width);
+			parallel::parallel_for(0, num_vertices, 1 << 12, [&](size_type vertex) {
+				for(size_type ii = 0; ii < width; ii++) {
+					table[vertex * width + ii] = columns[ii * num_vertices + vertex];
+				}
+			});
+			distances.swap(table);
+		}
+
+		/*
+		 * Operations
+		 */
+		estimate bounds(const VERTEX &src, const VERTEX &dst) const {
+			return bounds(lookup(src), lookup(dst));
+		}
+
+		estimate bounds(size_type src, size_type dst) const {
+			estimate result;
+			if(src == dst) {
+				result.lower = result.upper = 0;
+				return result;
+			}
+			if(components[src] != components[dst]) {
+				result.lower = result.upper = INFINITE;
+				return result;
+			}
+
+			return landmark_bounds(src, dst);
+		}
+
+		estimate refine(const VERTEX &src, const VERTEX &dst, size_type budget=0) const {
+			return refine(lookup(src), lookup(dst), budget);
+		}
+
+		/*
+		 * Bidirectional BFS from both ends, a level at a time on the
+		 * smaller frontier. A vertex whose depth plus its landmark lower
+		 * bound to the other end reaches the best path found so far lies
+		 * on no shorter path, so it is not expanded. The search stops once
+		 * the bounds meet, or before a level when more than budget
+		 * vertices have been visited (0 for no limit); the result is
+		 * exact only in the first case.
+		 */
+		estimate refine(size_type src, size_type dst, size_type budget=0) const {
+			estimate result = bounds(src, dst);
+			if(result.exact()) {
+				return result;
+			}
+
+			std::unordered_map<index_type,index_type> forward;
+			std::unordered_map<index_type,index_type> backward;
+			std::vector<index_type> forward_frontier(1, (index_type)src);
+			std::vector<index_type> backward_frontier(1, (index_type)dst);
+			std::vector<index_type> next;
+			forward[(index_type)src] = 0;
+			backward[(index_type)dst] = 0;
+
+			size_type forward_depth = 0;
+			size_type backward_depth = 0;
+			while(!result.exact() && (budget == 0 || forward.size() + backward.size() <= budget)) {
+				bool from_src = forward_frontier.size() <= backward_frontier.size();
+				std::unordered_map<index_type,index_type> &near = from_src ? forward : backward;
+				std::unordered_map<index_type,index_type> &far = from_src ? backward : forward;
+				std::vector<index_type> &frontier = from_src ? forward_frontier : backward_frontier;
+				size_type &depth = from_src ? forward_depth : backward_depth;
+				size_type target = from_src ? dst : src;
+
+				next.clear();
+				for(size_type ii = 0; ii < frontier.size(); ii++) {
+					const_neighbor_iterator iter = adjacency.begin_neighbors(frontier[ii]);
+					for(; iter != adjacency.end_neighbors(frontier[ii]); ++iter) {
+						if(near.find(*iter) != near.end()) {
+							continue;
+						}
+						near[*iter] = (index_type)(depth + 1);
+
+						typename std::unordered_map<index_type,index_type>::const_iterator other = far.find(*iter);
+						if(other != far.end()) {
+							result.upper = std::min(result.upper, depth + 1 + other->second);
+						}
+						else if(depth + 1 + landmark_bounds(*iter, target).lower < result.upper) {
+							next.push_back(*iter);
+						}
+					}
+				}
+				frontier.swap(next);
+				depth++;
+
+				/* a path of at most forward_depth + backward_depth hops would have met */
+				result.lower = std::max(result.lower, std::min(result.upper, forward_depth + backward_depth + 1));
+				if(frontier.empty()) {
+					/* the whole component is on one side, so the other end was found */
+					result.lower = result.upper;
+				}
+			}
+			return result;
+		}
+
+		/*
+		 * Serialization
+		 */
+		void save(const std::string &filename) const {
+			binary_io::writer output(filename, "distance_oracle", VERSION);
+			output.value(checkpointer::fingerprint(adjacency));
+			output.array(landmarks);
+			output.array(distances);
+			output.commit();
+		}
+
+		/*
+		 * Reads an index saved for this graph. Returns false when there is
+		 * no file, so that the caller can build() and save() one instead.
+		 */
+		bool load(const std::string &filename) {
+			std::FILE *file = std::fopen(filename.c_str(), "rb");
+			if(file == NULL) {
+				return false;
+			}
+			std::fclose(file);
+
+			uint32_t version = 0;
+			binary_io::reader input(filename, "distance_oracle", version);
+			if(version != VERSION) {
+				std::ostringstream oss;
+				oss << "unsupported distance_oracle version " << version;
+				input.fail(oss.str());
+			}
+
+			uint64_t fingerprint = 0;
+			input.value(fingerprint);
+			if(fingerprint != checkpointer::fingerprint(adjacency)) {
+				input.fail("index was built for a different graph");
+			}
+
+			size_type num_vertices = adjacency.size_vertices();
+			std::vector<index_type> other_landmarks;
+			std::vector<uint8_t> other_distances;
+			input.array(other_landmarks, num_vertices);
+			input.array(other_distances, (uint64_t)num_vertices * other_landmarks.size());
+			input.finish();
+
+			if(other_distances.size() != num_vertices * other_landmarks.size()) {
+				input.fail("distance table does not match the landmarks");
+			}
+			for(size_type ii = 0; ii < other_landmarks.size(); ii++) {
+				if(other_landmarks[ii] >= num_vertices) {
+					input.fail("landmark out of range");
+				}
+			}
+
+			landmarks.swap(other_landmarks);
+			distances.swap(other_distances);
+			return true;
+		}
+
+	protected:
+		typedef typename compact_graph<V>::const_neighbor_iterator const_neighbor_iterator;
+
+		compact_graph<V> adjacency;
+
+		/* distances[vertex * size_landmarks() + ii] is the distance from vertex to landmark ii */
+		std::vector<index_type> landmarks;
+		std::vector<uint8_t> distances;
+
+		/* smallest vertex index of each vertex's component */
+		std::vector<index_type> components;
+
+		size_type lookup(const VERTEX &vertex) const {
+			size_type index = adjacency.index(vertex);
+			if(index == adjacency.size_vertices()) {
+				std::ostringstream oss;
+				oss << "unexpected vertex";
+
+				throw std::domain_error(oss.str());
+			}
+			return index;
+		}
+
+		void label_components() {
+			size_type num_vertices = adjacency.size_vertices();
+			components.assign(num_vertices, (index_type)num_vertices);
+
+			std::vector<index_type> queue;
+			for(size_type root = 0; root < num_vertices; root++) {
+				if(components[root] != num_vertices) {
+					continue;
+				}
+				components[root] = (index_type)root;
+				queue.assign(1, (index_type)root);
+				for(size_type head = 0; head < queue.size(); head++) {
+					const_neighbor_iterator iter = adjacency.begin_neighbors(queue[head]);
+					for(; iter != adjacency.end_neighbors(queue[head]); ++iter) {
+						if(components[*iter] == num_vertices) {
+							components[*iter] = (index_type)root;
+							queue.push_back(*iter);
+						}
+					}
+				}
+			}
+		}
+
+		void select(size_type num_landmarks, selection by) {
+			size_type num_vertices = adjacency.size_vertices();
+			std::vector<double> score(num_vertices);
+			if(by == CENTRALITY) {
+				neighborhood_function<V> estimator(adjacency);
+				estimator.run();
+				for(size_type ii = 0; ii < num_vertices; ii++) {
+					score[ii] = estimator.harmonic_centrality(ii);
+				}
+			}
+			else {
+				for(size_type ii = 0; ii < num_vertices; ii++) {
+					score[ii] = (double)adjacency.degree(ii);
+				}
+			}
+
+			std::vector<index_type> order(num_vertices);
+			for(size_type ii = 0; ii < num_vertices; ii++) {
+				order[ii] = (index_type)ii;
+			}
+			std::stable_sort(order.begin(), order.end(), [&](index_type a, index_type b) {
+				return score[a] > score[b];
+			});
+
+			/* first pass skips neighbors of chosen landmarks, second fills up */
+			std::vector<bool> blocked(num_vertices, false);
+			landmarks.clear();
+			for(unsigned int pass = 0; pass < 2 && landmarks.size() < num_landmarks; pass++) {
+				for(size_type ii = 0; ii < num_vertices && landmarks.size() < num_landmarks; ii++) {
+					index_type vertex = order[ii];
+					if(blocked[vertex] && (pass == 0 || std::find(landmarks.begin(), landmarks.end(), vertex) != landmarks.end())) {
+						continue;
+					}
+					landmarks.push_back(vertex);
+					blocked[vertex] = true;
+					const_neighbor_iterator iter = adjacency.begin_neighbors(vertex);
+					for(; iter != adjacency.end_neighbors(vertex); ++iter) {
+						blocked[*iter] = true;
+					}
+				}
+			}
+		}
+
+		/* what the landmarks alone say about two vertices of one component */
+		estimate landmark_bounds(size_type src, size_type dst) const {
+			/* distinct vertices are at least one hop apart */
+			estimate result;
+			result.lower = src == dst ? 0 : 1;
+			result.upper = src == dst ? 0 : INFINITE;
+			size_type width = landmarks.size();
+			const uint8_t *src_row = width == 0 ? NULL : &distances[src * width];
+			const uint8_t *dst_row = width == 0 ? NULL : &distances[dst * width];
+			for(size_type ii = 0; ii < width; ii++) {
+				size_type src_distance = src_row[ii];
+				size_type dst_distance = dst_row[ii];
+				if(src_distance == FAR || dst_distance == FAR) {
+					/* only one side being FAR still says the other is close to the landmark */
+					if(src_distance != dst_distance) {
+						result.lower = std::max(result.lower, (size_type)FAR - std::min(src_distance, dst_distance));
+					}
+					continue;
+				}
+				result.upper = std::min(result.upper, src_distance + dst_distance);
+				result.lower = std::max(result.lower, src_distance > dst_distance ? src_distance - dst_distance : dst_distance - src_distance);
+			}
+			return result;
+		}
+
+		/* writes the distance from root to every vertex into column */
+		void bfs(index_type root, uint8_t *column, std::vector<index_type> &queue) const {
+			size_type num_vertices = adjacency.size_vertices();
+			std::fill(column, column + num_vertices, (uint8_t)FAR);
+
+			column[root] = 0;
+			queue.assign(1, root);
+			for(size_type head = 0; head < queue.size(); head++) {
+				index_type vertex = queue[head];
+				uint8_t next = column[vertex] + 1;
+				if(next == FAR) {
+					break;
+				}
+				const_neighbor_iterator iter = adjacency.begin_neighbors(vertex);
+				for(; iter != adjacency.end_neighbors(vertex); ++iter) {
+					if(column[*iter] == FAR) {
+						column[*iter] = next;
+						queue.push_back(*iter);
+					}
+				}
+			}
+		}
+};
+
+#endif
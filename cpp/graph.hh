@@ -4,7 +4,7 @@
 #include <ostream>
 #include <sstream>
 
-#include <set>
+#include <memory>
 #include <utility>
 
 #include <algorithm>
@@ -14,22 +14,39 @@
 #include <cstddef>
 
 #include "output_any.hh"
-
-template <typename V>
+#include "memory_usage.hh"
+#include "graph_storage.hh"
+
+/*
+ * Undirected graph over ordered vertices. Storage decides how the vertex
+ * and edge sets are kept (see graph_storage.hh): std::sets by default,
+ * or a bitmap and sorted neighbor lists with dense_storage<V> for
+ * densely numbered integral vertices.
+ */
+template <typename V, typename Storage = graph_storage<V> >
 class graph {
 	public:
 		typedef size_t size_type;
 
-		typedef typename std::set<V>::value_type VERTEX;
-		typedef typename std::set<std::pair<VERTEX,VERTEX> >::value_type EDGE;
+		typedef typename Storage::VERTEX VERTEX;
+		typedef typename Storage::EDGE EDGE;
+
+		typedef typename Storage::vertex_set vertex_set;
+		typedef typename Storage::edge_set edge_set;
 
-		typedef typename std::set<VERTEX>::iterator vertex_iterator;
-		typedef typename std::set<VERTEX>::const_iterator const_vertex_iterator;
+		typedef typename vertex_set::iterator vertex_iterator;
+		typedef typename vertex_set::const_iterator const_vertex_iterator;
 		
-		typedef typename std::set<EDGE>::iterator edge_iterator;
-		typedef typename std::set<EDGE>::const_iterator const_edge_iterator;
+		typedef typename edge_set::iterator edge_iterator;
+		typedef typename edge_set::const_iterator const_edge_iterator;
 
-		graph() {
+		/*
+		 * Copies share the vertex and edge sets with the original; a set
+		 * is cloned the first time one of the graphs modifies it. Iterators
+		 * obtained before such a modification keep pointing into the
+		 * shared set.
+		 */
+		graph() : vertices(empty_vertices()), edges(empty_edges()) {
 
 		}
 
@@ -37,6 +54,11 @@ class graph {
 
 		}
 
+		graph(graph &&other) noexcept : vertices(std::move(other.vertices)), edges(std::move(other.edges)) {
+			other.vertices = empty_vertices();
+			other.edges = empty_edges();
+		}
+
 		graph & operator=(const graph &other) {
 			vertices = other.vertices;
 			edges = other.edges;
@@ -44,50 +66,67 @@ class graph {
 			return *this;
 		}
 
+		graph & operator=(graph &&other) noexcept {
+			if(this != &other) {
+				vertices = std::move(other.vertices);
+				edges = std::move(other.edges);
+
+				other.vertices = empty_vertices();
+				other.edges = empty_edges();
+			}
+
+			return *this;
+		}
+
 		/*
 		 * Iterators
 		 */
 		vertex_iterator begin_vertices() {
-			return vertices.begin();
+			return vertices->begin();
 		}
 
 		vertex_iterator end_vertices() {
-			return vertices.end();
+			return vertices->end();
 		}
 
 		const_vertex_iterator begin_vertices() const {
-			return vertices.begin();
+			return vertices->begin();
 		}
 		
 		const_vertex_iterator end_vertices() const {
-			return vertices.end();
+			return vertices->end();
 		}
 
 		edge_iterator begin_edges() {
-			return edges.begin();
+			return edges->begin();
 		}
 
 		edge_iterator end_edges() {
-			return edges.end();
+			return edges->end();
 		}
 
 		const_edge_iterator begin_edges() const {
-			return edges.begin();
+			return edges->begin();
 		}
 		
 		const_edge_iterator  end_edges() const {
-			return edges.end();
+			return edges->end();
 		}
 
 		/*
 		 * Capacity
 		 */
-		size_type size_vertices() {
-			return (size_type)vertices.size();
+		size_type size_vertices() const {
+			return (size_type)vertices->size();
+		}
+
+		size_type size_edges() const {
+			return (size_type)edges->size();
 		}
 
-		size_type size_edges() {
-			return (size_type)edges.size();
+		/* sets shared with copies are reported in full by every copy */
+		memory_report memory_usage() const {
+			return Storage::memory_usage(*vertices, *edges);
 		}
 
 		/*
@@ -98,17 +137,17 @@ class graph {
 		 * Modifiers
 		 */
 		std::pair<vertex_iterator,bool> insert(const VERTEX &vertex) {
-			return vertices.insert(vertex);
+			return mutable_vertices().insert(vertex);
 		}
 		
 		std::pair<edge_iterator,bool> insert(const EDGE &edge) {
-			if(find(edge.first) == end_vertices()) {
+			if(!contains(edge.first)) {
 				std::ostringstream oss;
 				oss << "unexpected vertex";
 
 				throw std::domain_error(oss.str());
 			}
-			else if(find(edge.second) == end_vertices()) {
+			else if(!contains(edge.second)) {
 				std::ostringstream oss;
 				oss << "unexpected vertex";
 
@@ -116,10 +155,10 @@ class graph {
 			}
 
 			if(edge.first > edge.second) {
-				return edges.insert( EDGE(edge.second, edge.first) );
+				return mutable_edges().insert( EDGE(edge.second, edge.first) );
 			}
 			else {
-				return edges.insert(edge);
+				return mutable_edges().insert(edge);
 			}
 		}
 		
@@ -135,8 +174,10 @@ class graph {
 		size_type erase(const VERTEX &vertex) {
 			vertex_iterator vertex_iter = find(vertex);
 			if(vertex_iter != end_vertices()) {
-				remove_incident_edges(vertex);		
-				erase(vertex_iter);	
+				remove_incident_edges(vertex);
+				erase(vertex_iter);
+
+				return 1;
 			}
 			else {
 				return 0;
@@ -145,28 +186,38 @@ class graph {
 
 		size_type erase(const EDGE &edge) {
 			if(edge.first > edge.second) {
-				return (size_type)edges.erase( EDGE(edge.second, edge.first) );
+				return (size_type)mutable_edges().erase( EDGE(edge.second, edge.first) );
 			}
 			else {
-				return (size_type)edges.erase(edge);
+				return (size_type)mutable_edges().erase(edge);
 			}
 		}
 		
 		void erase(vertex_iterator position) {
-			vertices.erase(position);
+			if(vertices.use_count() == 1) {
+				vertices->erase(position);
+			}
+			else {
+				mutable_vertices().erase(*position);
+			}
 		}
 
 		void erase(edge_iterator position) {
-			edges.erase(position);
+			if(edges.use_count() == 1) {
+				edges->erase(position);
+			}
+			else {
+				mutable_edges().erase(*position);
+			}
 		}
 
 		void clear_vertices() {
-			vertices.clear();
+			vertices = empty_vertices();
 			clear_edges();
 		}
 
 		void clear_edges() {
-			edges.clear();
+			edges = empty_edges();
 		}
 
 		void clear() {
@@ -175,68 +226,68 @@ class graph {
 		}
 
 		void remove_incident_edges(const VERTEX &vertex) {
-			/*
-			edge_iterator edge_iter = begin_edges();
-			for(; edge_iter != end_edges(); ++edge_iter) {
-				if(edge_iter->first == vertex || edge_iter->second == vertex) {
-					edges.erase(edge_iter++);
-				}
-				else {
-					++edge_iter;
-				}
-			}*/
-			std::remove_if(edges.begin(), edges.end(), incident_test(vertex));
+			Storage::remove_incident_edges(mutable_edges(), vertex);
+		}
+
+		/* gives this graph its own copy of any set it still shares */
+		void detach() {
+			mutable_vertices();
+			mutable_edges();
 		}
 
 		/*
 		 * Operations
 		 */
+		bool contains(const VERTEX &vertex) const {
+			return vertices->count(vertex) != 0;
+		}
+
 		vertex_iterator find(const VERTEX &vertex) {
-			return vertices.find(vertex);
+			return vertices->find(vertex);
 		}
 
 		const_vertex_iterator find(const VERTEX &vertex) const {
-			return vertices.find(vertex);
+			return vertices->find(vertex);
 		}
 
 		edge_iterator find(const EDGE &edge) {
-			return edges.find(edge);
+			return edges->find(edge);
 		}
 
 		const_edge_iterator find(const EDGE &edge) const {
-			return edges.find(edge);
+			return edges->find(edge);
 		}
 		
 		vertex_iterator lower_bound(const VERTEX &vertex) {
-			return vertices.lower_bound(vertex);
+			return vertices->lower_bound(vertex);
 		}
 		
 		const_vertex_iterator lower_bound(const VERTEX &vertex) const {
-			return vertices.lower_bound(vertex);
+			return vertices->lower_bound(vertex);
 		}
 
 		edge_iterator lower_bound(const EDGE &edge) {
-			return edges.lower_bound(edge);
+			return edges->lower_bound(edge);
 		}
 		
 		const_edge_iterator lower_bound(const EDGE &edge) const {
-			return edges.lower_bound(edge);
+			return edges->lower_bound(edge);
 		}
 
 		vertex_iterator upper_bound(const VERTEX &vertex) {
-			return vertices.upper_bound(vertex);
+			return vertices->upper_bound(vertex);
 		}
 		
 		const_vertex_iterator upper_bound(const VERTEX &vertex) const {
-			return vertices.upper_bound(vertex);
+			return vertices->upper_bound(vertex);
 		}
 
 		edge_iterator upper_bound(const EDGE &edge) {
-			return edges.upper_bound(edge);
+			return edges->upper_bound(edge);
 		}
 		
 		const_edge_iterator upper_bound(const EDGE &edge) const {
-			return edges.upper_bound(edge);
+			return edges->upper_bound(edge);
 		}
 
 		/*
@@ -261,19 +312,33 @@ class graph {
 		}
 	
 	protected:
-		std::set<VERTEX> vertices;
-		std::set<EDGE> edges;
-	
-		struct incident_test {
-			const VERTEX &vertex;
-			incident_test(const VERTEX &vertex): vertex(vertex) {
-				
+		std::shared_ptr<vertex_set> vertices;
+		std::shared_ptr<edge_set> edges;
+
+		/* shared by every empty graph, so construction does not allocate */
+		static const std::shared_ptr<vertex_set> & empty_vertices() {
+			static const std::shared_ptr<vertex_set> empty = std::allocate_shared<vertex_set>(counting_allocator<vertex_set>());
+			return empty;
+		}
+
+		static const std::shared_ptr<edge_set> & empty_edges() {
+			static const std::shared_ptr<edge_set> empty = std::allocate_shared<edge_set>(counting_allocator<edge_set>());
+			return empty;
+		}
+
+		vertex_set & mutable_vertices() {
+			if(vertices.use_count() != 1) {
+				vertices = std::allocate_shared<vertex_set>(counting_allocator<vertex_set>(), *vertices);
 			}
+			return *vertices;
+		}
 
-			bool operator()(const EDGE &edge) const {
-				return edge.first == vertex || edge.second == vertex;
+		edge_set & mutable_edges() {
+			if(edges.use_count() != 1) {
+				edges = std::allocate_shared<edge_set>(counting_allocator<edge_set>(), *edges);
 			}
-		};	
+			return *edges;
+		}
 };
 
 #endif
@@ -0,0 +1,270 @@
+#ifndef _GRAPH_BUILDER_HH_
+#define _GRAPH_BUILDER_HH_
+
+#include <vector>
+#include <unordered_map>
+#include <utility>
+
+#include <sstream>
+
+#include <algorithm>
+#include <functional>
+
+#include <stdexcept>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "compact_graph.hh"
+#include "compact_digraph.hh"
+#include "memory_usage.hh"
+#include "parallel.hh"
+#include "radix_sort.hh"
+
+/*
+ * Bulk construction of a compact_graph or compact_digraph without going
+ * through graph<V>.
+ *
+ * Vertices are interned to dense ids as they arrive and edges are kept as
+ * id pairs in the order given. build() renumbers the ids into the vertex
+ * order graph<V> uses, packs the edges into 64-bit (vertex,neighbor)
+ * keys, radix sorts and deduplicates them in parallel, and reads the
+ * adjacency arrays straight off the sorted keys. The undirected result is
+ * the same compact_graph that inserting the edges into a graph<V> and
+ * converting it would give: duplicates collapse and a self-loop is kept
+ * once.
+ */
+template <typename V>
+class graph_builder {
+	public:
+		typedef size_t size_type;
+		typedef typename compact_graph<V>::index_type index_type;
+
+		typedef typename compact_graph<V>::VERTEX VERTEX;
+
+		graph_builder() {
+
+		}
+
+		graph_builder(const graph_builder &) = delete;
+		graph_builder & operator=(const graph_builder &) = delete;
+
+		/*
+		 * Capacity
+		 */
+		size_type size_vertices() const {
+			return vertices.size();
+		}
+
+		/* edges added so far, duplicates included */
+		size_type size_pairs() const {
+			return pairs.size();
+		}
+
+		/* the id table follows the libstdc++ hashtable: buckets plus a node per vertex */
+		memory_report memory_usage() const {
+			using namespace memory_accounting;
+
+			typedef std::pair<const VERTEX,index_type> id_value;
+			size_type node_size = sizeof(void *) + sizeof(id_value);
+
+			memory_report usage;
+			usage.nodes = sizeof(*this) + ids.bucket_count() * sizeof(void *) + ids.size() * sizeof(void *);
+			usage.keys = vertices.capacity() * sizeof(VERTEX) + ids.size() * sizeof(id_value);
+			usage.payloads = pairs.capacity() * sizeof(std::pair<index_type,index_type>);
+			usage.strings = 2 * heap_bytes(vertices.begin(), vertices.end(), (const VERTEX *)NULL);
+			usage.overhead = ids.size() * allocation_overhead(node_size) + allocation_overhead(ids.bucket_count() * sizeof(void *)) + allocation_overhead(vertices.capacity() * sizeof(VERTEX)) + allocation_overhead(pairs.capacity() * sizeof(std::pair<index_type,index_type>));
+
+			return usage;
+		}
+
+		/*
+		 * Modifiers
+		 */
+		index_type insert(const VERTEX &vertex) {
+			std::pair<typename std::unordered_map<VERTEX,index_type>::iterator,bool> result = ids.insert(std::make_pair(vertex, (index_type)vertices.size()));
+			if(result.second) {
+				if(vertices.size() == (size_type)(index_type)-1) {
+					std::ostringstream oss;
+					oss << "too many vertices";
+
+					throw std::length_error(oss.str());
+				}
+				vertices.push_back(vertex);
+			}
+			return result.first->second;
+		}
+
+		/* adds the endpoints as needed */
+		void insert(const VERTEX &src, const VERTEX &dst) {
+			index_type src_id = insert(src);
+			index_type dst_id = insert(dst);
+			pairs.push_back(std::make_pair(src_id, dst_id));
+		}
+
+		void reserve(size_type num_vertices, size_type num_pairs) {
+			ids.reserve(num_vertices);
+			vertices.reserve(num_vertices);
+			pairs.reserve(num_pairs);
+		}
+
+		void clear() {
+			std::unordered_map<VERTEX,index_type>().swap(ids);
+			std::vector<VERTEX>().swap(vertices);
+			std::vector<std::pair<index_type,index_type> >().swap(pairs);
+		}
+
+		/*
+		 * Operations
+		 */
+
+		/* builds the undirected graph and leaves the builder empty */
+		void build(compact_graph<V> &result) {
+			std::vector<VERTEX> sorted;
+			unsigned int width;
+			std::vector<uint64_t> keys;
+			pack_keys(sorted, width, keys, true);
+
+			std::vector<size_type> offsets;
+			std::vector<index_type> neighbors;
+			size_type loops = unpack_keys(keys, width, sorted.size(), offsets, neighbors);
+			size_type num_keys = keys.size();
+			std::vector<uint64_t>().swap(keys);
+
+			result.assign(std::move(sorted), std::move(offsets), std::move(neighbors), (num_keys + loops) / 2);
+		}
+
+		/* builds the directed graph, keeping every pair as src -> dst, and leaves the builder empty */
+		void build(compact_digraph<V> &result) {
+			std::vector<VERTEX> sorted;
+			unsigned int width;
+			std::vector<uint64_t> keys;
+			pack_keys(sorted, width, keys, false);
+
+			std::vector<size_type> out_offsets;
+			std::vector<index_type> out_neighbors;
+			unpack_keys(keys, width, sorted.size(), out_offsets, out_neighbors);
+
+			/* the arcs are unique already, so the transpose only needs sorting */
+			const uint64_t mask = ((uint64_t)1 << width) - 1;
+			parallel::parallel_for(0, keys.size(), 1 << 16, [&](size_type ii) {
+				keys[ii] = ((keys[ii] & mask) << width) | (keys[ii] >> width);
+			});
+
+			std::vector<uint64_t> scratch;
+			radix_sort::sort(keys, scratch, 2 * width);
+			std::vector<uint64_t>().swap(scratch);
+
+			std::vector<size_type> in_offsets;
+			std::vector<index_type> in_neighbors;
+			unpack_keys(keys, width, sorted.size(), in_offsets, in_neighbors);
+			std::vector<uint64_t>().swap(keys);
+
+			result.assign(std::move(sorted), std::move(out_offsets), std::move(out_neighbors), std::move(in_offsets), std::move(in_neighbors));
+		}
+
+	protected:
+		struct vertex_less {
+			const std::vector<VERTEX> &vertices;
+
+			vertex_less(const std::vector<VERTEX> &vertices) : vertices(vertices) {
+
+			}
+
+			bool operator()(index_type lhs, index_type rhs) const {
+				return vertices[lhs] < vertices[rhs];
+			}
+		};
+
+		std::unordered_map<VERTEX,index_type> ids;
+		std::vector<VERTEX> vertices;
+		std::vector<std::pair<index_type,index_type> > pairs;
+
+		/*
+		 * Moves the vertices into sorted order and the pairs into
+		 * (vertex << width) | neighbor keys, sorted and without repeats.
+		 * symmetric adds the reverse of every pair; a self-loop then
+		 * yields the same key twice, which unique() folds.
+		 */
+		void pack_keys(std::vector<VERTEX> &sorted, unsigned int &width, std::vector<uint64_t> &keys, bool symmetric) {
+			size_type num_vertices = vertices.size();
+			size_type num_pairs = pairs.size();
+
+			/* ranks[id] is the position of vertex id in sorted order */
+			std::vector<index_type> order(num_vertices);
+			for(size_type ii = 0; ii < num_vertices; ii++) {
+				order[ii] = (index_type)ii;
+			}
+			std::sort(order.begin(), order.end(), vertex_less(vertices));
+
+			sorted.clear();
+			sorted.reserve(num_vertices);
+			std::vector<index_type> ranks(num_vertices);
+			for(size_type ii = 0; ii < num_vertices; ii++) {
+				sorted.push_back(vertices[order[ii]]);
+				ranks[order[ii]] = (index_type)ii;
+			}
+			std::vector<index_type>().swap(order);
+			std::unordered_map<VERTEX,index_type>().swap(ids);
+			std::vector<VERTEX>().swap(vertices);
+
+			width = 1;
+			while(width < 32 && ((uint64_t)1 << width) < num_vertices) {
+				width++;
+			}
+
+			size_type stride = symmetric ? 2 : 1;
+			keys.assign(stride * num_pairs, 0);
+			parallel::parallel_for(0, num_pairs, 1 << 16, [&](size_type ii) {
+				uint64_t src = ranks[pairs[ii].first];
+				uint64_t dst = ranks[pairs[ii].second];
+				keys[stride*ii] = (src << width) | dst;
+				if(symmetric) {
+					keys[stride*ii+1] = (dst << width) | src;
+				}
+			});
+			std::vector<std::pair<index_type,index_type> >().swap(pairs);
+			std::vector<index_type>().swap(ranks);
+
+			std::vector<uint64_t> scratch;
+			radix_sort::sort(keys, scratch, 2 * width);
+			radix_sort::unique(keys, scratch);
+		}
+
+		/*
+		 * Reads adjacency arrays off sorted keys and returns the number
+		 * of self-loops. offsets[v] is the first key whose vertex is v;
+		 * each key that starts a new vertex fills in the offsets of the
+		 * vertices since the previous one, which have no neighbors.
+		 */
+		static size_type unpack_keys(const std::vector<uint64_t> &keys, unsigned int width, size_type num_vertices, std::vector<size_type> &offsets, std::vector<index_type> &neighbors) {
+			const uint64_t mask = ((uint64_t)1 << width) - 1;
+			size_type num_keys = keys.size();
+
+			offsets.assign(num_vertices + 1, 0);
+			neighbors.resize(num_keys);
+
+			size_type loops = parallel::parallel_reduce(0, num_keys, 1 << 16, (size_type)0, [&](size_type ii) -> size_type {
+				uint64_t vertex = keys[ii] >> width;
+				uint64_t neighbor = keys[ii] & mask;
+				neighbors[ii] = (index_type)neighbor;
+
+				if(ii == 0 || vertex != (keys[ii-1] >> width)) {
+					uint64_t previous = ii == 0 ? 0 : (keys[ii-1] >> width) + 1;
+					for(uint64_t jj = previous; jj <= vertex; jj++) {
+						offsets[jj] = ii;
+					}
+				}
+				return vertex == neighbor ? 1 : 0;
+			}, std::plus<size_type>());
+
+			size_type last = num_keys == 0 ? 0 : (size_type)(keys[num_keys-1] >> width) + 1;
+			for(size_type ii = last; ii <= num_vertices; ii++) {
+				offsets[ii] = num_keys;
+			}
+
+			return loops;
+		}
+};
+
+#endif
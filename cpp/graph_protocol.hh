@@ -0,0 +1,246 @@
+#ifndef _GRAPH_PROTOCOL_HH_
+#define _GRAPH_PROTOCOL_HH_
+
+#include <string>
+#include <vector>
+
+#include <stdexcept>
+
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+
+#include <unistd.h>
+#include <poll.h>
+
+/*
+ * Wire format of graph_server. All integers are little-endian uint32,
+ * whatever the byte order of either host.
+ *
+ * A request is one batch:
+ *
+ *   REQUEST_MAGIC count
+ *   count times: op arg0 arg1 arg2 length <length bytes>
+ *
+ * and is answered by one response with a result per query, in order:
+ *
+ *   RESPONSE_MAGIC count
+ *   count times: status length <length bytes>
+ *
+ * Vertices are addressed by id (0..n-1, the compact_graph index); LOOKUP
+ * and LABEL translate between ids and labels.
+ *
+ *   op         arguments             result payload
+ *   LOOKUP     label bytes           id
+ *   LABEL      arg0 = id             label bytes
+ *   DEGREE     arg0 = id             degree
+ *   NEIGHBORS  arg0 = id             neighbor ids, ascending
+ *   EDGE       arg0, arg1 = ids      1 if the edge exists, else 0
+ *   DISTANCE   arg0, arg1 = ids,     hop count, or UNREACHABLE if the
+ *              arg2 = max hops (0    vertices are further apart than
+ *              for no limit)         max hops
+ *   STATS      -                     latency histograms as text
+ */
+namespace graph_protocol {
+	const uint32_t REQUEST_MAGIC = 0x59525147;  /* "GQRY" */
+	const uint32_t RESPONSE_MAGIC = 0x50535247; /* "GRSP" */
+
+	const uint32_t MAX_BATCH = 1 << 20;
+	const uint32_t MAX_LENGTH = 1 << 20;
+
+	const uint32_t UNREACHABLE = 0xffffffff;
+
+	enum operation {
+		LOOKUP = 1,
+		LABEL = 2,
+		DEGREE = 3,
+		NEIGHBORS = 4,
+		EDGE = 5,
+		DISTANCE = 6,
+		STATS = 7,
+		NUM_OPERATIONS = 8
+	};
+
+	enum status {
+		OK = 0,
+		NOT_FOUND = 1,
+		BAD_REQUEST = 2
+	};
+
+	inline const char * operation_name(uint32_t op) {
+		static const char *names[] = { "batch", "lookup", "label", "degree", "neighbors", "edge", "distance", "stats" };
+		return op < NUM_OPERATIONS ? names[op] : "unknown";
+	}
+
+	struct query {
+		uint32_t op;
+		uint32_t arg0;
+		uint32_t arg1;
+		uint32_t arg2;
+		std::string text;
+	};
+
+	struct result {
+		uint32_t status;
+		std::vector<char> payload;
+	};
+
+	/* little-endian, whatever the byte order of the host */
+	inline void append(std::vector<char> &buffer, uint32_t value) {
+		char bytes[4];
+		for(int ii = 0; ii < 4; ii++) {
+			bytes[ii] = (char)((value >> (8 * ii)) & 0xff);
+		}
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(bytes));
+	}
+
+	inline void append(std::vector<char> &buffer, const void *data, size_t length) {
+		const char *bytes = static_cast<const char *>(data);
+		buffer.insert(buffer.end(), bytes, bytes + length);
+	}
+
+	inline uint32_t decode(const char *data) {
+		const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+		return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+	}
+
+	/*
+	 * Writes all of buffer to fd, which may be non-blocking; throws if
+	 * the peer accepts nothing for timeout milliseconds (-1 waits forever).
+	 */
+	inline void write_fully(int fd, const void *buffer, size_t length, int timeout=-1) {
+		const char *position = static_cast<const char *>(buffer);
+		size_t done = 0;
+		while(done < length) {
+			ssize_t count = ::write(fd, position + done, length - done);
+			if(count < 0) {
+				if(errno == EINTR) {
+					continue;
+				}
+				else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+					struct pollfd descriptor;
+					descriptor.fd = fd;
+					descriptor.events = POLLOUT;
+					descriptor.revents = 0;
+					int ready = ::poll(&descriptor, 1, timeout);
+					if(ready == 0) {
+						throw std::runtime_error("timed out sending response");
+					}
+					else if(ready < 0 && errno != EINTR) {
+						throw std::runtime_error(strerror(errno));
+					}
+					continue;
+				}
+				throw std::runtime_error(strerror(errno));
+			}
+			done += count;
+		}
+	}
+
+	/*
+	 * Assembles request batches from bytes as they arrive, so that a
+	 * server can read whatever a socket has without waiting for the rest
+	 * of a batch. Records are parsed as soon as they are complete.
+	 */
+	class request_reader {
+		public:
+			request_reader() : position(0), started(false), count(0) {
+
+			}
+
+			void append(const char *data, size_t length) {
+				buffer.insert(buffer.end(), data, data + length);
+			}
+
+			/* true if part of a batch has arrived but not all of it */
+			bool partial() const {
+				return started || !buffer.empty();
+			}
+
+			/*
+			 * Moves the next complete batch into batch and returns true, or
+			 * returns false until more bytes arrive. Throws on bytes that
+			 * cannot be a batch.
+			 */
+			bool next(std::vector<query> &batch) {
+				bool complete = parse();
+				buffer.erase(buffer.begin(), buffer.begin() + position);
+				position = 0;
+				if(complete) {
+					batch.swap(queries);
+					queries.clear();
+					started = false;
+				}
+				return complete;
+			}
+
+		protected:
+			std::vector<char> buffer;
+			size_t position;
+
+			bool started;
+			uint32_t count;
+			std::vector<query> queries;
+
+			size_t available() const {
+				return buffer.size() - position;
+			}
+
+			bool parse() {
+				if(!started) {
+					if(available() < 2 * sizeof(uint32_t)) {
+						return false;
+					}
+					uint32_t magic = decode(&buffer[position]);
+					count = decode(&buffer[position + 4]);
+					if(magic != REQUEST_MAGIC || count > MAX_BATCH) {
+						throw std::runtime_error("malformed request header");
+					}
+					position += 2 * sizeof(uint32_t);
+					started = true;
+				}
+
+				while(queries.size() < count) {
+					if(available() < 5 * sizeof(uint32_t)) {
+						return false;
+					}
+					uint32_t length = decode(&buffer[position + 16]);
+					if(length > MAX_LENGTH) {
+						throw std::runtime_error("request payload too long");
+					}
+					if(available() - 5 * sizeof(uint32_t) < length) {
+						return false;
+					}
+
+					query current;
+					current.op = decode(&buffer[position]);
+					current.arg0 = decode(&buffer[position + 4]);
+					current.arg1 = decode(&buffer[position + 8]);
+					current.arg2 = decode(&buffer[position + 12]);
+					current.text.assign(buffer.begin() + position + 20, buffer.begin() + position + 20 + length);
+					queries.push_back(current);
+					position += 5 * sizeof(uint32_t) + length;
+				}
+				return true;
+			}
+	};
+
+	inline void write_response(int fd, const std::vector<result> &results, int timeout=-1) {
+		std::vector<char> buffer;
+		append(buffer, RESPONSE_MAGIC);
+		append(buffer, (uint32_t)results.size());
+
+		std::vector<result>::const_iterator iter = results.begin();
+		for(; iter != results.end(); ++iter) {
+			append(buffer, iter->status);
+			append(buffer, (uint32_t)iter->payload.size());
+			if(!iter->payload.empty()) {
+				append(buffer, &iter->payload[0], iter->payload.size());
+			}
+		}
+
+		write_fully(fd, &buffer[0], buffer.size(), timeout);
+	}
+}
+
+#endif
@@ -0,0 +1,630 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+#include <algorithm>
+
+#include <stdexcept>
+
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "graph.hh"
+#include "compact_graph.hh"
+#include "graph_builder.hh"
+#include "label_list.hh"
+#include "read_graph.hh"
+#include "graph_protocol.hh"
+
+/*
+ * Counts of latencies in power-of-two microsecond buckets; bucket ii
+ * holds latencies below 2^ii microseconds that did not fit bucket ii-1.
+ */
+class latency_histogram {
+	public:
+		static const unsigned int NUM_BUCKETS = 32;
+
+		latency_histogram() : count(0), total(0), maximum(0) {
+			for(unsigned int ii = 0; ii < NUM_BUCKETS; ii++) {
+				buckets[ii] = 0;
+			}
+		}
+
+		void record(uint64_t micros) {
+			unsigned int bucket = 0;
+			while(bucket + 1 < NUM_BUCKETS && (uint64_t(1) << bucket) <= micros) {
+				bucket++;
+			}
+
+			buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+			count.fetch_add(1, std::memory_order_relaxed);
+			total.fetch_add(micros, std::memory_order_relaxed);
+
+			uint64_t highest = maximum.load(std::memory_order_relaxed);
+			while(micros > highest && !maximum.compare_exchange_weak(highest, micros, std::memory_order_relaxed)) {
+
+			}
+		}
+
+		/* upper bucket bound below which the given fraction of samples fall */
+		uint64_t quantile(double fraction) const {
+			uint64_t samples = count.load(std::memory_order_relaxed);
+			uint64_t wanted = (uint64_t)(fraction * samples + 0.5);
+			uint64_t seen = 0;
+			for(unsigned int ii = 0; ii < NUM_BUCKETS; ii++) {
+				seen += buckets[ii].load(std::memory_order_relaxed);
+				if(seen >= wanted && seen > 0) {
+					return uint64_t(1) << ii;
+				}
+			}
+			return 0;
+		}
+
+		std::ostream & serialize(std::ostream &output, const std::string &name) const {
+			uint64_t samples = count.load(std::memory_order_relaxed);
+
+			output << std::left << std::setw(10) << name << std::right;
+			output << " count=" << samples;
+			output << " mean_us=" << (samples ? total.load(std::memory_order_relaxed) / samples : 0);
+			output << " p50_us<" << quantile(0.50);
+			output << " p90_us<" << quantile(0.90);
+			output << " p99_us<" << quantile(0.99);
+			output << " max_us=" << maximum.load(std::memory_order_relaxed);
+			output << std::endl;
+			if(samples == 0) {
+				return output;
+			}
+
+			output << "          ";
+			for(unsigned int ii = 0; ii < NUM_BUCKETS; ii++) {
+				uint64_t bucket = buckets[ii].load(std::memory_order_relaxed);
+				if(bucket != 0) {
+					output << " <" << (uint64_t(1) << ii) << ":" << bucket;
+				}
+			}
+			output << std::endl;
+
+			return output;
+		}
+
+	protected:
+		std::atomic<uint64_t> buckets[NUM_BUCKETS];
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> total;
+		std::atomic<uint64_t> maximum;
+};
+
+/*
+ * Serves graph_protocol batches over a Unix domain socket. One dispatcher
+ * thread polls the listening socket and every idle connection, reading
+ * whatever arrives into the connection's request_reader without
+ * blocking. Once a whole batch is in, the connection and its queries go
+ * to the worker pool, and the worker that answered hands the connection
+ * back to the dispatcher; a client that stalls mid-batch ties up only
+ * its own buffer, never a worker.
+ */
+class graph_server {
+	public:
+		typedef compact_graph<std::string *> graph_type;
+		typedef graph_type::index_type index_type;
+		typedef graph_type::size_type size_type;
+
+		/* longest wait for a client to accept response bytes, in milliseconds */
+		static const int SEND_TIMEOUT = 10000;
+
+		graph_server(const graph_type &graph, const label_list<std::string> &labels, const std::string &path, unsigned int num_workers) : graph(graph), labels(labels), path(path), listener(-1), stopping(false) {
+			if(pipe(wake) != 0) {
+				throw std::runtime_error(std::string("pipe: ") + strerror(errno));
+			}
+			fcntl(wake[0], F_SETFL, O_NONBLOCK);
+
+			listener = socket(AF_UNIX, SOCK_STREAM, 0);
+			if(listener < 0) {
+				throw std::runtime_error(std::string("socket: ") + strerror(errno));
+			}
+
+			struct sockaddr_un address;
+			memset(&address, 0, sizeof(address));
+			address.sun_family = AF_UNIX;
+			if(path.size() >= sizeof(address.sun_path)) {
+				throw std::runtime_error(path + ": socket path too long");
+			}
+			strcpy(address.sun_path, path.c_str());
+
+			unlink(path.c_str());
+			if(bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 64) != 0) {
+				std::ostringstream oss;
+				oss << path << ": " << strerror(errno);
+
+				throw std::runtime_error(oss.str());
+			}
+
+			for(unsigned int ii = 0; ii < num_workers; ii++) {
+				workers.push_back(std::thread(&graph_server::work, this));
+			}
+		}
+
+		~graph_server() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			ready.notify_all();
+
+			for(size_type ii = 0; ii < workers.size(); ii++) {
+				workers[ii].join();
+			}
+
+			std::map<int,graph_protocol::request_reader>::const_iterator iter = readers.begin();
+			for(; iter != readers.end(); ++iter) {
+				close(iter->first);
+			}
+
+			close(listener);
+			close(wake[0]);
+			close(wake[1]);
+			unlink(path.c_str());
+		}
+
+		/* dispatches connections until stop becomes non-zero */
+		void serve(const volatile sig_atomic_t &stop) {
+			std::vector<struct pollfd> descriptors;
+			while(!stop) {
+				descriptors.clear();
+				add_descriptor(descriptors, listener);
+				add_descriptor(descriptors, wake[0]);
+
+				std::set<int>::const_iterator iter = idle.begin();
+				for(; iter != idle.end(); ++iter) {
+					add_descriptor(descriptors, *iter);
+				}
+
+				if(poll(&descriptors[0], descriptors.size(), 500) < 0) {
+					if(errno == EINTR) {
+						continue;
+					}
+					throw std::runtime_error(std::string("poll: ") + strerror(errno));
+				}
+
+				if(descriptors[0].revents & POLLIN) {
+					int connection = accept(listener, NULL, NULL);
+					if(connection >= 0) {
+						fcntl(connection, F_SETFL, fcntl(connection, F_GETFL) | O_NONBLOCK);
+						readers[connection];
+						idle.insert(connection);
+					}
+				}
+
+				if(descriptors[1].revents & POLLIN) {
+					char buffer[64];
+					while(read(wake[0], buffer, sizeof(buffer)) > 0) {
+
+					}
+
+					std::vector<int> back;
+					std::vector<int> failed;
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						back.swap(returned);
+						failed.swap(dropped);
+					}
+					for(size_type ii = 0; ii < failed.size(); ii++) {
+						disconnect(failed[ii]);
+					}
+					/* a client may have sent its next batch along with the last */
+					for(size_type ii = 0; ii < back.size(); ii++) {
+						idle.insert(back[ii]);
+						dispatch(back[ii]);
+					}
+				}
+
+				for(size_type ii = 2; ii < descriptors.size(); ii++) {
+					if(descriptors[ii].revents & (POLLIN | POLLHUP | POLLERR)) {
+						receive(descriptors[ii].fd);
+					}
+				}
+			}
+		}
+
+		std::ostream & statistics(std::ostream &output) const {
+			for(uint32_t op = 0; op < graph_protocol::NUM_OPERATIONS; op++) {
+				histograms[op].serialize(output, graph_protocol::operation_name(op));
+			}
+			return output;
+		}
+
+	protected:
+		/* bidirectional breadth-first search state owned by one worker */
+		struct search_state {
+			std::vector<uint32_t> distance[2];
+			std::vector<index_type> touched[2];
+			std::vector<index_type> frontier[2];
+			std::vector<index_type> next;
+
+			search_state(size_type num_vertices) {
+				distance[0].assign(num_vertices, graph_protocol::UNREACHABLE);
+				distance[1].assign(num_vertices, graph_protocol::UNREACHABLE);
+			}
+
+			void reset() {
+				for(int side = 0; side < 2; side++) {
+					for(size_type ii = 0; ii < touched[side].size(); ii++) {
+						distance[side][touched[side][ii]] = graph_protocol::UNREACHABLE;
+					}
+					touched[side].clear();
+					frontier[side].clear();
+				}
+			}
+		};
+
+		/* a connection with a whole batch to answer */
+		struct job {
+			int connection;
+			std::vector<graph_protocol::query> queries;
+		};
+
+		const graph_type &graph;
+		const label_list<std::string> &labels;
+		std::string path;
+
+		int listener;
+		int wake[2];
+
+		/* every open connection, owned by the dispatcher */
+		std::map<int,graph_protocol::request_reader> readers;
+		std::set<int> idle;
+
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable ready;
+		std::deque<job> pending;
+		std::vector<int> returned;
+		std::vector<int> dropped;
+		bool stopping;
+
+		latency_histogram histograms[graph_protocol::NUM_OPERATIONS];
+
+		static void add_descriptor(std::vector<struct pollfd> &descriptors, int fd) {
+			struct pollfd descriptor;
+			descriptor.fd = fd;
+			descriptor.events = POLLIN;
+			descriptor.revents = 0;
+			descriptors.push_back(descriptor);
+		}
+
+		/* reads what an idle connection has sent, without blocking */
+		void receive(int connection) {
+			graph_protocol::request_reader &reader = readers[connection];
+			char buffer[1 << 16];
+			for(;;) {
+				ssize_t count = read(connection, buffer, sizeof(buffer));
+				if(count > 0) {
+					reader.append(buffer, count);
+				}
+				else if(count < 0 && errno == EINTR) {
+					continue;
+				}
+				else if(count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+					break;
+				}
+				else {
+					if(count < 0) {
+						std::cerr << path << ": " << strerror(errno) << std::endl;
+					}
+					else if(reader.partial()) {
+						std::cerr << path << ": connection closed mid-message" << std::endl;
+					}
+					disconnect(connection);
+					return;
+				}
+			}
+			dispatch(connection);
+		}
+
+		/* hands an idle connection to the workers once it holds a whole batch */
+		void dispatch(int connection) {
+			std::vector<graph_protocol::query> queries;
+			try {
+				if(!readers[connection].next(queries)) {
+					return;
+				}
+			}
+			catch(std::exception &e) {
+				std::cerr << path << ": " << e.what() << std::endl;
+				disconnect(connection);
+				return;
+			}
+
+			idle.erase(connection);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				pending.push_back(job());
+				pending.back().connection = connection;
+				pending.back().queries.swap(queries);
+			}
+			ready.notify_one();
+		}
+
+		void disconnect(int connection) {
+			idle.erase(connection);
+			readers.erase(connection);
+			close(connection);
+		}
+
+		static uint64_t elapsed(const std::chrono::steady_clock::time_point &start) {
+			return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		void work() {
+			search_state state(graph.size_vertices());
+			std::vector<graph_protocol::query> queries;
+			std::vector<graph_protocol::result> results;
+
+			for(;;) {
+				int connection;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					while(pending.empty() && !stopping) {
+						ready.wait(lock);
+					}
+					if(stopping) {
+						return;
+					}
+					connection = pending.front().connection;
+					queries.swap(pending.front().queries);
+					pending.pop_front();
+				}
+
+				bool keep = false;
+				try {
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+					results.resize(queries.size());
+					for(size_type ii = 0; ii < queries.size(); ii++) {
+						std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+						answer(queries[ii], results[ii], state);
+						if(queries[ii].op < graph_protocol::NUM_OPERATIONS) {
+							histograms[queries[ii].op].record(elapsed(begin));
+						}
+					}
+
+					graph_protocol::write_response(connection, results, SEND_TIMEOUT);
+					histograms[0].record(elapsed(start));
+					keep = true;
+				}
+				catch(std::exception &e) {
+					std::cerr << path << ": " << e.what() << std::endl;
+				}
+
+				/* the dispatcher owns the connection, so it closes failed ones too */
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					(keep ? returned : dropped).push_back(connection);
+				}
+				char byte = 0;
+				if(write(wake[1], &byte, 1) < 0) {
+					std::cerr << path << ": " << strerror(errno) << std::endl;
+				}
+			}
+		}
+
+		bool valid(uint32_t vertex) const {
+			return vertex < graph.size_vertices();
+		}
+
+		void answer(const graph_protocol::query &query, graph_protocol::result &result, search_state &state) {
+			result.status = graph_protocol::OK;
+			result.payload.clear();
+
+			switch(query.op) {
+				case graph_protocol::LOOKUP: {
+					label_list<std::string>::const_iterator label_iter = labels.find(query.text);
+					size_type index = graph.size_vertices();
+					if(label_iter != labels.end()) {
+						index = graph.index(label_iter->second);
+					}
+
+					if(index == graph.size_vertices()) {
+						result.status = graph_protocol::NOT_FOUND;
+					}
+					else {
+						graph_protocol::append(result.payload, (uint32_t)index);
+					}
+					break;
+				}
+				case graph_protocol::LABEL: {
+					if(!valid(query.arg0)) {
+						result.status = graph_protocol::NOT_FOUND;
+					}
+					else {
+						const std::string &label = *graph.vertex(query.arg0);
+						graph_protocol::append(result.payload, label.data(), label.size());
+					}
+					break;
+				}
+				case graph_protocol::DEGREE: {
+					if(!valid(query.arg0)) {
+						result.status = graph_protocol::NOT_FOUND;
+					}
+					else {
+						graph_protocol::append(result.payload, (uint32_t)graph.degree(query.arg0));
+					}
+					break;
+				}
+				case graph_protocol::NEIGHBORS: {
+					if(!valid(query.arg0)) {
+						result.status = graph_protocol::NOT_FOUND;
+					}
+					else if(graph.degree(query.arg0) > 0) {
+						graph_type::const_neighbor_iterator iter = graph.begin_neighbors(query.arg0);
+						for(; iter != graph.end_neighbors(query.arg0); ++iter) {
+							graph_protocol::append(result.payload, (uint32_t)*iter);
+						}
+					}
+					break;
+				}
+				case graph_protocol::EDGE: {
+					if(!valid(query.arg0) || !valid(query.arg1)) {
+						result.status = graph_protocol::NOT_FOUND;
+					}
+					else {
+						graph_protocol::append(result.payload, (uint32_t)graph.has_edge(query.arg0, query.arg1));
+					}
+					break;
+				}
+				case graph_protocol::DISTANCE: {
+					if(!valid(query.arg0) || !valid(query.arg1)) {
+						result.status = graph_protocol::NOT_FOUND;
+					}
+					else {
+						graph_protocol::append(result.payload, distance(query.arg0, query.arg1, query.arg2, state));
+					}
+					break;
+				}
+				case graph_protocol::STATS: {
+					std::ostringstream oss;
+					statistics(oss);
+					std::string text = oss.str();
+					graph_protocol::append(result.payload, text.data(), text.size());
+					break;
+				}
+				default: {
+					result.status = graph_protocol::BAD_REQUEST;
+					break;
+				}
+			}
+		}
+
+		/*
+		 * Hop distance by breadth-first search from both ends, always
+		 * growing the side with the smaller frontier by one level.
+		 */
+		uint32_t distance(index_type src, index_type dst, uint32_t max_hops, search_state &state) const {
+			if(src == dst) {
+				return 0;
+			}
+
+			index_type ends[2] = { src, dst };
+			uint32_t depth[2] = { 0, 0 };
+			for(int side = 0; side < 2; side++) {
+				state.distance[side][ends[side]] = 0;
+				state.touched[side].push_back(ends[side]);
+				state.frontier[side].push_back(ends[side]);
+			}
+
+			uint32_t best = graph_protocol::UNREACHABLE;
+			while(!state.frontier[0].empty() && !state.frontier[1].empty()) {
+				if(max_hops != 0 && depth[0] + depth[1] >= max_hops) {
+					break;
+				}
+
+				int side = state.frontier[0].size() <= state.frontier[1].size() ? 0 : 1;
+				std::vector<uint32_t> &mine = state.distance[side];
+				const std::vector<uint32_t> &theirs = state.distance[1-side];
+
+				state.next.clear();
+				for(size_type ii = 0; ii < state.frontier[side].size(); ii++) {
+					index_type vertex = state.frontier[side][ii];
+					graph_type::const_neighbor_iterator iter = graph.begin_neighbors(vertex);
+					for(; iter != graph.end_neighbors(vertex); ++iter) {
+						if(mine[*iter] == graph_protocol::UNREACHABLE) {
+							mine[*iter] = depth[side] + 1;
+							state.touched[side].push_back(*iter);
+							state.next.push_back(*iter);
+
+							if(theirs[*iter] != graph_protocol::UNREACHABLE && depth[side] + 1 + theirs[*iter] < best) {
+								best = depth[side] + 1 + theirs[*iter];
+							}
+						}
+					}
+				}
+
+				depth[side]++;
+				state.frontier[side].swap(state.next);
+
+				if(best != graph_protocol::UNREACHABLE) {
+					break;
+				}
+			}
+
+			state.reset();
+			if(max_hops != 0 && best != graph_protocol::UNREACHABLE && best > max_hops) {
+				return graph_protocol::UNREACHABLE;
+			}
+			return best;
+		}
+};
+
+volatile sig_atomic_t stop_requested = 0;
+
+void request_stop(int) {
+	stop_requested = 1;
+}
+
+/* parses a whole decimal argument into value if it lies in [min, max] */
+bool parse_argument(const char *text, unsigned long min, unsigned long max, unsigned long &value) {
+	char *end = NULL;
+	errno = 0;
+	unsigned long parsed = strtoul(text, &end, 10);
+	if(end == text || *end != '\0' || errno != 0 || text[0] == '-' || parsed < min || parsed > max) {
+		return false;
+	}
+	value = parsed;
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	const unsigned long MAX_WORKERS = 1024;
+
+	std::string filename = argc > 1 ? argv[1] : "../data/semmedminer.nt";
+	std::string path = argc > 2 ? argv[2] : "graph.sock";
+	unsigned long num_workers = std::max(std::thread::hardware_concurrency(), 1u);
+
+	if(argc > 4 || (argc > 3 && !parse_argument(argv[3], 1, MAX_WORKERS, num_workers))) {
+		std::cerr << "usage: " << argv[0] << " [file.nt [socket path [workers 1-" << MAX_WORKERS << "]]]" << std::endl;
+		return 1;
+	}
+
+	label_list<std::string> labels;
+	compact_graph<std::string *> compact;
+	{
+		graph_builder<std::string *> builder;
+		read_graph(filename, builder, labels);
+		builder.build(compact);
+	}
+
+	std::cerr << filename << ": " << compact.size_vertices() << " vertices, " << compact.size_edges() << " edges" << std::endl;
+
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, request_stop);
+	signal(SIGTERM, request_stop);
+
+	graph_server server(compact, labels, path, (unsigned int)num_workers);
+	std::cerr << path << ": serving with " << num_workers << " workers" << std::endl;
+	server.serve(stop_requested);
+
+	server.statistics(std::cerr);
+
+	return 0;
+}
@@ -0,0 +1,370 @@
+#include <iostream>
+#include <iomanip>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+
+#include <algorithm>
+
+#include <new>
+#include <stdexcept>
+
+#include <cmath>
+#include <cerrno>
+#include <cstdlib>
+#include <cstdint>
+
+#include "ntriples.hh"
+#include "hashing.hh"
+#include "hyperloglog.hh"
+#include "count_min.hh"
+#include "triangle_sampler.hh"
+
+/*
+ * One pass over an N-Triples file keeping only fixed-size summaries:
+ *
+ *   distinct vertices and edges   HyperLogLog
+ *   highest degree vertices       Count-Min with a top-k list
+ *   degree distribution           hash-sampled vertices with exact degrees
+ *   triangles                     TRIEST reservoir behind a Bloom filter
+ *   triples per predicate         exact for the first 4096 predicates
+ *
+ * As in read_graph, subjects and objects are vertices and each triple is
+ * an undirected edge between them. Degrees count triples, so repeated
+ * triples and predicates between the same pair add to them.
+ */
+
+/* the k largest Count-Min estimates seen, with their labels */
+class heavy_hitters {
+	public:
+		typedef size_t size_type;
+
+		struct entry {
+			uint64_t hash;
+			uint64_t count;
+			std::string label;
+
+			bool operator<(const entry &other) const {
+				return count > other.count || (count == other.count && label < other.label);
+			}
+		};
+
+		explicit heavy_hitters(size_type capacity) : capacity(capacity), floor(0) {
+
+		}
+
+		void offer(uint64_t hash, uint64_t count, const ntriples::term &label) {
+			if(capacity == 0 || (entries.size() == capacity && count <= floor)) {
+				return;
+			}
+
+			size_type lowest = 0;
+			for(size_type ii = 0; ii < entries.size(); ii++) {
+				if(entries[ii].hash == hash) {
+					entries[ii].count = count;
+					update_floor();
+					return;
+				}
+				else if(entries[ii].count < entries[lowest].count) {
+					lowest = ii;
+				}
+			}
+
+			entry current;
+			current.hash = hash;
+			current.count = count;
+			current.label = label.str();
+			if(entries.size() < capacity) {
+				entries.push_back(current);
+			}
+			else {
+				entries[lowest] = current;
+			}
+			update_floor();
+		}
+
+		std::vector<entry> sorted() const {
+			std::vector<entry> result(entries);
+			std::sort(result.begin(), result.end());
+			return result;
+		}
+
+	protected:
+		size_type capacity;
+		uint64_t floor;
+		std::vector<entry> entries;
+
+		void update_floor() {
+			if(entries.size() == capacity) {
+				floor = entries[0].count;
+				for(size_type ii = 1; ii < entries.size(); ii++) {
+					floor = std::min(floor, entries[ii].count);
+				}
+			}
+		}
+};
+
+/*
+ * Exact degrees of the vertices whose hash falls below a threshold. The
+ * threshold halves whenever more than capacity vertices qualify, so each
+ * sampled vertex stands for 2^level vertices and, because the test only
+ * depends on the hash, every triple of a sampled vertex is counted.
+ */
+class degree_sampler {
+	public:
+		typedef size_t size_type;
+
+		static const unsigned int NUM_BUCKETS = 64;
+
+		explicit degree_sampler(size_type capacity) : capacity(capacity), level(0) {
+			degrees.reserve(capacity + 1);
+		}
+
+		void insert(uint64_t hash) {
+			uint64_t key = hashing::mix(hash);
+			if(!sampled(key)) {
+				return;
+			}
+
+			degrees[key]++;
+			while(degrees.size() > capacity) {
+				level++;
+				std::unordered_map<uint64_t,uint64_t>::iterator iter = degrees.begin();
+				while(iter != degrees.end()) {
+					if(sampled(iter->first)) {
+						++iter;
+					}
+					else {
+						iter = degrees.erase(iter);
+					}
+				}
+			}
+		}
+
+		double scale() const {
+			return std::ldexp(1.0, (int)level);
+		}
+
+		size_type size_sample() const {
+			return degrees.size();
+		}
+
+		/* histogram[b] counts sampled vertices with degree in [2^b, 2^(b+1)) */
+		std::vector<uint64_t> histogram() const {
+			std::vector<uint64_t> result(NUM_BUCKETS, 0);
+			std::unordered_map<uint64_t,uint64_t>::const_iterator iter = degrees.begin();
+			for(; iter != degrees.end(); ++iter) {
+				result[63 - __builtin_clzll(iter->second)]++;
+			}
+			return result;
+		}
+
+	protected:
+		size_type capacity;
+		unsigned int level;
+		std::unordered_map<uint64_t,uint64_t> degrees;
+
+		bool sampled(uint64_t key) const {
+			return level == 0 || (key >> (64 - level)) == 0;
+		}
+};
+
+/*
+ * Bloom filter over edges, so that a repeated edge is not taken for a
+ * new one once the triangle reservoir has evicted it. A false positive
+ * drops a new edge, which the report accounts for.
+ */
+class edge_filter {
+	public:
+		typedef size_t size_type;
+
+		static const unsigned int NUM_PROBES = 3;
+
+		/* from one 64-bit word up to 2^36 bits (8GB) */
+		static const unsigned int MIN_LOG_BITS = 6;
+		static const unsigned int MAX_LOG_BITS = 36;
+
+		explicit edge_filter(unsigned int log_bits) : mask(((uint64_t)1 << log_bits) - 1), bits(((size_type)1 << log_bits) / 64, 0), filled(0) {
+
+		}
+
+		/* false if the edge was (probably) seen before */
+		bool insert(uint64_t hash) {
+			bool fresh = false;
+			uint64_t step = hashing::mix(hash) | 1;
+			for(unsigned int ii = 0; ii < NUM_PROBES; ii++) {
+				uint64_t bit = (hash + ii * step) & mask;
+				uint64_t &word = bits[bit / 64];
+				uint64_t flag = (uint64_t)1 << (bit % 64);
+				if(!(word & flag)) {
+					word |= flag;
+					filled++;
+					fresh = true;
+				}
+			}
+			return fresh;
+		}
+
+		/* chance that a new edge is taken for a repeat, at the current fill */
+		double false_positive_rate() const {
+			return std::pow((double)filled / (double)(mask + 1), (double)NUM_PROBES);
+		}
+
+		size_type memory_usage() const {
+			return bits.capacity() * sizeof(uint64_t) + sizeof(*this);
+		}
+
+	protected:
+		uint64_t mask;
+		std::vector<uint64_t> bits;
+		size_type filled;
+};
+
+/* parses a whole decimal argument into value if it lies in [min, max] */
+bool parse_argument(const char *text, unsigned long min, unsigned long max, unsigned long &value) {
+	char *end = NULL;
+	errno = 0;
+	unsigned long parsed = strtoul(text, &end, 10);
+	if(end == text || *end != '\0' || errno != 0 || text[0] == '-' || parsed < min || parsed > max) {
+		return false;
+	}
+	value = parsed;
+	return true;
+}
+
+/* reads filename once and prints the summaries; throws if it cannot be read */
+void summarize(const std::string &filename, size_t reservoir, unsigned int precision, unsigned int filter_bits) {
+	const size_t NUM_HEAVY = 20;
+	const size_t NUM_SAMPLED = 1 << 16;
+	const size_t MAX_PREDICATES = 4096;
+
+	hyperloglog vertices(precision);
+	hyperloglog edges(precision);
+	hyperloglog predicates(precision);
+	count_min degrees;
+	heavy_hitters hubs(NUM_HEAVY);
+	degree_sampler distribution(NUM_SAMPLED);
+	triangle_sampler triangles(reservoir);
+	edge_filter repeats(filter_bits);
+
+	std::unordered_map<uint64_t,std::pair<std::string,uint64_t> > predicate_counts;
+	uint64_t other_predicates = 0;
+	uint64_t num_triples = 0;
+	uint64_t num_loops = 0;
+
+	ntriples::reader reader(filename);
+	ntriples::triple triple;
+	while(reader.next(triple)) {
+		num_triples++;
+
+		uint64_t src = hashing::bytes(triple.subject.data, triple.subject.length);
+		uint64_t edg = hashing::bytes(triple.predicate.data, triple.predicate.length);
+		uint64_t dst = hashing::bytes(triple.object.data, triple.object.length);
+
+		vertices.insert(src);
+		vertices.insert(dst);
+		uint64_t edge = src < dst ? hashing::combine(src, dst) : hashing::combine(dst, src);
+		edges.insert(edge);
+		predicates.insert(edg);
+
+		hubs.offer(src, degrees.insert(src), triple.subject);
+		distribution.insert(src);
+		if(src != dst) {
+			hubs.offer(dst, degrees.insert(dst), triple.object);
+			distribution.insert(dst);
+		}
+		else {
+			num_loops++;
+		}
+
+		if(repeats.insert(edge)) {
+			triangles.insert(src, dst);
+		}
+
+		std::unordered_map<uint64_t,std::pair<std::string,uint64_t> >::iterator predicate_iter = predicate_counts.find(edg);
+		if(predicate_iter != predicate_counts.end()) {
+			predicate_iter->second.second++;
+		}
+		else if(predicate_counts.size() < MAX_PREDICATES) {
+			predicate_counts[edg] = std::make_pair(triple.predicate.str(), (uint64_t)1);
+		}
+		else {
+			other_predicates++;
+		}
+	}
+
+	std::cout << std::fixed << std::setprecision(0);
+	std::cout << "triples " << num_triples << std::endl;
+	std::cout << "self-loops " << num_loops << std::endl;
+	std::cout << "vertices ~" << vertices.estimate() << " (+/- " << std::setprecision(2) << 100 * vertices.relative_error() << "% std. error)" << std::setprecision(0) << std::endl;
+	std::cout << "edges ~" << edges.estimate() << " (+/- " << std::setprecision(2) << 100 * edges.relative_error() << "% std. error)" << std::setprecision(0) << std::endl;
+	std::cout << "predicates ~" << predicates.estimate() << std::endl;
+	std::cout << "sketch memory " << vertices.memory_usage() + edges.memory_usage() + predicates.memory_usage() + degrees.memory_usage() + repeats.memory_usage() << " bytes plus a reservoir of " << triangles.max_sample() << " edges" << std::endl;
+
+	std::cout << "triangles ~" << triangles.estimate();
+	if(triangles.exact()) {
+		std::cout << " (exact)" << std::endl;
+	}
+	else {
+		std::cout << " (+/- " << triangles.standard_error() << " std. error, " << triangles.size_sample() << " of " << triangles.size_stream() << " edges sampled)" << std::endl;
+	}
+	if(repeats.false_positive_rate() >= 0.0001) {
+		std::cout << "  up to " << std::setprecision(2) << 100 * repeats.false_positive_rate() << "% of edges were taken for repeats and skipped; about three times that share of triangles is missing" << std::setprecision(0) << std::endl;
+	}
+
+	std::cout << std::endl << "highest degree (over by at most " << std::ceil(degrees.epsilon() * degrees.total()) << " with probability " << std::setprecision(4) << 1 - degrees.delta() << std::setprecision(0) << ")" << std::endl;
+	std::vector<heavy_hitters::entry> top = hubs.sorted();
+	for(size_t ii = 0; ii < top.size(); ii++) {
+		std::cout << std::setw(12) << top[ii].count << " " << top[ii].label << std::endl;
+	}
+
+	std::cout << std::endl << "degree distribution (" << distribution.size_sample() << " vertices sampled, each standing for " << distribution.scale() << ")" << std::endl;
+	std::vector<uint64_t> histogram = distribution.histogram();
+	for(unsigned int bucket = 0; bucket < histogram.size(); bucket++) {
+		if(histogram[bucket] != 0) {
+			std::cout << std::setw(12) << ((uint64_t)1 << bucket) << "-" << std::left << std::setw(12) << ((uint64_t)2 << bucket) - 1 << std::right << " ~" << histogram[bucket] * distribution.scale() << std::endl;
+		}
+	}
+
+	std::cout << std::endl << "triples per predicate" << std::endl;
+	std::vector<std::pair<uint64_t,std::string> > by_count;
+	std::unordered_map<uint64_t,std::pair<std::string,uint64_t> >::const_iterator predicate_iter = predicate_counts.begin();
+	for(; predicate_iter != predicate_counts.end(); ++predicate_iter) {
+		by_count.push_back(std::make_pair(predicate_iter->second.second, predicate_iter->second.first));
+	}
+	std::sort(by_count.rbegin(), by_count.rend());
+	for(size_t ii = 0; ii < by_count.size(); ii++) {
+		std::cout << std::setw(12) << by_count[ii].first << " " << by_count[ii].second << std::endl;
+	}
+	if(other_predicates != 0) {
+		std::cout << std::setw(12) << other_predicates << " (other predicates)" << std::endl;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	std::string filename = argc > 1 ? argv[1] : "../data/semmedminer.nt";
+	unsigned long reservoir = (unsigned long)1 << 20;
+	unsigned long precision = 14;
+	unsigned long filter_bits = 28;
+
+	if(argc > 5 || (argc > 2 && !parse_argument(argv[2], 2, triangle_sampler::MAX_CAPACITY, reservoir)) || (argc > 3 && !parse_argument(argv[3], hyperloglog::MIN_PRECISION, hyperloglog::MAX_PRECISION, precision)) || (argc > 4 && !parse_argument(argv[4], edge_filter::MIN_LOG_BITS, edge_filter::MAX_LOG_BITS, filter_bits))) {
+		std::cerr << "usage: " << argv[0] << " [file.nt [reservoir edges 2-" << triangle_sampler::MAX_CAPACITY << " [precision " << hyperloglog::MIN_PRECISION << "-" << hyperloglog::MAX_PRECISION << " [filter log bits " << edge_filter::MIN_LOG_BITS << "-" << edge_filter::MAX_LOG_BITS << "]]]]" << std::endl;
+		return 1;
+	}
+
+	try {
+		summarize(filename, reservoir, (unsigned int)precision, (unsigned int)filter_bits);
+	}
+	catch(const std::bad_alloc &) {
+		std::cerr << "not enough memory for a reservoir of " << reservoir << " edges and a filter of 2^" << filter_bits << " bits" << std::endl;
+		return 1;
+	}
+	catch(const std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
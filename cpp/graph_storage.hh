@@ -0,0 +1,779 @@
+#ifndef _GRAPH_STORAGE_HH_
+#define _GRAPH_STORAGE_HH_
+
+#include <set>
+#include <vector>
+#include <utility>
+#include <limits>
+#include <iterator>
+
+#include <sstream>
+
+#include <algorithm>
+
+#include <stdexcept>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "memory_usage.hh"
+
+/*
+ * Storage policies for graph<V>. A policy names the vertex_set and
+ * edge_set types graph<V> keeps, and supplies the two operations whose
+ * best implementation depends on the layout. Both sets take the calls
+ * graph<V> makes of a std::set: insert, erase, find, lower_bound,
+ * upper_bound, size and ordered iteration with constant iterators.
+ *
+ * graph_storage<V>, the default, is tree_storage for every V; graphs of
+ * densely numbered integer vertices opt in to dense_storage with
+ * graph<V, dense_storage<V> >. The choice is made at compile time, so no
+ * call goes through a virtual function.
+ */
+
+/* ordered std::sets; works for any V with operator< */
+template <typename V>
+struct tree_storage {
+	typedef size_t size_type;
+
+	typedef V VERTEX;
+	typedef std::pair<VERTEX,VERTEX> EDGE;
+
+	typedef std::set<VERTEX, std::less<VERTEX>, counting_allocator<VERTEX> > vertex_set;
+	typedef std::set<EDGE, std::less<EDGE>, counting_allocator<EDGE> > edge_set;
+
+	static void remove_incident_edges(edge_set &edges, const VERTEX &vertex) {
+		typename edge_set::iterator edge_iter = edges.begin();
+		while(edge_iter != edges.end()) {
+			if(edge_iter->first == vertex || edge_iter->second == vertex) {
+				edges.erase(edge_iter++);
+			}
+			else {
+				++edge_iter;
+			}
+		}
+	}
+
+	static memory_report memory_usage(const vertex_set &vertices, const edge_set &edges) {
+		using namespace memory_accounting;
+
+		memory_report usage;
+		size_type num_vertices = vertices.size();
+		size_type num_edges = edges.size();
+
+		usage.nodes = (num_vertices + num_edges) * TREE_NODE_HEADER + 2 * sizeof(vertices) + 2 * sizeof(edges);
+		usage.keys = num_vertices * sizeof(VERTEX) + num_edges * sizeof(EDGE);
+		usage.strings = heap_bytes(vertices.begin(), vertices.end(), (const VERTEX *)NULL) + heap_bytes(edges.begin(), edges.end(), (const EDGE *)NULL);
+		usage.overhead = num_vertices * allocation_overhead(tree_node(sizeof(VERTEX))) + num_edges * allocation_overhead(tree_node(sizeof(EDGE)));
+
+		return usage;
+	}
+};
+
+/*
+ * Offsets of integer values from a base, computed in 64-bit unsigned
+ * arithmetic so that they are exact for any integral V, negative values
+ * included.
+ */
+template <typename V>
+struct dense_offsets {
+	typedef size_t size_type;
+
+	/* value - base, for value >= base */
+	static size_type offset(const V &base, const V &value) {
+		return (size_type)((uint64_t)value - (uint64_t)base);
+	}
+
+	static V value_at(const V &base, size_type offset) {
+		return (V)((uint64_t)base + offset);
+	}
+
+	static V value_before(const V &base, size_type offset) {
+		return (V)((uint64_t)base - offset);
+	}
+
+	/* how far below base the range of V goes */
+	static size_type room(const V &base) {
+		return offset(std::numeric_limits<V>::min(), base);
+	}
+
+	/* slots from value to the end of a range of size slots at base, saturated */
+	static uint64_t span(const V &base, size_type size, const V &value) {
+		if(!(value < base)) {
+			return std::max((uint64_t)size, (uint64_t)offset(base, value) + 1);
+		}
+		uint64_t below = offset(value, base);
+		return below > std::numeric_limits<uint64_t>::max() - size ? std::numeric_limits<uint64_t>::max() : below + size;
+	}
+
+	/*
+	 * Dense sets allocate for their whole range of ids, so a range of
+	 * more than spread slots per member (and at least min_span) is
+	 * refused rather than allocated.
+	 */
+	static void check_span(uint64_t slots, size_type members, uint64_t min_span, uint64_t spread) {
+		if(slots > min_span && slots / spread > members) {
+			std::ostringstream oss;
+			oss << "vertex ids too sparse for dense_storage (" << slots << " slots for " << members << " values); use tree_storage";
+
+			throw std::length_error(oss.str());
+		}
+	}
+};
+
+/*
+ * Set of integers as a bitmap of 64-bit words, one bit per value between
+ * the smallest and the largest ever inserted. Membership is a single bit
+ * test, and iteration skips empty words and finds set bits with
+ * count-trailing-zeros. The bitmap grows in both directions, doubling
+ * when it grows down, so ids that start at an offset or go negative cost
+ * no more than ids from zero. An insert that would leave more than 64
+ * bits per member throws std::length_error instead of allocating the
+ * range. Iterators hold the value they point at, so they stay valid
+ * across inserts; erasing a value invalidates only iterators pointing at
+ * it.
+ */
+template <typename V>
+class dense_vertex_set {
+	public:
+		typedef size_t size_type;
+
+		typedef V key_type;
+		typedef V value_type;
+
+		static const size_type NONE = (size_type)-1;
+
+		/* at most 64 bits of bitmap per vertex, once past 2MB */
+		static const uint64_t MIN_SPAN = uint64_t(1) << 24;
+		static const uint64_t SPREAD = 64;
+
+		class const_iterator {
+			public:
+				typedef std::bidirectional_iterator_tag iterator_category;
+				typedef V value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef const V * pointer;
+				typedef const V & reference;
+
+				const_iterator() : owner(NULL), at_end(true), current() {
+
+				}
+
+				reference operator*() const {
+					return current;
+				}
+
+				pointer operator->() const {
+					return &current;
+				}
+
+				const_iterator & operator++() {
+					seek(owner->next(owner->offset(current) + 1));
+					return *this;
+				}
+
+				const_iterator operator++(int) {
+					const_iterator tmp(*this);
+					++(*this);
+					return tmp;
+				}
+
+				const_iterator & operator--() {
+					seek(owner->previous(at_end ? owner->limit() : owner->offset(current)));
+					return *this;
+				}
+
+				const_iterator operator--(int) {
+					const_iterator tmp(*this);
+					--(*this);
+					return tmp;
+				}
+
+				bool operator==(const const_iterator &other) const {
+					return at_end == other.at_end && (at_end || current == other.current);
+				}
+
+				bool operator!=(const const_iterator &other) const {
+					return !(*this == other);
+				}
+
+			protected:
+				friend class dense_vertex_set;
+
+				const dense_vertex_set *owner;
+				bool at_end;
+				V current;
+
+				const_iterator(const dense_vertex_set *owner, size_type position) : owner(owner), at_end(true), current() {
+					seek(position);
+				}
+
+				void seek(size_type position) {
+					at_end = position == NONE;
+					if(!at_end) {
+						current = owner->value_at(position);
+					}
+				}
+		};
+
+		typedef const_iterator iterator;
+
+		dense_vertex_set() : base(), total(0) {
+
+		}
+
+		/*
+		 * Iterators
+		 */
+		const_iterator begin() const {
+			return const_iterator(this, next(0));
+		}
+
+		const_iterator end() const {
+			return const_iterator(this, NONE);
+		}
+
+		/*
+		 * Capacity
+		 */
+		size_type size() const {
+			return total;
+		}
+
+		bool empty() const {
+			return total == 0;
+		}
+
+		memory_report memory_usage() const {
+			using namespace memory_accounting;
+
+			memory_report usage;
+			usage.nodes = sizeof(*this);
+			usage.keys = words.capacity() * sizeof(uint64_t);
+			usage.overhead = words.capacity() == 0 ? 0 : allocation_overhead(words.capacity() * sizeof(uint64_t));
+			return usage;
+		}
+
+		/*
+		 * Modifiers
+		 */
+		std::pair<iterator,bool> insert(const V &value) {
+			if(!words.empty()) {
+				dense_offsets<V>::check_span(dense_offsets<V>::span(base, limit(), value), total + 1, MIN_SPAN, SPREAD);
+			}
+
+			/* base stays a multiple of 64, so growing down adds whole words */
+			V aligned = (V)((uint64_t)value & ~uint64_t(63));
+			if(words.empty()) {
+				base = aligned;
+			}
+			else if(value < base) {
+				size_type add = std::max(dense_offsets<V>::offset(aligned, base) / 64, words.size());
+				add = std::min(add, dense_offsets<V>::room(base) / 64);
+				words.insert(words.begin(), add, 0);
+				base = dense_offsets<V>::value_before(base, add * 64);
+			}
+
+			size_type position = offset(value);
+			if(position >= limit()) {
+				words.resize(position / 64 + 1, 0);
+			}
+
+			uint64_t &word = words[position / 64];
+			uint64_t bit = uint64_t(1) << (position % 64);
+			bool inserted = (word & bit) == 0;
+			if(inserted) {
+				word |= bit;
+				total++;
+			}
+			return std::pair<iterator,bool>(const_iterator(this, position), inserted);
+		}
+
+		size_type erase(const V &value) {
+			if(!contains(value)) {
+				return 0;
+			}
+			size_type position = offset(value);
+			words[position / 64] &= ~(uint64_t(1) << (position % 64));
+			total--;
+			return 1;
+		}
+
+		void erase(const_iterator position) {
+			erase(*position);
+		}
+
+		void clear() {
+			words.clear();
+			total = 0;
+		}
+
+		/*
+		 * Operations
+		 */
+		bool contains(const V &value) const {
+			if(value < base || offset(value) >= limit()) {
+				return false;
+			}
+			size_type position = offset(value);
+			return (words[position / 64] >> (position % 64)) & 1;
+		}
+
+		size_type count(const V &value) const {
+			return contains(value) ? 1 : 0;
+		}
+
+		const_iterator find(const V &value) const {
+			return contains(value) ? const_iterator(this, offset(value)) : end();
+		}
+
+		const_iterator lower_bound(const V &value) const {
+			return value < base ? begin() : const_iterator(this, next(offset(value)));
+		}
+
+		const_iterator upper_bound(const V &value) const {
+			if(value < base) {
+				return begin();
+			}
+			size_type position = offset(value);
+			return const_iterator(this, position >= limit() ? NONE : next(position + 1));
+		}
+
+	protected:
+		std::vector<uint64_t, counting_allocator<uint64_t> > words;
+		V base;
+		size_type total;
+
+		size_type offset(const V &value) const {
+			return dense_offsets<V>::offset(base, value);
+		}
+
+		V value_at(size_type position) const {
+			return dense_offsets<V>::value_at(base, position);
+		}
+
+		/* one past the last position the bitmap holds */
+		size_type limit() const {
+			return words.size() * 64;
+		}
+
+		/* first position at or after position that is set, or NONE */
+		size_type next(size_type position) const {
+			if(position >= limit()) {
+				return NONE;
+			}
+			size_type index = position / 64;
+			uint64_t word = words[index] & (~uint64_t(0) << (position % 64));
+			while(word == 0) {
+				if(++index == words.size()) {
+					return NONE;
+				}
+				word = words[index];
+			}
+			return index * 64 + (size_type)__builtin_ctzll(word);
+		}
+
+		/* last position before position that is set, or NONE */
+		size_type previous(size_type position) const {
+			position = std::min(position, limit());
+			if(position == 0) {
+				return NONE;
+			}
+			position--;
+			size_type index = position / 64;
+			uint64_t word = words[index] & (~uint64_t(0) >> (63 - position % 64));
+			while(word == 0) {
+				if(index == 0) {
+					return NONE;
+				}
+				word = words[--index];
+			}
+			return index * 64 + 63 - (size_type)__builtin_clzll(word);
+		}
+};
+
+/*
+ * Set of integer pairs kept as one sorted vector of seconds per first,
+ * indexed by first less a base that moves down like dense_vertex_set's,
+ * so the pairs come out in the same lexicographic order as
+ * std::set<std::pair<V,V> >. Lookups are a binary search of a single
+ * list. Iterators hold the pair they point at and find it again when an
+ * insert or erase has moved it, so as with std::set only erasing the
+ * pair itself invalidates an iterator and g.erase(it++) works. Inserting
+ * into the middle of a list moves its tail, so a vertex of degree d
+ * costs O(d^2) to fill from unsorted input; sort it first, or build a
+ * compact_graph with graph_builder.
+ */
+template <typename V>
+class dense_edge_set {
+	public:
+		typedef size_t size_type;
+
+		typedef std::pair<V,V> key_type;
+		typedef std::pair<V,V> value_type;
+
+		typedef std::vector<V, counting_allocator<V> > list_type;
+
+		static const size_type NONE = (size_type)-1;
+
+		/* at most 16 lists per edge, once past 2^20 lists */
+		static const uint64_t MIN_SPAN = uint64_t(1) << 20;
+		static const uint64_t SPREAD = 16;
+
+		class const_iterator {
+			public:
+				typedef std::bidirectional_iterator_tag iterator_category;
+				typedef std::pair<V,V> value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef const value_type * pointer;
+				typedef const value_type & reference;
+
+				const_iterator() : owner(NULL), src(NONE), position(0), current() {
+
+				}
+
+				reference operator*() const {
+					return current;
+				}
+
+				pointer operator->() const {
+					return &current;
+				}
+
+				const_iterator & operator++() {
+					if(!sync()) {
+						return *this;
+					}
+					if(++position == owner->lists[src].size()) {
+						seek(owner->next(src + 1), 0);
+					}
+					else {
+						current.second = owner->lists[src][position];
+					}
+					return *this;
+				}
+
+				const_iterator operator++(int) {
+					const_iterator tmp(*this);
+					++(*this);
+					return tmp;
+				}
+
+				const_iterator & operator--() {
+					sync();
+					if(src == NONE || position == 0) {
+						size_type last = owner->previous(src == NONE ? owner->lists.size() : src);
+						seek(last, owner->lists[last].size() - 1);
+					}
+					else {
+						seek(src, position - 1);
+					}
+					return *this;
+				}
+
+				const_iterator operator--(int) {
+					const_iterator tmp(*this);
+					--(*this);
+					return tmp;
+				}
+
+				bool operator==(const const_iterator &other) const {
+					return (src == NONE) == (other.src == NONE) && (src == NONE || current == other.current);
+				}
+
+				bool operator!=(const const_iterator &other) const {
+					return !(*this == other);
+				}
+
+			protected:
+				friend class dense_edge_set;
+
+				const dense_edge_set *owner;
+				size_type src;
+				size_type position;
+				value_type current;
+
+				const_iterator(const dense_edge_set *owner, size_type src, size_type position) : owner(owner), src(NONE), position(0), current() {
+					seek(src, position);
+				}
+
+				void seek(size_type next_src, size_type next_position) {
+					src = next_src;
+					position = src == NONE ? 0 : next_position;
+					if(src != NONE) {
+						current = value_type(owner->value_at(src), owner->lists[src][position]);
+					}
+				}
+
+				/*
+				 * Finds current again if an insert or erase has moved it.
+				 * Returns false if it was erased, leaving the iterator at the
+				 * pair after it.
+				 */
+				bool sync() {
+					if(src == NONE || owner->holds(src, position, current)) {
+						return true;
+					}
+					value_type wanted = current;
+					*this = owner->lower_bound(wanted);
+					return src != NONE && current == wanted;
+				}
+		};
+
+		typedef const_iterator iterator;
+
+		dense_edge_set() : base(), total(0) {
+
+		}
+
+		/*
+		 * Iterators
+		 */
+		const_iterator begin() const {
+			return const_iterator(this, next(0), 0);
+		}
+
+		const_iterator end() const {
+			return const_iterator(this, NONE, 0);
+		}
+
+		/*
+		 * Capacity
+		 */
+		size_type size() const {
+			return total;
+		}
+
+		bool empty() const {
+			return total == 0;
+		}
+
+		memory_report memory_usage() const {
+			using namespace memory_accounting;
+
+			memory_report usage;
+			usage.nodes = sizeof(*this) + lists.capacity() * sizeof(list_type);
+			usage.overhead = lists.capacity() == 0 ? 0 : allocation_overhead(lists.capacity() * sizeof(list_type));
+			for(size_type ii = 0; ii < lists.size(); ii++) {
+				if(lists[ii].capacity() != 0) {
+					usage.keys += lists[ii].capacity() * sizeof(V);
+					usage.overhead += allocation_overhead(lists[ii].capacity() * sizeof(V));
+				}
+			}
+			return usage;
+		}
+
+		/*
+		 * Element Access
+		 */
+
+		/* the seconds paired with first, in order */
+		const list_type & neighbors(const V &first) const {
+			static const list_type empty_list;
+			if(!covers(first)) {
+				return empty_list;
+			}
+			return lists[offset(first)];
+		}
+
+		/*
+		 * Modifiers
+		 */
+		std::pair<iterator,bool> insert(const value_type &edge) {
+			if(!lists.empty()) {
+				dense_offsets<V>::check_span(dense_offsets<V>::span(base, lists.size(), edge.first), total + 1, MIN_SPAN, SPREAD);
+			}
+
+			if(lists.empty()) {
+				base = edge.first;
+			}
+			else if(edge.first < base) {
+				size_type add = std::max(offset(edge.first, base), lists.size());
+				add = std::min(add, dense_offsets<V>::room(base));
+				lists.insert(lists.begin(), add, list_type());
+				base = dense_offsets<V>::value_before(base, add);
+			}
+
+			size_type src = offset(edge.first);
+			if(src >= lists.size()) {
+				lists.resize(src + 1);
+			}
+
+			list_type &list = lists[src];
+			typename list_type::iterator iter = std::lower_bound(list.begin(), list.end(), edge.second);
+			size_type position = (size_type)(iter - list.begin());
+			if(iter != list.end() && *iter == edge.second) {
+				return std::pair<iterator,bool>(const_iterator(this, src, position), false);
+			}
+
+			list.insert(iter, edge.second);
+			total++;
+			return std::pair<iterator,bool>(const_iterator(this, src, position), true);
+		}
+
+		size_type erase(const value_type &edge) {
+			const_iterator iter = find(edge);
+			if(iter == end()) {
+				return 0;
+			}
+			erase(iter);
+			return 1;
+		}
+
+		void erase(const_iterator position) {
+			if(!position.sync()) {
+				return;
+			}
+			list_type &list = lists[position.src];
+			list.erase(list.begin() + position.position);
+			total--;
+		}
+
+		/* removes every pair with vertex on either side */
+		void erase_incident(const V &vertex) {
+			if(covers(vertex)) {
+				list_type &list = lists[offset(vertex)];
+				total -= list.size();
+				list_type().swap(list);
+			}
+
+			for(size_type ii = 0; ii < lists.size(); ii++) {
+				list_type &list = lists[ii];
+				typename list_type::iterator iter = std::lower_bound(list.begin(), list.end(), vertex);
+				if(iter != list.end() && *iter == vertex) {
+					list.erase(iter);
+					total--;
+				}
+			}
+		}
+
+		void clear() {
+			lists.clear();
+			total = 0;
+		}
+
+		/*
+		 * Operations
+		 */
+		const_iterator find(const value_type &edge) const {
+			if(!covers(edge.first)) {
+				return end();
+			}
+			size_type src = offset(edge.first);
+			const list_type &list = lists[src];
+			typename list_type::const_iterator iter = std::lower_bound(list.begin(), list.end(), edge.second);
+			if(iter == list.end() || *iter != edge.second) {
+				return end();
+			}
+			return const_iterator(this, src, (size_type)(iter - list.begin()));
+		}
+
+		size_type count(const value_type &edge) const {
+			return find(edge) == end() ? 0 : 1;
+		}
+
+		const_iterator lower_bound(const value_type &edge) const {
+			return bound(edge, false);
+		}
+
+		const_iterator upper_bound(const value_type &edge) const {
+			return bound(edge, true);
+		}
+
+	protected:
+		std::vector<list_type, counting_allocator<list_type> > lists;
+		V base;
+		size_type total;
+
+		size_type offset(const V &value) const {
+			return dense_offsets<V>::offset(base, value);
+		}
+
+		static size_type offset(const V &from, const V &to) {
+			return dense_offsets<V>::offset(from, to);
+		}
+
+		V value_at(size_type src) const {
+			return dense_offsets<V>::value_at(base, src);
+		}
+
+		bool covers(const V &value) const {
+			return !(value < base) && offset(value) < lists.size();
+		}
+
+		/* whether the pair at (src, position) is still edge */
+		bool holds(size_type src, size_type position, const value_type &edge) const {
+			return src < lists.size() && position < lists[src].size() && lists[src][position] == edge.second && value_at(src) == edge.first;
+		}
+
+		/* first non-empty list at or after src, or NONE */
+		size_type next(size_type src) const {
+			for(; src < lists.size(); src++) {
+				if(!lists[src].empty()) {
+					return src;
+				}
+			}
+			return NONE;
+		}
+
+		/* last non-empty list before src; there must be one */
+		size_type previous(size_type src) const {
+			do {
+				src--;
+			} while(lists[src].empty());
+			return src;
+		}
+
+		const_iterator bound(const value_type &edge, bool strict) const {
+			if(edge.first < base) {
+				return begin();
+			}
+			if(!covers(edge.first)) {
+				return end();
+			}
+
+			size_type src = offset(edge.first);
+			const list_type &list = lists[src];
+			typename list_type::const_iterator iter = strict ? std::upper_bound(list.begin(), list.end(), edge.second) : std::lower_bound(list.begin(), list.end(), edge.second);
+			if(iter != list.end()) {
+				return const_iterator(this, src, (size_type)(iter - list.begin()));
+			}
+			return const_iterator(this, next(src + 1), 0);
+		}
+};
+
+/*
+ * Bitmap vertices and per-vertex sorted neighbor lists for integral V.
+ * Both span the range from the smallest to the largest vertex, so this
+ * suits ids handed out densely (such as interned labels);
+ * graph<V, tree_storage<V> > keeps sparse integer ids in std::sets
+ * instead. Ids too sparse for the range to pay off are refused with
+ * std::length_error rather than allocated.
+ */
+template <typename V>
+struct dense_storage {
+	typedef size_t size_type;
+
+	typedef V VERTEX;
+	typedef std::pair<VERTEX,VERTEX> EDGE;
+
+	typedef dense_vertex_set<VERTEX> vertex_set;
+	typedef dense_edge_set<VERTEX> edge_set;
+
+	static void remove_incident_edges(edge_set &edges, const VERTEX &vertex) {
+		edges.erase_incident(vertex);
+	}
+
+	static memory_report memory_usage(const vertex_set &vertices, const edge_set &edges) {
+		memory_report usage = vertices.memory_usage();
+		usage += edges.memory_usage();
+		return usage;
+	}
+};
+
+template <typename V>
+struct graph_storage : tree_storage<V> {
+
+};
+
+#endif
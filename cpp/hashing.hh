@@ -0,0 +1,57 @@
+#ifndef _HASHING_HH_
+#define _HASHING_HH_
+
+#include <string>
+
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * 64-bit hashing for the sketches. Every bit of the result is usable
+ * on its own, which HyperLogLog (leading zeros) and Count-Min (low bits)
+ * both rely on.
+ */
+namespace hashing {
+	const uint64_t GOLDEN = 0x9e3779b97f4a7c15ULL;
+
+	/* MurmurHash3 finalizer */
+	inline uint64_t mix(uint64_t value) {
+		value ^= value >> 33;
+		value *= 0xff51afd7ed558ccdULL;
+		value ^= value >> 33;
+		value *= 0xc4ceb9fe1a85ec53ULL;
+		value ^= value >> 33;
+		return value;
+	}
+
+	inline uint64_t bytes(const char *data, size_t length, uint64_t seed=0) {
+		uint64_t hash = seed ^ (length * GOLDEN);
+		while(length >= sizeof(uint64_t)) {
+			uint64_t word;
+			std::memcpy(&word, data, sizeof(word));
+			hash = (hash ^ mix(word)) * GOLDEN;
+			hash = (hash << 31) | (hash >> 33);
+
+			data += sizeof(word);
+			length -= sizeof(word);
+		}
+		if(length > 0) {
+			uint64_t word = 0;
+			std::memcpy(&word, data, length);
+			hash = (hash ^ mix(word)) * GOLDEN;
+		}
+		return mix(hash);
+	}
+
+	inline uint64_t bytes(const std::string &value, uint64_t seed=0) {
+		return bytes(value.data(), value.size(), seed);
+	}
+
+	/* order-sensitive combination of two hashes */
+	inline uint64_t combine(uint64_t first, uint64_t second) {
+		return mix(first ^ (second * GOLDEN + (first << 6) + (first >> 2)));
+	}
+}
+
+#endif
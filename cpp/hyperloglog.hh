@@ -0,0 +1,168 @@
+#ifndef _HYPERLOGLOG_HH_
+#define _HYPERLOGLOG_HH_
+
+#include <vector>
+
+#include <sstream>
+
+#include <algorithm>
+
+#include <stdexcept>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * HyperLogLog distinct counter (Flajolet et al., 2007) over 64-bit
+ * hashes. 2^precision one-byte registers give a relative standard error
+ * of 1.04/sqrt(2^precision); small cardinalities fall back to linear
+ * counting. With 64-bit hashes no large-range correction is needed.
+ *
+ * The register arithmetic is also exposed as static functions so that
+ * code keeping many counters in one array can share it.
+ */
+class hyperloglog {
+	public:
+		typedef size_t size_type;
+
+		static const unsigned int MIN_PRECISION = 4;
+		static const unsigned int MAX_PRECISION = 18;
+
+		explicit hyperloglog(unsigned int precision=14) : bits(precision) {
+			if(precision < MIN_PRECISION || precision > MAX_PRECISION) {
+				std::ostringstream oss;
+				oss << "precision must be between " << MIN_PRECISION << " and " << MAX_PRECISION;
+
+				throw std::domain_error(oss.str());
+			}
+			registers.assign(size_type(1) << precision, 0);
+		}
+
+		/*
+		 * Capacity
+		 */
+		unsigned int precision() const {
+			return bits;
+		}
+
+		size_type size_registers() const {
+			return registers.size();
+		}
+
+		size_type memory_usage() const {
+			return registers.capacity() + sizeof(*this);
+		}
+
+		double relative_error() const {
+			return relative_error(bits);
+		}
+
+		/*
+		 * Element Access
+		 */
+		const uint8_t * data() const {
+			return &registers[0];
+		}
+
+		/*
+		 * Modifiers
+		 */
+		void insert(uint64_t hash) {
+			size_type slot = hash >> (64 - bits);
+			uint8_t value = rank(hash, bits);
+			if(registers[slot] < value) {
+				registers[slot] = value;
+			}
+		}
+
+		/* afterwards counts the union of both streams */
+		void merge(const hyperloglog &other) {
+			if(other.bits != bits) {
+				std::ostringstream oss;
+				oss << "cannot merge counters of different precision";
+
+				throw std::domain_error(oss.str());
+			}
+			for(size_type ii = 0; ii < registers.size(); ii++) {
+				registers[ii] = std::max(registers[ii], other.registers[ii]);
+			}
+		}
+
+		void clear() {
+			std::fill(registers.begin(), registers.end(), 0);
+		}
+
+		/*
+		 * Operations
+		 */
+		double estimate() const {
+			return estimate(&registers[0], bits);
+		}
+
+		/* one plus the number of leading zeros of the hash bits below the slot */
+		static uint8_t rank(uint64_t hash, unsigned int precision) {
+			uint64_t rest = hash << precision;
+			if(rest == 0) {
+				return (uint8_t)(64 - precision + 1);
+			}
+			return (uint8_t)(__builtin_clzll(rest) + 1);
+		}
+
+		static double relative_error(unsigned int precision) {
+			return 1.04 / std::sqrt((double)(size_type(1) << precision));
+		}
+
+		static double estimate(const uint8_t *registers, unsigned int precision) {
+			size_type num_registers = size_type(1) << precision;
+
+			static const powers inverse;
+
+			double sum = 0.0;
+			size_type zeros = 0;
+			for(size_type ii = 0; ii < num_registers; ii++) {
+				sum += inverse.values[registers[ii]];
+				if(registers[ii] == 0) {
+					zeros++;
+				}
+			}
+
+			double m = (double)num_registers;
+			double alpha;
+			if(num_registers == 16) {
+				alpha = 0.673;
+			}
+			else if(num_registers == 32) {
+				alpha = 0.697;
+			}
+			else if(num_registers == 64) {
+				alpha = 0.709;
+			}
+			else {
+				alpha = 0.7213 / (1.0 + 1.079 / m);
+			}
+
+			double raw = alpha * m * m / sum;
+			if(raw <= 2.5 * m && zeros != 0) {
+				return m * std::log(m / (double)zeros);
+			}
+			return raw;
+		}
+
+	protected:
+		/* 2^-r for every register value r */
+		struct powers {
+			double values[256];
+
+			powers() {
+				for(int ii = 0; ii < 256; ii++) {
+					values[ii] = std::ldexp(1.0, -ii);
+				}
+			}
+		};
+
+		unsigned int bits;
+		std::vector<uint8_t> registers;
+};
+
+#endif
@@ -8,13 +8,17 @@
 
 #include <cstddef>
 
+#include "memory_usage.hh"
+
 template <typename T>
 class label_list {
 	public:
-		typedef typename std::map<T,T*>::size_type size_type;
+		typedef std::map<T, T*, std::less<T>, counting_allocator<std::pair<const T,T*> > > label_map;
+
+		typedef typename label_map::size_type size_type;
 
-		typedef typename std::map<T,T*>::iterator iterator;
-		typedef typename std::map<T,T*>::const_iterator const_iterator;
+		typedef typename label_map::iterator iterator;
+		typedef typename label_map::const_iterator const_iterator;
 
 		label_list() {
 			
@@ -24,8 +28,23 @@ class label_list {
 			set_labels(other.labels);
 		}
 
+		label_list(label_list &&other) noexcept : labels(std::move(other.labels)) {
+			other.labels.clear();
+		}
+
 		label_list & operator=(const label_list &other) {
-			set_labels(other.labels);
+			if(this != &other) {
+				set_labels(other.labels);
+			}
+
+			return *this;
+		}
+
+		label_list & operator=(label_list &&other) noexcept {
+			if(this != &other) {
+				clear();
+				labels.swap(other.labels);
+			}
 
 			return *this;
 		}
@@ -66,6 +85,27 @@ class label_list {
 			return labels.size();
 		}
 
+		memory_report memory_usage() const {
+			using namespace memory_accounting;
+
+			memory_report usage;
+			size_type num_labels = labels.size();
+
+			usage.nodes = num_labels * TREE_NODE_HEADER + sizeof(labels);
+			usage.keys = num_labels * sizeof(T);
+			usage.payloads = num_labels * (sizeof(T*) + sizeof(T));
+			usage.overhead = num_labels * (allocation_overhead(tree_node(sizeof(value_type))) + allocation_overhead(sizeof(T)));
+
+			const_iterator iter = begin();
+			if(heap_usage<T>::dynamic) {
+				for(; iter != end(); ++iter) {
+					usage.strings += heap_usage<T>::bytes(iter->first) + heap_usage<T>::bytes(*(iter->second));
+				}
+			}
+
+			return usage;
+		}
+
 		/*
 		 * Element Access
 		 */
@@ -74,6 +114,7 @@ class label_list {
 			std::pair<iterator,bool> ret = labels.insert(value_type(item, NULL));
 			if(ret.second) {
 				ret.first->second = new T(item);
+				count_item(true);
 			}
 
 				
@@ -88,6 +129,7 @@ class label_list {
 			iterator iter = begin();
 			for(; iter != end(); ++iter) {
 				delete(iter->second);
+				count_item(false);
 			}
 
 			labels.clear();
@@ -96,15 +138,32 @@ class label_list {
 		/*
 		 * Operations
 		 */
+		iterator find(const T &item) {
+			return labels.find(item);
+		}
 
+		const_iterator find(const T &item) const {
+			return labels.find(item);
+		}
 
 	
 	protected:
-		typedef typename std::map<T,T*>::value_type value_type;
+		typedef typename label_map::value_type value_type;
+
+		label_map labels;
 
-		std::map<T,T*> labels;
+		/* reports the label objects allocated with new to allocation_counter */
+		static void count_item(bool allocated) {
+			size_t reserved = sizeof(T) + memory_accounting::allocation_overhead(sizeof(T));
+			if(allocated) {
+				allocation_counter::global().add(sizeof(T), reserved);
+			}
+			else {
+				allocation_counter::global().remove(sizeof(T), reserved);
+			}
+		}
 
-		void set_labels(const std::map<T,T*> &other_labels) {
+		void set_labels(const label_map &other_labels) {
 			clear();
 
 			T *new_item = NULL;
@@ -112,8 +171,9 @@ class label_list {
 				const_iterator iter = other_labels.begin();
 				for(; iter != other_labels.end(); ++iter) {
 					new_item = NULL;
-					new_item = new T(&(iter->second));
+					new_item = new T(*(iter->second));
 					labels[iter->first] = new_item;
+					count_item(true);
 				}
 			}
 			catch(...) {
@@ -1,10 +1,11 @@
-#ifndef _GRAPH_HH_
-#define _GRAPH_HH_
+#ifndef _LABELED_GRAPH_HH_
+#define _LABELED_GRAPH_HH_
 
 #include <ostream>
 #include <sstream>
 
 #include <map>
+#include <memory>
 #include <utility>
 
 #include <algorithm>
@@ -14,6 +15,7 @@
 #include <cstddef>
 
 #include "output_any.hh"
+#include "memory_usage.hh"
 
 template <typename V, typename L>
 class labeled_graph {
@@ -25,13 +27,23 @@ class labeled_graph {
 		
 		typedef typename std::map<std::pair<vertex,vertex>,label>::key_type edge;
 
-		typedef typename std::map<vertex,label>::iterator vertex_iterator;
-		typedef typename std::map<vertex,label>::const_iterator const_vertex_iterator;
+		typedef std::map<vertex, label, std::less<vertex>, counting_allocator<std::pair<const vertex,label> > > vertex_map;
+		typedef std::map<edge, label, std::less<edge>, counting_allocator<std::pair<const edge,label> > > edge_map;
+
+		typedef typename vertex_map::iterator vertex_iterator;
+		typedef typename vertex_map::const_iterator const_vertex_iterator;
 		
-		typedef typename std::map<std::pair<vertex,vertex>,label>::iterator edge_iterator;
-		typedef typename std::map<std::pair<vertex,vertex>,label>::const_iterator const_edge_iterator;
+		typedef typename edge_map::iterator edge_iterator;
+		typedef typename edge_map::const_iterator const_edge_iterator;
 
-		labeled_graph() {
+		/*
+		 * Copies share the vertex and edge maps with the original; a map
+		 * is cloned the first time one of the graphs modifies it, as in
+		 * graph<V>. A non-const iterator can write a label, so handing one
+		 * out clones the map it points into as well; use a const graph to
+		 * read without cloning.
+		 */
+		labeled_graph() : vertices(empty_vertices()), edges(empty_edges()) {
 
 		}
 
@@ -39,6 +51,11 @@ class labeled_graph {
 			
 		}
 
+		labeled_graph(labeled_graph &&other) noexcept : vertices(std::move(other.vertices)), edges(std::move(other.edges)) {
+			other.vertices = empty_vertices();
+			other.edges = empty_edges();
+		}
+
 		labeled_graph & operator=(const labeled_graph &other) {
 			vertices = other.vertices;
 			edges = other.edges;
@@ -46,50 +63,79 @@ class labeled_graph {
 			return *this;
 		}
 
+		labeled_graph & operator=(labeled_graph &&other) noexcept {
+			if(this != &other) {
+				vertices = std::move(other.vertices);
+				edges = std::move(other.edges);
+
+				other.vertices = empty_vertices();
+				other.edges = empty_edges();
+			}
+
+			return *this;
+		}
+
 		/*
 		 * Iterators
 		 */
 		vertex_iterator begin_vertices() {
-			return vertices.begin();
+			return mutable_vertices().begin();
 		}
 
 		vertex_iterator end_vertices() {
-			return vertices.end();
+			return mutable_vertices().end();
 		}
 
 		const_vertex_iterator begin_vertices() const {
-			return vertices.begin();
+			return vertices->begin();
 		}
 		
 		const_vertex_iterator end_vertices() const {
-			return vertices.end();
+			return vertices->end();
 		}
 
 		edge_iterator begin_edges() {
-			return edges.begin();
+			return mutable_edges().begin();
 		}
 
 		edge_iterator end_edges() {
-			return edges.end();
+			return mutable_edges().end();
 		}
 
 		const_edge_iterator begin_edges() const {
-			return edges.begin();
+			return edges->begin();
 		}
 		
 		const_edge_iterator end_edges() const {
-			return edges.end();
+			return edges->end();
 		}
 
 		/*
 		 * Capacity
 		 */
-		size_type size_vertices() {
-			return (size_type)vertices.size();
+		size_type size_vertices() const {
+			return (size_type)vertices->size();
+		}
+
+		size_type size_edges() const {
+			return (size_type)edges->size();
 		}
 
-		size_type size_edges() {
-			return (size_type)edges.size();
+		/* maps shared with copies are reported in full by every copy */
+		memory_report memory_usage() const {
+			using namespace memory_accounting;
+
+			memory_report usage;
+			size_type num_vertices = vertices->size();
+			size_type num_edges = edges->size();
+
+			usage.nodes = (num_vertices + num_edges) * TREE_NODE_HEADER + 2 * sizeof(*vertices) + 2 * sizeof(*edges);
+			usage.keys = num_vertices * sizeof(vertex) + num_edges * sizeof(edge);
+			usage.payloads = (num_vertices + num_edges) * sizeof(label);
+			usage.strings = heap_bytes(vertices->begin(), vertices->end(), (const typename vertex_map::value_type *)NULL) + heap_bytes(edges->begin(), edges->end(), (const typename edge_map::value_type *)NULL);
+			usage.overhead = num_vertices * allocation_overhead(tree_node(sizeof(typename vertex_map::value_type))) + num_edges * allocation_overhead(tree_node(sizeof(typename edge_map::value_type)));
+
+			return usage;
 		}
 
 		/*
@@ -100,29 +146,29 @@ class labeled_graph {
 		 * Modifiers
 		 */
 		std::pair<vertex_iterator,bool> insert(const vertex &vrt, label &lbl) {
-			vertex_iterator vertex_iter = vertices.lower_bound(vrt);
-			if(vertex_iter != end_vertices() && vertex_iter->first == vrt) {
-				return std::pair<vertex_iterator,bool>(vertex_iter,false);
-			}
-			
-			return vertices.insert( typename std::map<vertex,label>::value_type(vrt,lbl) );
+			return mutable_vertices().insert( typename vertex_map::value_type(vrt,lbl) );
 		}
 		
 		std::pair<edge_iterator,bool> insert(const edge &edg) {
-			if(find(edg.first) == end_vertices()) {
+			return insert(edg, label());
+		}
+
+		/* an edge already present keeps its label */
+		std::pair<edge_iterator,bool> insert(const edge &edg, const label &lbl) {
+			if(vertices->find(edg.first) == vertices->end()) {
 				std::ostringstream oss;
 				oss << "unexpected vertex";
 
 				throw std::domain_error(oss.str());
 			}
-			else if(find(edg.second) == end_vertices()) {
+			else if(vertices->find(edg.second) == vertices->end()) {
 				std::ostringstream oss;
 				oss << "unexpected vertex";
 
 				throw std::domain_error(oss.str());
 			}
 
-			return edges.insert(edg);
+			return mutable_edges().insert( typename edge_map::value_type(edg,lbl) );
 		}
 		
 		std::pair<edge_iterator,bool> insert(const vertex &src, const vertex &dst) {
@@ -134,11 +180,21 @@ class labeled_graph {
 			}
 		}
 
+		std::pair<edge_iterator,bool> insert(const vertex &src, const vertex &dst, const label &lbl) {
+			if(src <= dst) {
+				return insert( edge(src,dst), lbl );
+			}
+			else {
+				return insert( edge(dst,src), lbl );
+			}
+		}
+
 		size_type erase(const vertex &vrt) {
-			vertex_iterator vertex_iter = find(vrt);
-			if(vertex_iter != end_vertices()) {
-				remove_incident_edges(vrt);		
-				erase(vertex_iter);	
+			if(vertices->find(vrt) != vertices->end()) {
+				remove_incident_edges(vrt);
+				mutable_vertices().erase(vrt);
+
+				return 1;
 			}
 			else {
 				return 0;
@@ -146,24 +202,34 @@ class labeled_graph {
 		}
 
 		size_type erase(const edge &edg) {
-			return (size_type)edges.erase(edg);
+			return (size_type)mutable_edges().erase(edg);
 		}
 		
 		void erase(vertex_iterator position) {
-			vertices.erase(position);
+			if(vertices.use_count() == 1) {
+				vertices->erase(position);
+			}
+			else {
+				mutable_vertices().erase(position->first);
+			}
 		}
 
 		void erase(edge_iterator position) {
-			edges.erase(position);
+			if(edges.use_count() == 1) {
+				edges->erase(position);
+			}
+			else {
+				mutable_edges().erase(position->first);
+			}
 		}
 
 		void clear_vertices() {
-			vertices.clear();
+			vertices = empty_vertices();
 			clear_edges();
 		}
 
 		void clear_edges() {
-			edges.clear();
+			edges = empty_edges();
 		}
 
 		void clear() {
@@ -172,68 +238,75 @@ class labeled_graph {
 		}
 
 		void remove_incident_edges(const vertex &vrt) {
-			/*
-			edge_iterator edge_iter = begin_edges();
-			for(; edge_iter != end_edges(); ++edge_iter) {
-				if(edge_iter->first == vrt || edge_iter->second == vrt) {
-					edges.erase(edge_iter++);
+			edge_map &incident_edges = mutable_edges();
+			is_incident incident(vrt);
+
+			edge_iterator edge_iter = incident_edges.begin();
+			while(edge_iter != incident_edges.end()) {
+				if(incident(edge_iter->first)) {
+					incident_edges.erase(edge_iter++);
 				}
 				else {
 					++edge_iter;
 				}
-			}*/
-			std::remove_if(edges.begin(), edges.end(), is_incident(vrt));
+			}
+		}
+
+		/* gives this graph its own copy of any map it still shares */
+		void detach() {
+			mutable_vertices();
+			mutable_edges();
 		}
 
 		/*
 		 * Operations
 		 */
 		vertex_iterator find(const vertex &vrt) {
-			return vertices.find(vrt);
+			return mutable_vertices().find(vrt);
 		}
 
 		const_vertex_iterator find(const vertex &vrt) const {
-			return vertices.find(vrt);
+			return vertices->find(vrt);
 		}
 
 		edge_iterator find(const edge &edg) {
-			return edges.find(edg);
+			return mutable_edges().find(edg);
 		}
 
 		const_edge_iterator find(const edge &edg) const {
-			return edges.find(edg);
+			return edges->find(edg);
 		}
 		
 		vertex_iterator lower_bound(const vertex &vrt) {
-			return vertices.lower_bound(vrt);
+			return mutable_vertices().lower_bound(vrt);
 		}
 		
 		const_vertex_iterator lower_bound(const vertex &vrt) const {
-			return vertices.lower_bound(vrt);
+			return vertices->lower_bound(vrt);
 		}
 
 		edge_iterator lower_bound(const edge &edg) {
-			return edges.lower_bound(edg);
+			return mutable_edges().lower_bound(edg);
 		}
 		
 		const_edge_iterator lower_bound(const edge &edg) const {
-			return edges.lower_bound(edg);
+			return edges->lower_bound(edg);
 		}
 
 		vertex_iterator upper_bound(const vertex &vrt) {
-			return vertices.upper_bound(vrt);
+			return mutable_vertices().upper_bound(vrt);
 		}
 		
 		const_vertex_iterator upper_bound(const vertex &vrt) const {
-			return vertices.upper_bound(vrt);
+			return vertices->upper_bound(vrt);
 		}
 
 		edge_iterator upper_bound(const edge &edg) {
-			return edges.upper_bound(edg);
+			return mutable_edges().upper_bound(edg);
 		}
 		
 		const_edge_iterator upper_bound(const edge &edg) const {
-			return edges.upper_bound(edg);
+			return edges->upper_bound(edg);
 		}
 
 		/*
@@ -258,8 +331,33 @@ class labeled_graph {
 		}
 	
 	protected:
-		std::map<vertex,label> vertices;
-		std::map<edge,label> edges;
+		std::shared_ptr<vertex_map> vertices;
+		std::shared_ptr<edge_map> edges;
+
+		/* shared by every empty graph, so construction does not allocate */
+		static const std::shared_ptr<vertex_map> & empty_vertices() {
+			static const std::shared_ptr<vertex_map> empty = std::allocate_shared<vertex_map>(counting_allocator<vertex_map>());
+			return empty;
+		}
+
+		static const std::shared_ptr<edge_map> & empty_edges() {
+			static const std::shared_ptr<edge_map> empty = std::allocate_shared<edge_map>(counting_allocator<edge_map>());
+			return empty;
+		}
+
+		vertex_map & mutable_vertices() {
+			if(vertices.use_count() != 1) {
+				vertices = std::allocate_shared<vertex_map>(counting_allocator<vertex_map>(), *vertices);
+			}
+			return *vertices;
+		}
+
+		edge_map & mutable_edges() {
+			if(edges.use_count() != 1) {
+				edges = std::allocate_shared<edge_map>(counting_allocator<edge_map>(), *edges);
+			}
+			return *edges;
+		}
 	
 		struct is_incident {
 			const vertex &vrt;
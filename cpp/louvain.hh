@@ -0,0 +1,591 @@
+#ifndef _LOUVAIN_HH_
+#define _LOUVAIN_HH_
+
+#include <vector>
+#include <utility>
+
+#include <sstream>
+
+#include <algorithm>
+
+#include <stdexcept>
+
+#include <cstddef>
+
+#include "graph.hh"
+#include "compact_graph.hh"
+#include "parallel.hh"
+
+/*
+ * Modularity based community detection. Each level moves vertices to the
+ * neighboring community with the best modularity gain until nothing
+ * improves, then collapses communities into the vertices of the next
+ * level. With refinement enabled the Leiden step splits every community
+ * into well-connected subcommunities before collapsing, which guarantees
+ * connected communities.
+ *
+ * Vertices of one color of a greedy coloring are never adjacent, so each
+ * color class decides its moves in parallel against the same snapshot
+ * and the moves are applied afterwards; results do not depend on the
+ * number of threads.
+ */
+template <typename V>
+class louvain {
+	public:
+		typedef size_t size_type;
+		typedef typename compact_graph<V>::index_type index_type;
+
+		typedef typename compact_graph<V>::VERTEX VERTEX;
+
+		struct unit_weight {
+			double operator()(const VERTEX &src, const VERTEX &dst) const {
+				return 1.0;
+			}
+		};
+
+		template <typename Storage>
+		explicit louvain(const graph<V, Storage> &other, bool refine=true, double resolution=1.0) : adjacency(other), refine(refine), resolution(resolution) {
+			run(unit_weight());
+		}
+
+		/* weight(src,dst) gives the weight of every edge of the graph */
+		template <typename Storage, typename Weight>
+		louvain(const graph<V, Storage> &other, Weight weight, bool refine=true, double resolution=1.0) : adjacency(other), refine(refine), resolution(resolution) {
+			run(weight);
+		}
+
+		/*
+		 * Capacity
+		 */
+		size_type size_vertices() const {
+			return adjacency.size_vertices();
+		}
+
+		size_type size_levels() const {
+			return levels.size();
+		}
+
+		size_type size_communities(size_type level) const {
+			return counts[level];
+		}
+
+		/*
+		 * Element Access
+		 */
+		const VERTEX & vertex(size_type vertex) const {
+			return adjacency.vertex(vertex);
+		}
+
+		/* community of every vertex (by compact index) at the given level */
+		const std::vector<index_type> & level(size_type level) const {
+			return levels[level];
+		}
+
+		double modularity(size_type level) const {
+			return scores[level];
+		}
+
+		index_type community(size_type level, const VERTEX &vertex) const {
+			size_type index = adjacency.index(vertex);
+			if(index == adjacency.size_vertices()) {
+				std::ostringstream oss;
+				oss << "unexpected vertex";
+
+				throw std::domain_error(oss.str());
+			}
+			return levels[level][index];
+		}
+
+	protected:
+		/* weighted adjacency of one level; a self-loop counts twice towards strength */
+		struct level_graph {
+			std::vector<size_type> offsets;
+			std::vector<index_type> targets;
+			std::vector<double> weights;
+			std::vector<double> strength;
+			double total;
+
+			size_type size() const {
+				return offsets.size() - 1;
+			}
+		};
+
+		struct aggregate_edge {
+			index_type src;
+			index_type dst;
+			double weight;
+
+			bool operator<(const aggregate_edge &other) const {
+				return src < other.src || (src == other.src && dst < other.dst);
+			}
+		};
+
+		/* per-thread accumulator of edge weight towards each community */
+		struct scratch {
+			std::vector<double> weight;
+			std::vector<index_type> touched;
+
+			void reset(size_type size) {
+				weight.assign(size, 0.0);
+				touched.clear();
+			}
+
+			void add(index_type community, double value) {
+				if(weight[community] == 0.0) {
+					touched.push_back(community);
+				}
+				weight[community] += value;
+			}
+
+			void clear() {
+				typename std::vector<index_type>::const_iterator iter = touched.begin();
+				for(; iter != touched.end(); ++iter) {
+					weight[*iter] = 0.0;
+				}
+				touched.clear();
+			}
+		};
+
+		static const double EPSILON;
+
+		compact_graph<V> adjacency;
+		bool refine;
+		double resolution;
+
+		std::vector<std::vector<index_type> > levels;
+		std::vector<size_type> counts;
+		std::vector<double> scores;
+
+		std::vector<scratch> scratches;
+
+		template <typename Weight>
+		void run(Weight weight) {
+			size_type num_vertices = adjacency.size_vertices();
+			if(num_vertices == 0) {
+				return;
+			}
+
+			level_graph current;
+			build_base(current, weight);
+
+			scratches.resize(parallel::num_threads());
+
+			std::vector<index_type> membership(num_vertices);
+			std::vector<index_type> community(num_vertices);
+			for(size_type vertex = 0; vertex < num_vertices; vertex++) {
+				membership[vertex] = (index_type)vertex;
+				community[vertex] = (index_type)vertex;
+			}
+
+			if(current.total == 0.0) {
+				record(membership, community, current.size(), 0.0);
+				return;
+			}
+
+			for(;;) {
+				bool moved = move_vertices(current, community);
+				size_type num_communities = renumber(community);
+
+				if(moved || levels.empty()) {
+					record(membership, community, num_communities, modularity(current, community));
+				}
+				if(num_communities == current.size()) {
+					break;
+				}
+
+				std::vector<index_type> refined(community);
+				size_type num_refined = num_communities;
+				if(refine) {
+					refine_communities(current, community, num_communities, refined);
+					num_refined = renumber(refined);
+				}
+				if(num_refined == current.size()) {
+					break;
+				}
+
+				level_graph next;
+				aggregate(current, refined, num_refined, next);
+
+				std::vector<index_type> next_community(num_refined);
+				for(size_type vertex = 0; vertex < current.size(); vertex++) {
+					next_community[refined[vertex]] = community[vertex];
+				}
+				for(size_type vertex = 0; vertex < num_vertices; vertex++) {
+					membership[vertex] = refined[membership[vertex]];
+				}
+
+				std::swap(current, next);
+				community.swap(next_community);
+			}
+		}
+
+		template <typename Weight>
+		void build_base(level_graph &base, Weight weight) {
+			size_type num_vertices = adjacency.size_vertices();
+
+			base.offsets.assign(num_vertices + 1, 0);
+			base.strength.assign(num_vertices, 0.0);
+			for(size_type vertex = 0; vertex < num_vertices; vertex++) {
+				base.offsets[vertex+1] = base.offsets[vertex] + adjacency.degree(vertex);
+			}
+
+			base.targets.resize(base.offsets.back());
+			base.weights.resize(base.offsets.back());
+			base.total = 0.0;
+			for(size_type vertex = 0; vertex < num_vertices; vertex++) {
+				size_type arc = base.offsets[vertex];
+				typename compact_graph<V>::const_neighbor_iterator iter = adjacency.begin_neighbors(vertex);
+				for(; iter != adjacency.end_neighbors(vertex); ++iter, ++arc) {
+					double value = weight(adjacency.vertex(vertex), adjacency.vertex(*iter));
+					if(value < 0.0) {
+						std::ostringstream oss;
+						oss << "negative edge weight";
+
+						throw std::domain_error(oss.str());
+					}
+
+					base.targets[arc] = *iter;
+					base.weights[arc] = value;
+					base.strength[vertex] += (*iter == vertex) ? 2.0 * value : value;
+				}
+				base.total += base.strength[vertex];
+			}
+		}
+
+		/* renumbers ids densely in order of first appearance */
+		static size_type renumber(std::vector<index_type> &ids) {
+			std::vector<index_type> mapping(ids.size(), (index_type)-1);
+			index_type next = 0;
+			typename std::vector<index_type>::iterator iter = ids.begin();
+			for(; iter != ids.end(); ++iter) {
+				if(mapping[*iter] == (index_type)-1) {
+					mapping[*iter] = next++;
+				}
+				*iter = mapping[*iter];
+			}
+			return next;
+		}
+
+		void record(const std::vector<index_type> &membership, const std::vector<index_type> &community, size_type num_communities, double score) {
+			levels.push_back(std::vector<index_type>(membership.size()));
+			std::vector<index_type> &assignment = levels.back();
+			for(size_type vertex = 0; vertex < membership.size(); vertex++) {
+				assignment[vertex] = community[membership[vertex]];
+			}
+			counts.push_back(num_communities);
+			scores.push_back(score);
+		}
+
+		double modularity(const level_graph &current, const std::vector<index_type> &community) const {
+			std::vector<double> inside(current.size(), 0.0);
+			std::vector<double> totals(current.size(), 0.0);
+
+			for(size_type vertex = 0; vertex < current.size(); vertex++) {
+				totals[community[vertex]] += current.strength[vertex];
+				for(size_type arc = current.offsets[vertex]; arc < current.offsets[vertex+1]; arc++) {
+					if(community[current.targets[arc]] == community[vertex]) {
+						inside[community[vertex]] += (current.targets[arc] == vertex) ? 2.0 * current.weights[arc] : current.weights[arc];
+					}
+				}
+			}
+
+			double score = 0.0;
+			for(size_type comm = 0; comm < current.size(); comm++) {
+				double fraction = totals[comm] / current.total;
+				score += inside[comm] / current.total - resolution * fraction * fraction;
+			}
+			return score;
+		}
+
+		static void color(const level_graph &current, std::vector<std::vector<index_type> > &classes) {
+			std::vector<index_type> colors(current.size(), (index_type)-1);
+			std::vector<size_type> forbidden;
+
+			classes.clear();
+			for(size_type vertex = 0; vertex < current.size(); vertex++) {
+				for(size_type arc = current.offsets[vertex]; arc < current.offsets[vertex+1]; arc++) {
+					index_type neighbor_color = colors[current.targets[arc]];
+					if(neighbor_color != (index_type)-1) {
+						if(forbidden.size() <= neighbor_color) {
+							forbidden.resize(neighbor_color + 1, (size_type)-1);
+						}
+						forbidden[neighbor_color] = vertex;
+					}
+				}
+
+				index_type chosen = 0;
+				while(chosen < forbidden.size() && forbidden[chosen] == vertex) {
+					chosen++;
+				}
+				colors[vertex] = chosen;
+
+				if(classes.size() <= chosen) {
+					classes.resize(chosen + 1);
+				}
+				classes[chosen].push_back((index_type)vertex);
+			}
+		}
+
+		/*
+		 * Local moving phase; returns whether any vertex changed
+		 * community. totals[c] is the summed strength of community c.
+		 */
+		bool move_vertices(const level_graph &current, std::vector<index_type> &community) {
+			size_type size = current.size();
+
+			std::vector<std::vector<index_type> > classes;
+			color(current, classes);
+
+			std::vector<double> totals(size, 0.0);
+			for(size_type vertex = 0; vertex < size; vertex++) {
+				totals[community[vertex]] += current.strength[vertex];
+			}
+
+			for(size_type ii = 0; ii < scratches.size(); ii++) {
+				scratches[ii].reset(size);
+			}
+
+			std::vector<index_type> target(size);
+			bool moved = false;
+			double score = modularity(current, community);
+
+			for(;;) {
+				bool pass_moved = false;
+
+				typename std::vector<std::vector<index_type> >::const_iterator class_iter = classes.begin();
+				for(; class_iter != classes.end(); ++class_iter) {
+					const std::vector<index_type> &members = *class_iter;
+					size_type num_members = members.size();
+
+					/* small classes are not worth waking the other threads for */
+					parallel::parallel_for(0, num_members, num_members > 1024 ? 64 : num_members, [&](size_type ii) {
+						index_type vertex = members[ii];
+						target[vertex] = best_community(current, community, totals, vertex, scratches[parallel::thread_index()]);
+					});
+
+					typename std::vector<index_type>::const_iterator iter = members.begin();
+					for(; iter != members.end(); ++iter) {
+						index_type vertex = *iter;
+						if(target[vertex] != community[vertex]) {
+							totals[community[vertex]] -= current.strength[vertex];
+							totals[target[vertex]] += current.strength[vertex];
+							community[vertex] = target[vertex];
+							pass_moved = true;
+						}
+					}
+				}
+
+				if(!pass_moved) {
+					break;
+				}
+				moved = true;
+
+				double next_score = modularity(current, community);
+				if(next_score - score < EPSILON) {
+					break;
+				}
+				score = next_score;
+			}
+
+			return moved;
+		}
+
+		index_type best_community(const level_graph &current, const std::vector<index_type> &community, const std::vector<double> &totals, index_type vertex, scratch &weights) const {
+			index_type own = community[vertex];
+			double strength = current.strength[vertex];
+			double scale = resolution * strength / current.total;
+
+			weights.add(own, 0.0);
+			for(size_type arc = current.offsets[vertex]; arc < current.offsets[vertex+1]; arc++) {
+				if(current.targets[arc] != vertex) {
+					weights.add(community[current.targets[arc]], current.weights[arc]);
+				}
+			}
+
+			index_type best = own;
+			double best_gain = weights.weight[own] - scale * (totals[own] - strength);
+
+			typename std::vector<index_type>::const_iterator iter = weights.touched.begin();
+			for(; iter != weights.touched.end(); ++iter) {
+				if(*iter != own) {
+					double gain = weights.weight[*iter] - scale * totals[*iter];
+					if(gain > best_gain + EPSILON) {
+						best = *iter;
+						best_gain = gain;
+					}
+				}
+			}
+
+			weights.clear();
+			return best;
+		}
+
+		/*
+		 * Leiden refinement. Inside each community every vertex starts as
+		 * its own subcommunity, and a vertex that is still alone and well
+		 * connected to its community joins the well connected
+		 * subcommunity with the largest non-negative gain. Subcommunities
+		 * are identified by the index of the vertex they started from.
+		 */
+		void refine_communities(const level_graph &current, const std::vector<index_type> &community, size_type num_communities, std::vector<index_type> &refined) {
+			size_type size = current.size();
+
+			std::vector<size_type> starts(num_communities + 1, 0);
+			for(size_type vertex = 0; vertex < size; vertex++) {
+				starts[community[vertex]+1]++;
+			}
+			for(size_type comm = 0; comm < num_communities; comm++) {
+				starts[comm+1] += starts[comm];
+			}
+
+			std::vector<index_type> members(size);
+			std::vector<size_type> fill(starts.begin(), starts.end() - 1);
+			for(size_type vertex = 0; vertex < size; vertex++) {
+				members[fill[community[vertex]]++] = (index_type)vertex;
+			}
+
+			std::vector<double> sub_total(current.strength);
+			std::vector<double> sub_external(size, 0.0);
+			std::vector<char> alone(size, 1);
+			for(size_type vertex = 0; vertex < size; vertex++) {
+				refined[vertex] = (index_type)vertex;
+				for(size_type arc = current.offsets[vertex]; arc < current.offsets[vertex+1]; arc++) {
+					index_type neighbor = current.targets[arc];
+					if(neighbor != vertex && community[neighbor] == community[vertex]) {
+						sub_external[vertex] += current.weights[arc];
+					}
+				}
+			}
+
+			/* split by community size, so one giant community does not hold up the rest */
+			parallel::weighted_for(0, num_communities, 256, [&](size_type comm) { return starts[comm] + comm; }, [&](size_type comm) {
+				scratch &weights = scratches[parallel::thread_index()];
+
+				double comm_total = 0.0;
+				for(size_type ii = starts[comm]; ii < starts[comm+1]; ii++) {
+					comm_total += current.strength[members[ii]];
+				}
+
+				for(size_type ii = starts[comm]; ii < starts[comm+1]; ii++) {
+					index_type vertex = members[ii];
+					double strength = current.strength[vertex];
+					double scale = resolution * strength / current.total;
+
+					if(!alone[vertex] || sub_external[vertex] < scale * (comm_total - strength)) {
+						continue;
+					}
+
+					for(size_type arc = current.offsets[vertex]; arc < current.offsets[vertex+1]; arc++) {
+						index_type neighbor = current.targets[arc];
+						if(neighbor != vertex && community[neighbor] == (index_type)comm) {
+							weights.add(refined[neighbor], current.weights[arc]);
+						}
+					}
+
+					index_type best = vertex;
+					double best_gain = 0.0;
+					typename std::vector<index_type>::const_iterator iter = weights.touched.begin();
+					for(; iter != weights.touched.end(); ++iter) {
+						index_type sub = *iter;
+						double sub_scale = resolution * sub_total[sub] / current.total;
+						if(sub_external[sub] < sub_scale * (comm_total - sub_total[sub])) {
+							continue;
+						}
+
+						double gain = weights.weight[sub] - scale * sub_total[sub];
+						if(gain > best_gain + EPSILON) {
+							best = sub;
+							best_gain = gain;
+						}
+					}
+
+					if(best != vertex) {
+						sub_external[best] += sub_external[vertex] - 2.0 * weights.weight[best];
+						sub_total[best] += strength;
+						sub_total[vertex] = 0.0;
+						refined[vertex] = best;
+						alone[vertex] = 0;
+						alone[best] = 0;
+					}
+
+					weights.clear();
+				}
+			});
+		}
+
+		/* collapses every part into one vertex by sorting its edges */
+		static void aggregate(const level_graph &current, const std::vector<index_type> &part, size_type num_parts, level_graph &next) {
+			std::vector<aggregate_edge> edges;
+			edges.reserve(current.targets.size() / 2 + current.size());
+
+			for(size_type vertex = 0; vertex < current.size(); vertex++) {
+				for(size_type arc = current.offsets[vertex]; arc < current.offsets[vertex+1]; arc++) {
+					index_type neighbor = current.targets[arc];
+					if(neighbor < vertex) {
+						continue;
+					}
+
+					aggregate_edge edge;
+					edge.src = std::min(part[vertex], part[neighbor]);
+					edge.dst = std::max(part[vertex], part[neighbor]);
+					edge.weight = current.weights[arc];
+					edges.push_back(edge);
+				}
+			}
+
+			std::sort(edges.begin(), edges.end());
+
+			size_type unique = 0;
+			for(size_type ii = 0; ii < edges.size(); ii++) {
+				if(unique > 0 && edges[unique-1].src == edges[ii].src && edges[unique-1].dst == edges[ii].dst) {
+					edges[unique-1].weight += edges[ii].weight;
+				}
+				else {
+					edges[unique++] = edges[ii];
+				}
+			}
+			edges.resize(unique);
+
+			next.offsets.assign(num_parts + 1, 0);
+			next.strength.assign(num_parts, 0.0);
+			next.total = current.total;
+
+			typename std::vector<aggregate_edge>::const_iterator edge_iter = edges.begin();
+			for(; edge_iter != edges.end(); ++edge_iter) {
+				next.offsets[edge_iter->src+1]++;
+				if(edge_iter->src != edge_iter->dst) {
+					next.offsets[edge_iter->dst+1]++;
+				}
+			}
+			for(size_type vertex = 0; vertex < num_parts; vertex++) {
+				next.offsets[vertex+1] += next.offsets[vertex];
+			}
+
+			/* same ordering argument as compact_graph: lists come out sorted */
+			std::vector<size_type> fill(next.offsets.begin(), next.offsets.end() - 1);
+			next.targets.resize(next.offsets.back());
+			next.weights.resize(next.offsets.back());
+			for(edge_iter = edges.begin(); edge_iter != edges.end(); ++edge_iter) {
+				size_type arc = fill[edge_iter->src]++;
+				next.targets[arc] = edge_iter->dst;
+				next.weights[arc] = edge_iter->weight;
+
+				if(edge_iter->src != edge_iter->dst) {
+					arc = fill[edge_iter->dst]++;
+					next.targets[arc] = edge_iter->src;
+					next.weights[arc] = edge_iter->weight;
+
+					next.strength[edge_iter->src] += edge_iter->weight;
+					next.strength[edge_iter->dst] += edge_iter->weight;
+				}
+				else {
+					next.strength[edge_iter->src] += 2.0 * edge_iter->weight;
+				}
+			}
+		}
+};
+
+template <typename V>
+const double louvain<V>::EPSILON = 1e-12;
+
+#endif
@@ -0,0 +1,567 @@
+#ifndef _MAXIMAL_CLIQUES_HH_
+#define _MAXIMAL_CLIQUES_HH_
+
+#include <vector>
+#include <memory>
+#include <utility>
+
+#include <algorithm>
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+#include "graph.hh"
+#include "compact_graph.hh"
+#include "parallel.hh"
+#include "checkpoint.hh"
+
+/*
+ * Maximal clique enumeration (Bron-Kerbosch with Tomita pivoting over a
+ * degeneracy ordering, after Eppstein, Loffler and Strash). Every vertex
+ * of the ordering is an independent subproblem whose candidate (P) and
+ * excluded (X) sets are dense bitsets over that vertex's neighborhood;
+ * subproblems are spread across threads by the parallel runtime.
+ */
+template <typename V>
+class maximal_cliques {
+	public:
+		typedef size_t size_type;
+		typedef typename compact_graph<V>::index_type index_type;
+
+		typedef typename compact_graph<V>::VERTEX VERTEX;
+		typedef std::vector<VERTEX> CLIQUE;
+
+		template <typename Storage>
+		explicit maximal_cliques(const graph<V, Storage> &other) : adjacency(other) {
+			compute_ordering();
+		}
+
+		explicit maximal_cliques(const compact_graph<V> &other) : adjacency(other) {
+			compute_ordering();
+		}
+
+		/*
+		 * Capacity
+		 */
+		size_type degeneracy() const {
+			return core;
+		}
+
+		/*
+		 * Operations
+		 */
+
+		/* number of maximal cliques with at least min_size vertices */
+		size_type count(size_type min_size=1) const {
+			parallel::per_thread<search_state> states(search_state(adjacency.size_vertices()));
+			parallel::per_thread<clique_counter> counters;
+
+			parallel::parallel_for(0, order.size(), 1, [&](size_type ii) {
+				expand_vertex(ii, min_size, states.local(), counters.local());
+			});
+
+			size_type total = 0;
+			typename parallel::per_thread<clique_counter>::const_iterator iter = counters.begin();
+			for(; iter != counters.end(); ++iter) {
+				total += iter->total;
+			}
+			return total;
+		}
+
+		/* appends every maximal clique with at least min_size vertices */
+		size_type enumerate(std::vector<CLIQUE> &cliques, size_type min_size=1) const {
+			size_type before = cliques.size();
+
+			parallel::per_thread<search_state> states(search_state(adjacency.size_vertices()));
+			clique_collector empty(adjacency);
+			parallel::per_thread<clique_collector> collectors(empty);
+
+			parallel::parallel_for(0, order.size(), 1, [&](size_type ii) {
+				expand_vertex(ii, min_size, states.local(), collectors.local());
+			});
+
+			typename parallel::per_thread<clique_collector>::const_iterator iter = collectors.begin();
+			for(; iter != collectors.end(); ++iter) {
+				cliques.insert(cliques.end(), iter->cliques.begin(), iter->cliques.end());
+			}
+
+			return cliques.size() - before;
+		}
+
+		/*
+		 * As count() and enumerate(), but the ordering is searched in
+		 * batches with a checkpoint between batches when one is due. The
+		 * checkpoint holds the position reached in the ordering and what
+		 * has been found before it; a run continues from it if there is
+		 * one and removes it when done.
+		 */
+		size_type count(size_type min_size, checkpointer &checkpoints) const {
+			size_type total = 0;
+			search_batches(min_size, checkpoints, "maximal_cliques count", clique_counter(), [&](const clique_counter &counter) {
+				total += counter.total;
+			}, [&](binary_io::buffer &output) {
+				output.value((uint64_t)total);
+			}, [&](binary_io::reader &input) {
+				uint64_t found = 0;
+				input.value(found);
+				total = (size_type)found;
+			});
+			return total;
+		}
+
+		size_type enumerate(std::vector<CLIQUE> &cliques, size_type min_size, checkpointer &checkpoints) const {
+			std::vector<index_type> found;
+			search_batches(min_size, checkpoints, "maximal_cliques enumerate", index_collector(), [&](const index_collector &collector) {
+				found.insert(found.end(), collector.cliques.begin(), collector.cliques.end());
+			}, [&](binary_io::buffer &output) {
+				output.array(found);
+			}, [&](binary_io::reader &input) {
+				input.array(found);
+				for(size_type ii = 0; ii < found.size(); ii += found[ii] + 1) {
+					if(found[ii] == 0 || found[ii] >= found.size() - ii) {
+						input.fail("checkpoint has a malformed clique list");
+					}
+					for(size_type jj = ii + 1; jj <= ii + found[ii]; jj++) {
+						if(found[jj] >= adjacency.size_vertices()) {
+							input.fail("checkpoint has a malformed clique list");
+						}
+					}
+				}
+			});
+
+			size_type before = cliques.size();
+			for(size_type ii = 0; ii < found.size(); ii += found[ii] + 1) {
+				cliques.push_back(CLIQUE());
+				CLIQUE &result = cliques.back();
+				result.reserve(found[ii]);
+				for(size_type jj = ii + 1; jj <= ii + found[ii]; jj++) {
+					result.push_back(adjacency.vertex(found[jj]));
+				}
+			}
+			return cliques.size() - before;
+		}
+
+	protected:
+		typedef unsigned long word_type;
+
+		static const size_type WORD_BITS = sizeof(word_type) * CHAR_BIT;
+		static const index_type NONE = (index_type)-1;
+
+		compact_graph<V> adjacency;
+		std::vector<index_type> order;
+		std::vector<index_type> position;
+		size_type core;
+
+		struct clique_counter {
+			size_type total;
+
+			clique_counter() : total(0) {
+
+			}
+
+			void operator()(const std::vector<index_type> &clique) {
+				total++;
+			}
+		};
+
+		struct clique_collector {
+			const compact_graph<V> &adjacency;
+			std::vector<CLIQUE> cliques;
+
+			clique_collector(const compact_graph<V> &adjacency) : adjacency(adjacency) {
+
+			}
+
+			void operator()(const std::vector<index_type> &clique) {
+				std::vector<index_type> sorted(clique);
+				std::sort(sorted.begin(), sorted.end());
+
+				cliques.push_back(CLIQUE());
+				CLIQUE &result = cliques.back();
+				result.reserve(sorted.size());
+
+				typename std::vector<index_type>::const_iterator iter = sorted.begin();
+				for(; iter != sorted.end(); ++iter) {
+					result.push_back(adjacency.vertex(*iter));
+				}
+			}
+		};
+
+		/* cliques as sorted indices, each preceded by its size */
+		struct index_collector {
+			std::vector<index_type> cliques;
+
+			void operator()(const std::vector<index_type> &clique) {
+				size_type start = cliques.size();
+				cliques.push_back((index_type)clique.size());
+				cliques.insert(cliques.end(), clique.begin(), clique.end());
+				std::sort(cliques.begin() + start + 1, cliques.end());
+			}
+		};
+
+		/*
+		 * Per-thread scratch space. local maps a graph index to its slot in
+		 * the current neighborhood (P vertices first, then X vertices) and
+		 * is reset after every subproblem, so it is allocated only once.
+		 */
+		struct search_state {
+			std::vector<index_type> local;
+			std::vector<index_type> members;
+			std::vector<word_type> rows;
+			std::vector<std::vector<word_type> > levels;
+			std::vector<index_type> clique;
+
+			size_type candidates;
+			size_type words_p;
+			size_type words_m;
+
+			search_state(size_type num_vertices) : local(num_vertices, NONE), candidates(0), words_p(0), words_m(0) {
+
+			}
+
+			/* P vertices own full rows of words_m words, X vertices only words_p */
+			word_type * row(size_type slot) {
+				if(slot < candidates) {
+					return &rows[slot * words_m];
+				}
+				return &rows[candidates * words_m + (slot - candidates) * words_p];
+			}
+
+			word_type * level(size_type depth) {
+				if(levels.size() <= depth) {
+					levels.resize(depth + 1);
+				}
+				levels[depth].resize(words_p + words_m + 1);
+				return &levels[depth][0];
+			}
+		};
+
+		static size_type words(size_type bits) {
+			return (bits + WORD_BITS - 1) / WORD_BITS;
+		}
+
+		static void set_bit(word_type *bits, size_type bit) {
+			bits[bit / WORD_BITS] |= (word_type)1 << (bit % WORD_BITS);
+		}
+
+		static void clear_bit(word_type *bits, size_type bit) {
+			bits[bit / WORD_BITS] &= ~((word_type)1 << (bit % WORD_BITS));
+		}
+
+		static bool test_bit(const word_type *bits, size_type bit) {
+			return (bits[bit / WORD_BITS] >> (bit % WORD_BITS)) & 1;
+		}
+
+		static size_type popcount(const word_type *bits, size_type num_words) {
+			size_type total = 0;
+			for(size_type ii = 0; ii < num_words; ii++) {
+				total += __builtin_popcountl(bits[ii]);
+			}
+			return total;
+		}
+
+		static size_type popcount_and(const word_type *lhs, const word_type *rhs, size_type num_words) {
+			size_type total = 0;
+			for(size_type ii = 0; ii < num_words; ii++) {
+				total += __builtin_popcountl(lhs[ii] & rhs[ii]);
+			}
+			return total;
+		}
+
+		static bool empty(const word_type *bits, size_type num_words) {
+			for(size_type ii = 0; ii < num_words; ii++) {
+				if(bits[ii]) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		/*
+		 * Searches the ordering from the checkpoint's position (or the
+		 * start) in batches. collect folds each thread's reporter into
+		 * the running result after a batch, and save and load write and
+		 * read that result after the position.
+		 */
+		template <typename Reporter, typename Collect, typename Save, typename Load>
+		void search_batches(size_type min_size, checkpointer &checkpoints, const char *kind, const Reporter &prototype, Collect collect, Save save, Load load) const {
+			size_type num_vertices = order.size();
+			uint64_t key = hashing::combine(checkpointer::fingerprint(adjacency), min_size);
+
+			size_type next = 0;
+			std::unique_ptr<binary_io::reader> input;
+			if(checkpoints.resume(input, kind, key)) {
+				uint64_t position = 0;
+				input->value(position);
+				if(position > num_vertices) {
+					input->fail("checkpoint position is past the end of the graph");
+				}
+				load(*input);
+				input->finish();
+				next = (size_type)position;
+			}
+
+			/* big enough to keep every thread busy, small enough to checkpoint often */
+			size_type batch = std::max((size_type)4096, num_vertices / 256);
+			parallel::per_thread<search_state> states(search_state(adjacency.size_vertices()));
+
+			while(next < num_vertices) {
+				size_type last = std::min(next + batch, num_vertices);
+				parallel::per_thread<Reporter> reporters(prototype);
+				parallel::parallel_for(next, last, 1, [&](size_type ii) {
+					expand_vertex(ii, min_size, states.local(), reporters.local());
+				});
+
+				typename parallel::per_thread<Reporter>::const_iterator iter = reporters.begin();
+				for(; iter != reporters.end(); ++iter) {
+					collect(*iter);
+				}
+				next = last;
+
+				if(next < num_vertices && checkpoints.due()) {
+					binary_io::buffer &output = checkpoints.state(kind, key);
+					output.value((uint64_t)next);
+					save(output);
+					checkpoints.submit();
+				}
+			}
+
+			checkpoints.complete();
+		}
+
+		/*
+		 * Degeneracy ordering by repeatedly removing a minimum degree
+		 * vertex, using bucket queues (Batagelj and Zaversnik).
+		 */
+		void compute_ordering() {
+			size_type num_vertices = adjacency.size_vertices();
+			std::vector<size_type> degree(num_vertices, 0);
+			size_type max_degree = 0;
+
+			for(size_type vertex = 0; vertex < num_vertices; vertex++) {
+				typename compact_graph<V>::const_neighbor_iterator iter = adjacency.begin_neighbors(vertex);
+				for(; iter != adjacency.end_neighbors(vertex); ++iter) {
+					if(*iter != vertex) {
+						degree[vertex]++;
+					}
+				}
+				max_degree = std::max(max_degree, degree[vertex]);
+			}
+
+			std::vector<size_type> bin(max_degree + 1, 0);
+			for(size_type vertex = 0; vertex < num_vertices; vertex++) {
+				bin[degree[vertex]]++;
+			}
+
+			size_type start = 0;
+			for(size_type deg = 0; deg <= max_degree; deg++) {
+				size_type num = bin[deg];
+				bin[deg] = start;
+				start += num;
+			}
+
+			order.assign(num_vertices, 0);
+			position.assign(num_vertices, 0);
+			for(size_type vertex = 0; vertex < num_vertices; vertex++) {
+				position[vertex] = (index_type)bin[degree[vertex]]++;
+				order[position[vertex]] = (index_type)vertex;
+			}
+
+			for(size_type deg = max_degree; deg > 0; deg--) {
+				bin[deg] = bin[deg-1];
+			}
+			if(!bin.empty()) {
+				bin[0] = 0;
+			}
+
+			core = 0;
+			for(size_type ii = 0; ii < num_vertices; ii++) {
+				index_type vertex = order[ii];
+				core = std::max(core, degree[vertex]);
+
+				typename compact_graph<V>::const_neighbor_iterator iter = adjacency.begin_neighbors(vertex);
+				for(; iter != adjacency.end_neighbors(vertex); ++iter) {
+					index_type neighbor = *iter;
+					if(degree[neighbor] > degree[vertex]) {
+						size_type deg = degree[neighbor];
+						index_type first = order[bin[deg]];
+						if(first != neighbor) {
+							std::swap(order[position[neighbor]], order[bin[deg]]);
+							std::swap(position[neighbor], position[first]);
+						}
+						bin[deg]++;
+						degree[neighbor]--;
+					}
+				}
+			}
+		}
+
+		bool adjacent(index_type src, index_type dst) const {
+			return adjacency.has_edge(src, dst);
+		}
+
+		/*
+		 * Builds the bitset neighborhood of order[ii]: P holds its later
+		 * neighbors in the ordering and X its earlier ones. Only P rows are
+		 * read from the graph; X rows are the transpose of the P rows.
+		 */
+		template <typename Reporter>
+		void expand_vertex(size_type ii, size_type min_size, search_state &state, Reporter &report) const {
+			index_type vertex = order[ii];
+
+			state.members.clear();
+			typename compact_graph<V>::const_neighbor_iterator iter = adjacency.begin_neighbors(vertex);
+			for(; iter != adjacency.end_neighbors(vertex); ++iter) {
+				if(*iter != vertex && position[*iter] > ii) {
+					state.members.push_back(*iter);
+				}
+			}
+			state.candidates = state.members.size();
+
+			if(state.candidates + 1 < min_size) {
+				return;
+			}
+
+			iter = adjacency.begin_neighbors(vertex);
+			for(; iter != adjacency.end_neighbors(vertex); ++iter) {
+				if(*iter != vertex && position[*iter] < ii) {
+					state.members.push_back(*iter);
+				}
+			}
+
+			size_type num_members = state.members.size();
+			for(size_type slot = 0; slot < num_members; slot++) {
+				state.local[state.members[slot]] = (index_type)slot;
+			}
+
+			state.words_p = words(state.candidates);
+			state.words_m = words(num_members);
+			state.rows.assign(state.candidates * state.words_m + (num_members - state.candidates) * state.words_p, 0);
+
+			for(size_type slot = 0; slot < state.candidates; slot++) {
+				index_type member = state.members[slot];
+				word_type *row = state.row(slot);
+
+				/*
+				 * Scan the member's own adjacency unless it is a hub much
+				 * larger than this neighborhood, in which case probe it
+				 * once per neighborhood vertex instead.
+				 */
+				if(adjacency.degree(member) <= 8 * num_members) {
+					iter = adjacency.begin_neighbors(member);
+					for(; iter != adjacency.end_neighbors(member); ++iter) {
+						index_type other = state.local[*iter];
+						if(other != NONE && *iter != member) {
+							set_bit(row, other);
+						}
+					}
+				}
+				else {
+					for(size_type other = 0; other < num_members; other++) {
+						if(other != slot && adjacent(member, state.members[other])) {
+							set_bit(row, other);
+						}
+					}
+				}
+
+				for(size_type other = state.candidates; other < num_members; other++) {
+					if(test_bit(row, other)) {
+						set_bit(state.row(other), slot);
+					}
+				}
+			}
+
+			for(size_type slot = 0; slot < num_members; slot++) {
+				state.local[state.members[slot]] = NONE;
+			}
+
+			word_type *candidates = state.level(0);
+			word_type *excluded = candidates + state.words_p;
+			std::fill(candidates, candidates + state.words_p + state.words_m, 0);
+			for(size_type slot = 0; slot < state.candidates; slot++) {
+				set_bit(candidates, slot);
+			}
+			for(size_type slot = state.candidates; slot < num_members; slot++) {
+				set_bit(excluded, slot);
+			}
+
+			state.clique.clear();
+			state.clique.push_back(vertex);
+			expand(0, min_size, state, report);
+		}
+
+		template <typename Reporter>
+		void expand(size_type depth, size_type min_size, search_state &state, Reporter &report) const {
+			size_type words_p = state.words_p;
+			size_type words_m = state.words_m;
+			size_type num_members = state.members.size();
+
+			word_type *candidates = &state.levels[depth][0];
+			word_type *excluded = candidates + words_p;
+
+			size_type num_candidates = popcount(candidates, words_p);
+			if(num_candidates == 0) {
+				if(empty(excluded, words_m) && state.clique.size() >= min_size) {
+					report(state.clique);
+				}
+				return;
+			}
+			if(state.clique.size() + num_candidates < min_size) {
+				return;
+			}
+
+			/* pivot on the vertex of P or X covering the most of P */
+			size_type pivot = 0, best = 0;
+			bool found = false;
+			for(size_type slot = 0; slot < num_members; slot++) {
+				if(test_bit(candidates, slot) || test_bit(excluded, slot)) {
+					size_type covered = popcount_and(candidates, state.row(slot), words_p);
+					if(!found || covered > best) {
+						pivot = slot;
+						best = covered;
+						found = true;
+						if(covered == num_candidates) {
+							break;
+						}
+					}
+				}
+			}
+			const word_type *pivot_row = state.row(pivot);
+
+			for(size_type word = 0; word < words_p; word++) {
+				word_type pending = candidates[word] & ~pivot_row[word];
+				while(pending) {
+					size_type slot = word * WORD_BITS + __builtin_ctzl(pending);
+					pending &= pending - 1;
+
+					/* level() may reallocate the level table */
+					word_type *next = state.level(depth + 1);
+					candidates = &state.levels[depth][0];
+					excluded = candidates + words_p;
+
+					const word_type *row = state.row(slot);
+					for(size_type ii = 0; ii < words_p; ii++) {
+						next[ii] = candidates[ii] & row[ii];
+					}
+					for(size_type ii = 0; ii < words_m; ii++) {
+						next[words_p + ii] = excluded[ii] & row[ii];
+					}
+
+					state.clique.push_back(state.members[slot]);
+					expand(depth + 1, min_size, state, report);
+					state.clique.pop_back();
+
+					candidates = &state.levels[depth][0];
+					excluded = candidates + words_p;
+					clear_bit(candidates, slot);
+					set_bit(excluded, slot);
+				}
+			}
+		}
+};
+
+template <typename V>
+const typename maximal_cliques<V>::index_type maximal_cliques<V>::NONE;
+
+#endif
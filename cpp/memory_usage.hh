@@ -0,0 +1,262 @@
+#ifndef _MEMORY_USAGE_HH_
+#define _MEMORY_USAGE_HH_
+
+#include <ostream>
+
+#include <string>
+#include <utility>
+#include <new>
+
+#include <atomic>
+
+#include <cstdlib>
+#include <cstddef>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+/*
+ * Breakdown of the memory held by a data structure, in bytes.
+ *
+ *   nodes     container bookkeeping: tree links and colors, container
+ *             headers, shared_ptr control blocks, index arrays
+ *   keys      the key objects themselves (vertices, edges, label text)
+ *   payloads  mapped values and separately allocated objects
+ *   strings   heap buffers owned by std::string keys and payloads
+ *   overhead  bytes the allocator adds on top of every request
+ *
+ * Node counts are exact; node header and allocator overhead sizes follow
+ * the libstdc++ red-black tree and glibc malloc layouts.
+ */
+struct memory_report {
+	size_t nodes;
+	size_t keys;
+	size_t payloads;
+	size_t strings;
+	size_t overhead;
+
+	memory_report() : nodes(0), keys(0), payloads(0), strings(0), overhead(0) {
+
+	}
+
+	size_t total() const {
+		return nodes + keys + payloads + strings + overhead;
+	}
+
+	memory_report & operator+=(const memory_report &other) {
+		nodes += other.nodes;
+		keys += other.keys;
+		payloads += other.payloads;
+		strings += other.strings;
+		overhead += other.overhead;
+
+		return *this;
+	}
+
+	friend std::ostream & operator<<(std::ostream &output, const memory_report &usage) {
+		output << "nodes=" << usage.nodes;
+		output << " keys=" << usage.keys;
+		output << " payloads=" << usage.payloads;
+		output << " strings=" << usage.strings;
+		output << " overhead=" << usage.overhead;
+		output << " total=" << usage.total();
+
+		return output;
+	}
+};
+
+namespace memory_accounting {
+	/* parent, left and right links plus the color, padded */
+	const size_t TREE_NODE_HEADER = 4 * sizeof(void *);
+
+	/* bytes malloc adds to a request of the given size (glibc chunk layout) */
+	inline size_t allocation_overhead(size_t bytes) {
+		const size_t header = sizeof(size_t);
+		const size_t align = 2 * sizeof(void *);
+		const size_t minimum = 4 * sizeof(void *);
+
+		size_t chunk = (bytes + header + align - 1) & ~(align - 1);
+		if(chunk < minimum) {
+			chunk = minimum;
+		}
+		return chunk - bytes;
+	}
+
+	inline size_t tree_node(size_t value_size) {
+		return TREE_NODE_HEADER + value_size;
+	}
+
+	/*
+	 * Heap bytes owned by a value beyond sizeof(T). Only std::string (and
+	 * pairs containing one) own any; pointers to labels do not own the
+	 * label, which is accounted for by its label_list.
+	 */
+	template <typename T>
+	struct heap_usage {
+		static const bool dynamic = false;
+
+		static size_t bytes(const T &) {
+			return 0;
+		}
+	};
+
+	template <>
+	struct heap_usage<std::string> {
+		static const bool dynamic = true;
+
+		static size_t bytes(const std::string &value) {
+			static const size_t local = std::string().capacity();
+			if(value.capacity() <= local) {
+				return 0;
+			}
+			return value.capacity() + 1 + allocation_overhead(value.capacity() + 1);
+		}
+	};
+
+	template <typename T1, typename T2>
+	struct heap_usage<std::pair<T1,T2> > {
+		static const bool dynamic = heap_usage<T1>::dynamic || heap_usage<T2>::dynamic;
+
+		static size_t bytes(const std::pair<T1,T2> &value) {
+			return heap_usage<T1>::bytes(value.first) + heap_usage<T2>::bytes(value.second);
+		}
+	};
+
+	template <typename T>
+	struct heap_usage<const T> : heap_usage<T> {
+
+	};
+
+	/* sums heap_usage over a range, skipping the walk for types without heap data */
+	template <typename Iterator, typename T>
+	size_t heap_bytes(Iterator begin, Iterator end, const T *) {
+		size_t total = 0;
+		if(heap_usage<T>::dynamic) {
+			for(; begin != end; ++begin) {
+				total += heap_usage<T>::bytes(*begin);
+			}
+		}
+		return total;
+	}
+}
+
+/*
+ * Process-wide tally of live allocations made through counting_allocator
+ * and the other accounting hooks. requested is what callers asked for,
+ * reserved what the allocator actually set aside for them.
+ */
+class allocation_counter {
+	public:
+		struct snapshot {
+			size_t blocks;
+			size_t requested;
+			size_t reserved;
+			size_t peak;
+
+			friend std::ostream & operator<<(std::ostream &output, const snapshot &counts) {
+				output << "blocks=" << counts.blocks;
+				output << " requested=" << counts.requested;
+				output << " reserved=" << counts.reserved;
+				output << " peak=" << counts.peak;
+
+				return output;
+			}
+		};
+
+		static allocation_counter & global() {
+			static allocation_counter counter;
+			return counter;
+		}
+
+		void add(size_t requested_bytes, size_t reserved_bytes) {
+			blocks.fetch_add(1, std::memory_order_relaxed);
+			requested.fetch_add(requested_bytes, std::memory_order_relaxed);
+
+			size_t current = reserved.fetch_add(reserved_bytes, std::memory_order_relaxed) + reserved_bytes;
+			size_t highest = peak.load(std::memory_order_relaxed);
+			while(current > highest && !peak.compare_exchange_weak(highest, current, std::memory_order_relaxed)) {
+
+			}
+		}
+
+		void remove(size_t requested_bytes, size_t reserved_bytes) {
+			blocks.fetch_sub(1, std::memory_order_relaxed);
+			requested.fetch_sub(requested_bytes, std::memory_order_relaxed);
+			reserved.fetch_sub(reserved_bytes, std::memory_order_relaxed);
+		}
+
+		snapshot counts() const {
+			snapshot result;
+			result.blocks = blocks.load(std::memory_order_relaxed);
+			result.requested = requested.load(std::memory_order_relaxed);
+			result.reserved = reserved.load(std::memory_order_relaxed);
+			result.peak = peak.load(std::memory_order_relaxed);
+
+			return result;
+		}
+
+	protected:
+		std::atomic<size_t> blocks;
+		std::atomic<size_t> requested;
+		std::atomic<size_t> reserved;
+		std::atomic<size_t> peak;
+
+		allocation_counter() : blocks(0), requested(0), reserved(0), peak(0) {
+
+		}
+};
+
+/* std::allocator replacement that reports to allocation_counter::global() */
+template <typename T>
+class counting_allocator {
+	public:
+		typedef T value_type;
+
+		counting_allocator() {
+
+		}
+
+		template <typename U>
+		counting_allocator(const counting_allocator<U> &) {
+
+		}
+
+		T * allocate(size_t count) {
+			size_t bytes = count * sizeof(T);
+			void *memory = std::malloc(bytes);
+			if(memory == NULL) {
+				throw std::bad_alloc();
+			}
+
+			allocation_counter::global().add(bytes, reserved(memory, bytes));
+			return static_cast<T *>(memory);
+		}
+
+		void deallocate(T *memory, size_t count) {
+			size_t bytes = count * sizeof(T);
+			allocation_counter::global().remove(bytes, reserved(memory, bytes));
+			std::free(memory);
+		}
+
+		template <typename U>
+		bool operator==(const counting_allocator<U> &) const {
+			return true;
+		}
+
+		template <typename U>
+		bool operator!=(const counting_allocator<U> &) const {
+			return false;
+		}
+
+	protected:
+		static size_t reserved(void *memory, size_t bytes) {
+#ifdef __GLIBC__
+			return malloc_usable_size(memory) + sizeof(size_t);
+#else
+			return bytes + memory_accounting::allocation_overhead(bytes);
+#endif
+		}
+};
+
+#endif
@@ -0,0 +1,376 @@
+#ifndef _NEIGHBORHOOD_FUNCTION_HH_
+#define _NEIGHBORHOOD_FUNCTION_HH_
+
+#include <vector>
+#include <memory>
+
+#include <sstream>
+
+#include <algorithm>
+#include <numeric>
+
+#include <stdexcept>
+
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NEIGHBORHOOD_FUNCTION_X86 1
+#include <immintrin.h>
+#endif
+
+#include "graph.hh"
+#include "compact_graph.hh"
+#include "hashing.hh"
+#include "hyperloglog.hh"
+#include "parallel.hh"
+#include "checkpoint.hh"
+
+/*
+ * Approximate neighborhood function (HyperANF, Boldi, Rosa and Vigna,
+ * 2011). Every vertex holds a HyperLogLog counter of the vertices within
+ * t hops of it; one step turns t into t+1 by taking the register-wise
+ * maximum of the counter and its neighbors' counters. Each step is a
+ * linear pass over the adjacency, and the run ends when no counter
+ * changes, i.e. after diameter + 1 steps.
+ *
+ * N(t), the number of ordered pairs at distance at most t, is the sum of
+ * the counters after step t. Harmonic centrality, the sum of 1/d(x,y)
+ * over y != x, accumulates from the growth of each counter. Estimates
+ * carry the relative standard error of a single counter.
+ *
+ * The maximum is taken 32 or 16 registers at a time with AVX2 or SSE2,
+ * picked at runtime, and only over vertices next to a counter that
+ * changed in the previous step.
+ */
+template <typename V>
+class neighborhood_function {
+	public:
+		typedef size_t size_type;
+		typedef typename compact_graph<V>::index_type index_type;
+
+		typedef typename compact_graph<V>::VERTEX VERTEX;
+
+		typedef bool (*merge_function)(uint8_t *target, const uint8_t *source, size_type length);
+
+		template <typename Storage>
+		explicit neighborhood_function(const graph<V, Storage> &other, unsigned int precision=6, uint64_t seed=0) : adjacency(other) {
+			initialize(precision, seed);
+		}
+
+		explicit neighborhood_function(const compact_graph<V> &other, unsigned int precision=6, uint64_t seed=0) : adjacency(other) {
+			initialize(precision, seed);
+		}
+
+		/*
+		 * Capacity
+		 */
+
+		/* steps taken; N(t) is known for t up to this */
+		size_type size_steps() const {
+			return values.size() - 1;
+		}
+
+		bool done() const {
+			return stable;
+		}
+
+		double relative_error() const {
+			return hyperloglog::relative_error(bits);
+		}
+
+		/*
+		 * Element Access
+		 */
+
+		/* N(t) for t = 0..size_steps() */
+		const std::vector<double> & function() const {
+			return values;
+		}
+
+		double harmonic_centrality(size_type vertex) const {
+			return harmonic[vertex];
+		}
+
+		double harmonic_centrality(const VERTEX &vertex) const {
+			return harmonic[lookup(vertex)];
+		}
+
+		const compact_graph<V> & source() const {
+			return adjacency;
+		}
+
+		/*
+		 * Operations
+		 */
+
+		/* steps until no counter changes or max_steps (0 for no limit) have been taken */
+		void run(size_type max_steps=0) {
+			while(!stable && (max_steps == 0 || size_steps() < max_steps)) {
+				step();
+			}
+		}
+
+		/*
+		 * As run(), but first continues from the checkpoint if there is
+		 * one, and checkpoints between steps. The checkpoint is removed
+		 * once the counters are stable and kept if max_steps stops the
+		 * run early.
+		 */
+		void run(checkpointer &checkpoints, size_type max_steps=0) {
+			uint64_t key = fingerprint();
+			std::unique_ptr<binary_io::reader> input;
+			if(checkpoints.resume(input, "neighborhood_function", key)) {
+				restore(*input);
+			}
+
+			while(!stable && (max_steps == 0 || size_steps() < max_steps)) {
+				step();
+				if(!stable && checkpoints.due()) {
+					save(checkpoints.state("neighborhood_function", key));
+					checkpoints.submit();
+				}
+			}
+
+			if(stable) {
+				checkpoints.complete();
+			}
+			else {
+				save(checkpoints.state("neighborhood_function", key));
+				checkpoints.submit();
+				checkpoints.flush();
+			}
+		}
+
+		/* computes N(t+1) from N(t) */
+		void step() {
+			if(stable) {
+				return;
+			}
+
+			size_type registers = size_type(1) << bits;
+			size_type t = size_steps() + 1;
+
+			std::vector<uint8_t> next_changed(adjacency.size_vertices(), 0);
+			parallel::per_thread<size_type> num_changed(0);
+
+			parallel::for_each_vertex(adjacency, 1 << 12, [&](size_type ii) {
+				uint8_t *target = &next[ii * registers];
+				std::memcpy(target, &current[ii * registers], registers);
+
+				bool grew = false;
+				typename compact_graph<V>::const_neighbor_iterator iter = adjacency.begin_neighbors(ii);
+				for(; iter != adjacency.end_neighbors(ii); ++iter) {
+					if(changed[*iter]) {
+						grew |= merge(target, &current[*iter * registers], registers);
+					}
+				}
+
+				if(grew) {
+					next_changed[ii] = 1;
+					num_changed.local()++;
+
+					double size = hyperloglog::estimate(target, bits);
+					if(size > sizes[ii]) {
+						harmonic[ii] += (size - sizes[ii]) / (double)t;
+						sizes[ii] = size;
+					}
+				}
+			});
+
+			current.swap(next);
+			changed.swap(next_changed);
+
+			double total = 0.0;
+			for(size_type ii = 0; ii < sizes.size(); ii++) {
+				total += sizes[ii];
+			}
+
+			if(std::accumulate(num_changed.begin(), num_changed.end(), (size_type)0) == 0) {
+				stable = true;
+			}
+			else {
+				values.push_back(total);
+			}
+		}
+
+		/*
+		 * Smallest t, interpolated between steps, at which N(t) reaches
+		 * fraction of its final value.
+		 */
+		double effective_diameter(double fraction=0.9) const {
+			double target = fraction * values.back();
+			for(size_type t = 0; t < values.size(); t++) {
+				if(values[t] >= target) {
+					if(t == 0 || values[t] == values[t-1]) {
+						return (double)t;
+					}
+					return (double)(t - 1) + (target - values[t-1]) / (values[t] - values[t-1]);
+				}
+			}
+			return (double)(values.size() - 1);
+		}
+
+		/* mean distance over reachable ordered pairs of distinct vertices */
+		double average_distance() const {
+			double pairs = values.back() - values[0];
+			if(pairs <= 0.0) {
+				return 0.0;
+			}
+
+			double sum = 0.0;
+			for(size_type t = 1; t < values.size(); t++) {
+				sum += (double)t * (values[t] - values[t-1]);
+			}
+			return sum / pairs;
+		}
+
+		static bool merge_scalar(uint8_t *target, const uint8_t *source, size_type length) {
+			bool grew = false;
+			for(size_type ii = 0; ii < length; ii++) {
+				if(source[ii] > target[ii]) {
+					target[ii] = source[ii];
+					grew = true;
+				}
+			}
+			return grew;
+		}
+
+#ifdef NEIGHBORHOOD_FUNCTION_X86
+		static bool merge_sse2(uint8_t *target, const uint8_t *source, size_type length) {
+			size_type ii = 0;
+			int grew = 0;
+			for(; ii + 16 <= length; ii += 16) {
+				__m128i before = _mm_loadu_si128(reinterpret_cast<const __m128i *>(target + ii));
+				__m128i after = _mm_max_epu8(before, _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + ii)));
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(target + ii), after);
+				grew |= _mm_movemask_epi8(_mm_cmpeq_epi8(before, after)) ^ 0xffff;
+			}
+			return merge_scalar(target + ii, source + ii, length - ii) || grew != 0;
+		}
+
+		__attribute__((target("avx2")))
+		static bool merge_avx2(uint8_t *target, const uint8_t *source, size_type length) {
+			size_type ii = 0;
+			unsigned int grew = 0;
+			for(; ii + 32 <= length; ii += 32) {
+				__m256i before = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(target + ii));
+				__m256i after = _mm256_max_epu8(before, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + ii)));
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(target + ii), after);
+				grew |= ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(before, after));
+			}
+			return merge_sse2(target + ii, source + ii, length - ii) || grew != 0;
+		}
+#endif
+
+	protected:
+		compact_graph<V> adjacency;
+		unsigned int bits;
+		uint64_t seed;
+		merge_function merge;
+
+		/* counters of every vertex, 2^bits registers each */
+		std::vector<uint8_t> current;
+		std::vector<uint8_t> next;
+		std::vector<uint8_t> changed;
+
+		std::vector<double> sizes;
+		std::vector<double> harmonic;
+		std::vector<double> values;
+		bool stable;
+
+		static merge_function select_merge() {
+#ifdef NEIGHBORHOOD_FUNCTION_X86
+			__builtin_cpu_init();
+			if(__builtin_cpu_supports("avx2")) {
+				return merge_avx2;
+			}
+			return merge_sse2;
+#else
+			return merge_scalar;
+#endif
+		}
+
+		void initialize(unsigned int precision, uint64_t seed) {
+			if(precision < hyperloglog::MIN_PRECISION || precision > hyperloglog::MAX_PRECISION) {
+				std::ostringstream oss;
+				oss << "precision must be between " << hyperloglog::MIN_PRECISION << " and " << hyperloglog::MAX_PRECISION;
+
+				throw std::domain_error(oss.str());
+			}
+
+			bits = precision;
+			this->seed = seed;
+			merge = select_merge();
+
+			size_type num_vertices = adjacency.size_vertices();
+			size_type registers = size_type(1) << bits;
+
+			current.assign(num_vertices * registers, 0);
+			next.assign(num_vertices * registers, 0);
+			changed.assign(num_vertices, 1);
+			harmonic.assign(num_vertices, 0.0);
+			sizes.assign(num_vertices, 0.0);
+
+			/* B(v,0) = {v} */
+			for(size_type ii = 0; ii < num_vertices; ii++) {
+				uint64_t hash = hashing::mix(hashing::mix(ii) ^ seed);
+				uint8_t *counter = &current[ii * registers];
+				counter[hash >> (64 - bits)] = hyperloglog::rank(hash, bits);
+				sizes[ii] = hyperloglog::estimate(counter, bits);
+			}
+
+			double total = 0.0;
+			for(size_type ii = 0; ii < num_vertices; ii++) {
+				total += sizes[ii];
+			}
+			values.assign(1, total);
+			stable = num_vertices == 0;
+		}
+
+		/* the graph and the settings that decide the counters */
+		uint64_t fingerprint() const {
+			return hashing::combine(hashing::combine(checkpointer::fingerprint(adjacency), bits), seed);
+		}
+
+		void save(binary_io::buffer &output) const {
+			output.value((uint8_t)stable);
+			output.array(values);
+			output.array(current);
+			output.array(changed);
+			output.array(sizes);
+			output.array(harmonic);
+		}
+
+		void restore(binary_io::reader &input) {
+			size_type num_vertices = adjacency.size_vertices();
+			size_type num_registers = num_vertices << bits;
+
+			uint8_t done = 0;
+			input.value(done);
+			input.array(values);
+			input.array(current, num_registers);
+			input.array(changed, num_vertices);
+			input.array(sizes, num_vertices);
+			input.array(harmonic, num_vertices);
+			input.finish();
+			if(values.empty() || current.size() != num_registers || changed.size() != num_vertices || sizes.size() != num_vertices || harmonic.size() != num_vertices) {
+				input.fail("checkpoint does not match the graph");
+			}
+			stable = done != 0;
+		}
+
+		size_type lookup(const VERTEX &vertex) const {
+			size_type index = adjacency.index(vertex);
+			if(index == adjacency.size_vertices()) {
+				std::ostringstream oss;
+				oss << "unexpected vertex";
+
+				throw std::domain_error(oss.str());
+			}
+			return index;
+		}
+};
+
+#endif
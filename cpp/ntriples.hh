@@ -0,0 +1,487 @@
+#ifndef _NTRIPLES_HH_
+#define _NTRIPLES_HH_
+
+#include <fstream>
+#include <sstream>
+
+#include <string>
+#include <vector>
+
+#include <algorithm>
+
+#include <stdexcept>
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NTRIPLES_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+ * Block-at-a-time N-Triples tokenizer.
+ *
+ * Input is read in large chunks and classified 64 bytes at a time into
+ * bitmasks (whitespace, newline, '>', '"', '\\'), using AVX2 or SSE2 when
+ * the processor has them and a scalar loop otherwise. The tokenizer then
+ * jumps between interesting bytes with count-trailing-zeros instead of
+ * looking at every character, so an IRI costs one mask lookup no matter
+ * how long it is.
+ *
+ * Terms are IRIs (<...>), literals ("..." with backslash escapes and an
+ * optional @lang or ^^<datatype> suffix) and anything else up to the next
+ * whitespace (blank nodes). Every term keeps its delimiters. Blank lines
+ * and # comments are skipped.
+ */
+namespace ntriples {
+	const size_t BLOCK_SIZE = 64;
+
+	enum character_class {
+		SPACE = 1,
+		NEWLINE = 2,
+		CLOSE = 4,
+		QUOTE = 8,
+		ESCAPE = 16
+	};
+
+	enum kernel {
+		AUTOMATIC,
+		SCALAR,
+		SSE2,
+		AVX2
+	};
+
+	/* bit ii of each mask describes byte ii of the block */
+	struct block_masks {
+		uint64_t space;
+		uint64_t newline;
+		uint64_t close;
+		uint64_t quote;
+		uint64_t escape;
+
+		uint64_t select(unsigned int classes) const {
+			uint64_t bits = 0;
+			if(classes & SPACE) {
+				bits |= space;
+			}
+			if(classes & NEWLINE) {
+				bits |= newline;
+			}
+			if(classes & CLOSE) {
+				bits |= close;
+			}
+			if(classes & QUOTE) {
+				bits |= quote;
+			}
+			if(classes & ESCAPE) {
+				bits |= escape;
+			}
+			return bits;
+		}
+	};
+
+	typedef void (*classify_function)(const char *block, block_masks &masks);
+
+	inline void classify_scalar(const char *block, block_masks &masks) {
+		masks.space = masks.newline = masks.close = masks.quote = masks.escape = 0;
+		for(size_t ii = 0; ii < BLOCK_SIZE; ii++) {
+			uint64_t bit = uint64_t(1) << ii;
+			switch(block[ii]) {
+				case ' ':
+				case '\t':
+				case '\r':
+					masks.space |= bit;
+					break;
+				case '\n':
+					masks.newline |= bit;
+					break;
+				case '>':
+					masks.close |= bit;
+					break;
+				case '"':
+					masks.quote |= bit;
+					break;
+				case '\\':
+					masks.escape |= bit;
+					break;
+			}
+		}
+	}
+
+#ifdef NTRIPLES_X86
+	inline void classify_sse2(const char *block, block_masks &masks) {
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i tab = _mm_set1_epi8('\t');
+		const __m128i carriage = _mm_set1_epi8('\r');
+		const __m128i newline = _mm_set1_epi8('\n');
+		const __m128i close = _mm_set1_epi8('>');
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i escape = _mm_set1_epi8('\\');
+
+		masks.space = masks.newline = masks.close = masks.quote = masks.escape = 0;
+		for(size_t ii = 0; ii < BLOCK_SIZE; ii += 16) {
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + ii));
+
+			__m128i blank = _mm_or_si128(_mm_cmpeq_epi8(bytes, space), _mm_or_si128(_mm_cmpeq_epi8(bytes, tab), _mm_cmpeq_epi8(bytes, carriage)));
+			masks.space |= uint64_t((uint16_t)_mm_movemask_epi8(blank)) << ii;
+			masks.newline |= uint64_t((uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline))) << ii;
+			masks.close |= uint64_t((uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, close))) << ii;
+			masks.quote |= uint64_t((uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote))) << ii;
+			masks.escape |= uint64_t((uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, escape))) << ii;
+		}
+	}
+
+	__attribute__((target("avx2")))
+	inline void classify_avx2(const char *block, block_masks &masks) {
+		const __m256i space = _mm256_set1_epi8(' ');
+		const __m256i tab = _mm256_set1_epi8('\t');
+		const __m256i carriage = _mm256_set1_epi8('\r');
+		const __m256i newline = _mm256_set1_epi8('\n');
+		const __m256i close = _mm256_set1_epi8('>');
+		const __m256i quote = _mm256_set1_epi8('"');
+		const __m256i escape = _mm256_set1_epi8('\\');
+
+		__m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+		__m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32));
+
+		__m256i low_blank = _mm256_or_si256(_mm256_cmpeq_epi8(low, space), _mm256_or_si256(_mm256_cmpeq_epi8(low, tab), _mm256_cmpeq_epi8(low, carriage)));
+		__m256i high_blank = _mm256_or_si256(_mm256_cmpeq_epi8(high, space), _mm256_or_si256(_mm256_cmpeq_epi8(high, tab), _mm256_cmpeq_epi8(high, carriage)));
+
+		masks.space = uint64_t((uint32_t)_mm256_movemask_epi8(low_blank)) | (uint64_t((uint32_t)_mm256_movemask_epi8(high_blank)) << 32);
+		masks.newline = uint64_t((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, newline))) | (uint64_t((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, newline))) << 32);
+		masks.close = uint64_t((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, close))) | (uint64_t((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, close))) << 32);
+		masks.quote = uint64_t((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, quote))) | (uint64_t((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, quote))) << 32);
+		masks.escape = uint64_t((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, escape))) | (uint64_t((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, escape))) << 32);
+	}
+#endif
+
+	/* AUTOMATIC picks the widest kernel the processor supports */
+	inline kernel resolve(kernel requested) {
+#ifdef NTRIPLES_X86
+		if(requested == AUTOMATIC) {
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") ? AVX2 : SSE2;
+		}
+		if(requested == AVX2) {
+			__builtin_cpu_init();
+			if(!__builtin_cpu_supports("avx2")) {
+				throw std::runtime_error("AVX2 tokenizer requested on a processor without AVX2");
+			}
+		}
+		return requested;
+#else
+		if(requested == SSE2 || requested == AVX2) {
+			throw std::runtime_error("SIMD tokenizer requested on a non-x86 build");
+		}
+		return SCALAR;
+#endif
+	}
+
+	inline classify_function classifier(kernel selected) {
+#ifdef NTRIPLES_X86
+		if(selected == AVX2) {
+			return classify_avx2;
+		}
+		else if(selected == SSE2) {
+			return classify_sse2;
+		}
+#endif
+		return classify_scalar;
+	}
+
+	inline const char * kernel_name(kernel selected) {
+		static const char *names[] = { "automatic", "scalar", "sse2", "avx2" };
+		return names[selected];
+	}
+
+	/* points into the reader's buffer; valid until the next call to next() */
+	struct term {
+		const char *data;
+		size_t length;
+
+		std::string str() const {
+			return std::string(data, length);
+		}
+	};
+
+	struct triple {
+		term subject;
+		term predicate;
+		term object;
+	};
+
+	class reader {
+		public:
+			typedef size_t size_type;
+
+			explicit reader(const std::string &filename, kernel requested=AUTOMATIC, size_type chunk_size=1 << 20) : filename(filename), file(filename.c_str(), std::ios_base::in | std::ios_base::binary), selected(resolve(requested)), classify(classifier(selected)), begin(0), filled(0), consumed(0), total(0), line_num(0), eof(false) {
+				if(!file) {
+					std::ostringstream oss;
+					oss << filename << ": " << strerror(errno);
+
+					throw std::runtime_error(oss.str());
+				}
+
+				file.seekg(0, std::ios_base::end);
+				total = (size_type)file.tellg();
+				file.seekg(0, std::ios_base::beg);
+
+				chunk_size = std::max(chunk_size, BLOCK_SIZE);
+				buffer.resize(chunk_size + BLOCK_SIZE);
+			}
+
+			/*
+			 * Capacity
+			 */
+
+			/* bytes of the file consumed so far */
+			size_type position() const {
+				return consumed;
+			}
+
+			/* size of the file in bytes */
+			size_type size() const {
+				return total;
+			}
+
+			/* line number of the last triple returned */
+			size_type line() const {
+				return line_num;
+			}
+
+			kernel active_kernel() const {
+				return selected;
+			}
+
+			/*
+			 * Operations
+			 */
+
+			/* false once the input is exhausted */
+			bool next(triple &result) {
+				size_type end;
+				while(next_line(end)) {
+					size_type position = skip(begin, end, SPACE);
+					if(position == end || buffer[position] == '#') {
+						finish_line(end);
+						continue;
+					}
+
+					if(!read_term(position, end, result.subject, false)) {
+						fail("error reading source vertex");
+					}
+					if(!read_term(position, end, result.predicate, false)) {
+						fail("error reading edge label");
+					}
+					if(!read_term(position, end, result.object, true)) {
+						fail("error reading destination vertex");
+					}
+
+					position = skip(position, end, SPACE);
+					if(position == end || buffer[position] != '.') {
+						fail("error reading reading end of record symbol");
+					}
+					position = skip(position + 1, end, SPACE);
+					if(position != end && buffer[position] != '#') {
+						fail("error reading reading end of record symbol");
+					}
+
+					finish_line(end);
+					return true;
+				}
+				return false;
+			}
+
+		protected:
+			std::string filename;
+			std::ifstream file;
+
+			kernel selected;
+			classify_function classify;
+
+			/* buffer[begin,filled) is unconsumed input; masks cover buffer from 0 */
+			std::vector<char> buffer;
+			std::vector<block_masks> masks;
+			size_type begin;
+			size_type filled;
+
+			size_type consumed;
+			size_type total;
+			size_type line_num;
+			bool eof;
+
+			void fail(const char *message) const {
+				std::ostringstream oss;
+				oss << filename << ":" << line_num << ": " << message;
+
+				throw std::runtime_error(oss.str());
+			}
+
+			/* first position in [position,end) of any of the classes, or end */
+			size_type find(size_type position, size_type end, unsigned int classes) const {
+				if(position >= end) {
+					return end;
+				}
+
+				size_type block = position / BLOCK_SIZE;
+				uint64_t bits = masks[block].select(classes) & (~uint64_t(0) << (position % BLOCK_SIZE));
+				while(bits == 0) {
+					block++;
+					if(block * BLOCK_SIZE >= end) {
+						return end;
+					}
+					bits = masks[block].select(classes);
+				}
+
+				return std::min(block * BLOCK_SIZE + __builtin_ctzll(bits), end);
+			}
+
+			/* first position in [position,end) outside all of the classes, or end */
+			size_type skip(size_type position, size_type end, unsigned int classes) const {
+				if(position >= end) {
+					return end;
+				}
+
+				size_type block = position / BLOCK_SIZE;
+				uint64_t bits = ~masks[block].select(classes) & (~uint64_t(0) << (position % BLOCK_SIZE));
+				while(bits == 0) {
+					block++;
+					if(block * BLOCK_SIZE >= end) {
+						return end;
+					}
+					bits = ~masks[block].select(classes);
+				}
+
+				return std::min(block * BLOCK_SIZE + __builtin_ctzll(bits), end);
+			}
+
+			/*
+			 * Reads the term starting at the first non-blank byte after
+			 * position and leaves position just past it. An object written
+			 * as a blank node directly followed by the end of record '.'
+			 * gives the '.' back.
+			 */
+			bool read_term(size_type &position, size_type end, term &result, bool object) const {
+				size_type start = skip(position, end, SPACE);
+				if(start == end) {
+					return false;
+				}
+
+				size_type stop;
+				if(buffer[start] == '<') {
+					stop = find(start + 1, end, CLOSE);
+					if(stop == end) {
+						return false;
+					}
+					stop++;
+				}
+				else if(buffer[start] == '"') {
+					stop = start + 1;
+					while(true) {
+						stop = find(stop, end, QUOTE | ESCAPE);
+						if(stop == end) {
+							return false;
+						}
+						else if(buffer[stop] == '"') {
+							break;
+						}
+						stop += 2;
+					}
+					stop++;
+
+					if(stop < end && buffer[stop] == '@') {
+						stop++;
+						while(stop < end && (isalnum((unsigned char)buffer[stop]) || buffer[stop] == '-')) {
+							stop++;
+						}
+					}
+					else if(stop + 1 < end && buffer[stop] == '^' && buffer[stop+1] == '^') {
+						if(stop + 2 == end || buffer[stop+2] != '<') {
+							return false;
+						}
+						stop = find(stop + 3, end, CLOSE);
+						if(stop == end) {
+							return false;
+						}
+						stop++;
+					}
+				}
+				else {
+					stop = find(start, end, SPACE);
+					if(object && stop - start > 1 && buffer[stop-1] == '.') {
+						stop--;
+					}
+				}
+
+				result.data = &buffer[start];
+				result.length = stop - start;
+				position = stop;
+
+				return true;
+			}
+
+			/* locates the end of the next line, reading more input as needed */
+			bool next_line(size_type &end) {
+				while(true) {
+					end = find(begin, filled, NEWLINE);
+					if(end < filled || (eof && begin < filled)) {
+						line_num++;
+						return true;
+					}
+					else if(eof) {
+						return false;
+					}
+					refill();
+				}
+			}
+
+			void finish_line(size_type end) {
+				size_type next = std::min(end + 1, filled);
+				consumed += next - begin;
+				begin = next;
+			}
+
+			/* keeps the unconsumed tail, reads after it and reclassifies */
+			void refill() {
+				size_type remaining = filled - begin;
+				if(begin > 0) {
+					std::memmove(&buffer[0], &buffer[begin], remaining);
+				}
+				else if(remaining + BLOCK_SIZE >= buffer.size()) {
+					buffer.resize(2 * buffer.size());
+				}
+				begin = 0;
+				filled = remaining;
+
+				size_type capacity = buffer.size() - BLOCK_SIZE;
+				while(filled < capacity && !eof) {
+					file.read(&buffer[filled], capacity - filled);
+					filled += (size_type)file.gcount();
+					if(file.bad()) {
+						std::ostringstream oss;
+						oss << filename << ": " << strerror(errno);
+
+						throw std::runtime_error(oss.str());
+					}
+					else if(file.eof()) {
+						eof = true;
+					}
+				}
+
+				/* zeros belong to no class, so the partial last block needs no special case */
+				size_type num_blocks = (filled + BLOCK_SIZE - 1) / BLOCK_SIZE;
+				std::fill(buffer.begin() + filled, buffer.begin() + num_blocks * BLOCK_SIZE, '\0');
+
+				masks.resize(num_blocks);
+				for(size_type ii = 0; ii < num_blocks; ii++) {
+					classify(&buffer[ii * BLOCK_SIZE], masks[ii]);
+				}
+			}
+	};
+}
+
+#endif
@@ -62,7 +62,7 @@ namespace outputter_any_detail
 					any_holder& operator=(const any_holder&);
 			};
 
-			std::auto_ptr<any_holder_base> mPtr;
+			std::unique_ptr<any_holder_base> mPtr;
 			any& operator=(const any&);
 	};
 
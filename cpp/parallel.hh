@@ -0,0 +1,610 @@
+#ifndef _PARALLEL_HH_
+#define _PARALLEL_HH_
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+
+#include <sstream>
+
+#include <algorithm>
+
+#include <stdexcept>
+#include <exception>
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*
+ * Work-stealing task runtime shared by the graph algorithms.
+ *
+ * A fixed pool of threads is started on first use; the thread that calls
+ * into the runtime takes part as slot 0 while its work is running. Each
+ * slot owns a deque of range tasks. A slot about to run a range splits it
+ * in half until it is no larger than the grain, pushing the right halves
+ * onto the back of its own deque, and then runs what is left; idle slots
+ * steal from the front of a random victim's deque, so they take the
+ * largest pieces first. A slot that waits for a nested call keeps
+ * running tasks until that call is done.
+ *
+ * weighted_for splits at the midpoint of a cumulative cost instead of the
+ * midpoint of the range. for_each_vertex uses the prefix sums of the
+ * degrees, so a power-law hub becomes a task of its own rather than the
+ * tail of an unlucky chunk.
+ *
+ * parallel_reduce and parallel_scan work on chunks fixed by the grain
+ * and combine them in order, so their results do not depend on the
+ * number of threads or on which thread ran what.
+ *
+ * The number of threads defaults to PARALLEL_THREADS from the
+ * environment, or else the number of hardware threads; configure()
+ * changes it and can pin every slot to its own processor. Calls from
+ * threads outside the pool are served one at a time.
+ */
+namespace parallel {
+	typedef size_t size_type;
+
+	namespace detail {
+		/* slot of the calling thread, or -1 outside the runtime */
+		inline int & current_slot() {
+			static thread_local int slot = -1;
+			return slot;
+		}
+
+		/* one parallel loop; remaining counts the iterations not yet run */
+		struct job {
+			std::function<void(size_type, size_type)> body;
+			std::function<size_type(size_type)> cost;
+			size_type grain;
+
+			std::atomic<size_type> remaining;
+			std::atomic<bool> failed;
+			std::mutex error_mutex;
+			std::exception_ptr error;
+
+			job(size_type grain, size_type iterations) : grain(grain), remaining(iterations), failed(false) {
+
+			}
+
+			bool splittable(size_type begin, size_type end) const {
+				if(end - begin < 2) {
+					return false;
+				}
+				if(cost) {
+					return cost(end) - cost(begin) > grain;
+				}
+				return end - begin > grain;
+			}
+
+			/* first position whose cost reaches half of the range's */
+			size_type split(size_type begin, size_type end) const {
+				if(!cost) {
+					return begin + (end - begin) / 2;
+				}
+
+				size_type low_cost = cost(begin);
+				size_type target = low_cost + (cost(end) - low_cost) / 2;
+				size_type low = begin + 1;
+				size_type high = end - 1;
+				while(low < high) {
+					size_type mid = low + (high - low) / 2;
+					if(cost(mid) < target) {
+						low = mid + 1;
+					}
+					else {
+						high = mid;
+					}
+				}
+				return low;
+			}
+
+			void fail(std::exception_ptr exception) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if(!error) {
+					error = exception;
+				}
+				failed = true;
+			}
+		};
+
+		struct task {
+			job *owner;
+			size_type begin;
+			size_type end;
+		};
+
+		/* padded so that neighboring slots do not share a cache line */
+		struct task_queue {
+			std::mutex mutex;
+			std::deque<task> tasks;
+			char padding[64];
+
+			void push(const task &value) {
+				std::lock_guard<std::mutex> lock(mutex);
+				tasks.push_back(value);
+			}
+
+			bool pop(task &value) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if(tasks.empty()) {
+					return false;
+				}
+				value = tasks.back();
+				tasks.pop_back();
+				return true;
+			}
+
+			bool steal(task &value) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if(tasks.empty()) {
+					return false;
+				}
+				value = tasks.front();
+				tasks.pop_front();
+				return true;
+			}
+		};
+
+		class pool {
+			public:
+				static pool & instance() {
+					static pool shared;
+					return shared;
+				}
+
+				~pool() {
+					stop();
+				}
+
+				/*
+				 * Capacity
+				 */
+				size_type size() const {
+					return queues.size();
+				}
+
+				/*
+				 * Modifiers
+				 */
+				void configure(size_type threads, bool pin) {
+					if(current_slot() >= 0) {
+						std::ostringstream oss;
+						oss << "cannot reconfigure the thread pool from inside a parallel loop";
+
+						throw std::logic_error(oss.str());
+					}
+
+					std::lock_guard<std::mutex> lock(caller_mutex);
+					stop();
+					start(threads == 0 ? default_threads() : threads, pin);
+				}
+
+				/*
+				 * Operations
+				 */
+
+				/* runs the whole job, with the calling thread taking part */
+				void run(job &work, size_type begin, size_type end) {
+					if(size() == 1) {
+						work.body(begin, end);
+						return;
+					}
+
+					std::unique_lock<std::mutex> external;
+					int slot = current_slot();
+					if(slot < 0) {
+						external = std::unique_lock<std::mutex>(caller_mutex);
+						slot = 0;
+						current_slot() = 0;
+					}
+
+					bool shared = work.splittable(begin, end);
+					if(shared) {
+						std::lock_guard<std::mutex> lock(sleep_mutex);
+						active++;
+						wake.notify_all();
+					}
+
+					task first = {&work, begin, end};
+					execute(first, (size_type)slot);
+					while(work.remaining.load(std::memory_order_acquire) != 0) {
+						task next;
+						if(take((size_type)slot, next)) {
+							execute(next, (size_type)slot);
+						}
+						else {
+							std::this_thread::yield();
+						}
+					}
+
+					if(shared) {
+						std::lock_guard<std::mutex> lock(sleep_mutex);
+						active--;
+					}
+					if(external.owns_lock()) {
+						current_slot() = -1;
+					}
+
+					if(work.error) {
+						std::rethrow_exception(work.error);
+					}
+				}
+
+			protected:
+				std::vector<std::unique_ptr<task_queue> > queues;
+				std::vector<std::thread> workers;
+
+				/* held by the outside thread currently using slot 0 */
+				std::mutex caller_mutex;
+
+				std::mutex sleep_mutex;
+				std::condition_variable wake;
+				size_type active;
+				bool stopping;
+
+				pool() : active(0), stopping(false) {
+					start(default_threads(), false);
+				}
+
+				pool(const pool &other) = delete;
+				pool & operator=(const pool &other) = delete;
+
+				static size_type default_threads() {
+					const char *setting = std::getenv("PARALLEL_THREADS");
+					if(setting != NULL && std::atoi(setting) > 0) {
+						return (size_type)std::atoi(setting);
+					}
+					return std::max(std::thread::hardware_concurrency(), 1u);
+				}
+
+				void start(size_type threads, bool pin) {
+					stopping = false;
+					queues.clear();
+					for(size_type ii = 0; ii < threads; ii++) {
+						queues.push_back(std::unique_ptr<task_queue>(new task_queue()));
+					}
+
+					std::vector<int> processors;
+					if(pin) {
+						processors = allowed_processors();
+#ifdef __linux__
+						if(!processors.empty()) {
+							pin_thread(pthread_self(), processors[0]);
+						}
+#endif
+					}
+
+					for(size_type ii = 1; ii < threads; ii++) {
+						workers.push_back(std::thread(&pool::work, this, ii));
+						if(!processors.empty()) {
+							pin_thread(workers.back().native_handle(), processors[ii % processors.size()]);
+						}
+					}
+				}
+
+				void stop() {
+					{
+						std::lock_guard<std::mutex> lock(sleep_mutex);
+						stopping = true;
+						wake.notify_all();
+					}
+					for(size_type ii = 0; ii < workers.size(); ii++) {
+						workers[ii].join();
+					}
+					workers.clear();
+				}
+
+				static std::vector<int> allowed_processors() {
+					std::vector<int> result;
+#ifdef __linux__
+					cpu_set_t mask;
+					CPU_ZERO(&mask);
+					if(sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+						for(int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+							if(CPU_ISSET(cpu, &mask)) {
+								result.push_back(cpu);
+							}
+						}
+					}
+#endif
+					return result;
+				}
+
+				static void pin_thread(std::thread::native_handle_type handle, int processor) {
+#ifdef __linux__
+					cpu_set_t mask;
+					CPU_ZERO(&mask);
+					CPU_SET(processor, &mask);
+					pthread_setaffinity_np(handle, sizeof(mask), &mask);
+#else
+					(void)handle;
+					(void)processor;
+#endif
+				}
+
+				/* own deque first, then the others starting from a random one */
+				bool take(size_type slot, task &value) {
+					if(queues[slot]->pop(value)) {
+						return true;
+					}
+
+					static thread_local uint64_t state = 0x9e3779b97f4a7c15ULL ^ (uint64_t)(slot + 1);
+					state ^= state << 13;
+					state ^= state >> 7;
+					state ^= state << 17;
+
+					size_type num_queues = queues.size();
+					size_type first = (size_type)(state % num_queues);
+					for(size_type ii = 0; ii < num_queues; ii++) {
+						size_type victim = (first + ii) % num_queues;
+						if(victim != slot && queues[victim]->steal(value)) {
+							return true;
+						}
+					}
+					return false;
+				}
+
+				void execute(task current, size_type slot) {
+					job &work = *current.owner;
+					while(work.splittable(current.begin, current.end)) {
+						size_type mid = work.split(current.begin, current.end);
+						task right = {current.owner, mid, current.end};
+						queues[slot]->push(right);
+						current.end = mid;
+					}
+
+					if(!work.failed.load(std::memory_order_relaxed)) {
+						try {
+							work.body(current.begin, current.end);
+						}
+						catch(...) {
+							work.fail(std::current_exception());
+						}
+					}
+
+					/* the last touch of the job, which may be gone right after */
+					work.remaining.fetch_sub(current.end - current.begin, std::memory_order_release);
+				}
+
+				void work(size_type slot) {
+					current_slot() = (int)slot;
+					for(;;) {
+						task next;
+						if(take(slot, next)) {
+							execute(next, slot);
+							continue;
+						}
+
+						std::unique_lock<std::mutex> lock(sleep_mutex);
+						if(stopping) {
+							return;
+						}
+						if(active == 0) {
+							wake.wait(lock);
+						}
+						else {
+							lock.unlock();
+							std::this_thread::yield();
+						}
+					}
+				}
+		};
+
+		template <typename Body>
+		void run(size_type begin, size_type end, size_type grain, std::function<size_type(size_type)> cost, Body &body) {
+			if(end <= begin) {
+				return;
+			}
+
+			job work(std::max(grain, (size_type)1), end - begin);
+			work.cost = cost;
+			work.body = [&body](size_type first, size_type last) {
+				for(size_type ii = first; ii < last; ii++) {
+					body(ii);
+				}
+			};
+			pool::instance().run(work, begin, end);
+		}
+
+		/* cumulative degree plus one per vertex, so isolated vertices still count */
+		template <typename G>
+		struct degree_prefix {
+			const G &graph;
+
+			degree_prefix(const G &graph) : graph(graph) {
+
+			}
+
+			size_type operator()(size_type vertex) const {
+				return (size_type)(graph.begin_neighbors(vertex) - graph.begin_neighbors(0)) + vertex;
+			}
+		};
+	}
+
+	/*
+	 * Capacity
+	 */
+	inline size_type num_threads() {
+		return detail::pool::instance().size();
+	}
+
+	/* slot of the calling thread, 0..num_threads()-1 */
+	inline size_type thread_index() {
+		int slot = detail::current_slot();
+		return slot < 0 ? 0 : (size_type)slot;
+	}
+
+	/*
+	 * Sets the number of threads (0 for the default) and whether each
+	 * is pinned to its own processor, the calling thread included.
+	 * Must not be called while parallel work or per_thread values exist.
+	 */
+	inline void configure(size_type threads, bool pin=false) {
+		detail::pool::instance().configure(threads, pin);
+	}
+
+	/*
+	 * Operations
+	 */
+
+	/* body(ii) for ii in [begin, end), in pieces of about grain iterations */
+	template <typename Body>
+	void parallel_for(size_type begin, size_type end, size_type grain, Body body) {
+		detail::run(begin, end, grain, std::function<size_type(size_type)>(), body);
+	}
+
+	/*
+	 * body(ii) for ii in [begin, end), in pieces of about grain cost,
+	 * where cost(ii) is the cumulative cost of the iterations before ii
+	 * and does not decrease.
+	 */
+	template <typename Cost, typename Body>
+	void weighted_for(size_type begin, size_type end, size_type grain, Cost cost, Body body) {
+		detail::run(begin, end, grain, std::function<size_type(size_type)>(cost), body);
+	}
+
+	/* body(vertex) for every vertex, in pieces of about grain incident edges */
+	template <typename G, typename Body>
+	void for_each_vertex(const G &graph, size_type grain, Body body) {
+		weighted_for(0, graph.size_vertices(), grain, detail::degree_prefix<G>(graph), body);
+	}
+
+	/*
+	 * Folds map(ii) over [begin, end) with combine, which must be
+	 * associative. Chunks of grain iterations are folded separately and
+	 * then in order.
+	 */
+	template <typename T, typename Map, typename Combine>
+	T parallel_reduce(size_type begin, size_type end, size_type grain, T identity, Map map, Combine combine) {
+		if(end <= begin) {
+			return identity;
+		}
+
+		grain = std::max(grain, (size_type)1);
+		size_type num_chunks = (end - begin + grain - 1) / grain;
+		std::vector<T> partial(num_chunks, identity);
+
+		parallel_for(0, num_chunks, 1, [&](size_type chunk) {
+			size_type first = begin + chunk * grain;
+			size_type last = std::min(first + grain, end);
+			T value = identity;
+			for(size_type ii = first; ii < last; ii++) {
+				value = combine(value, map(ii));
+			}
+			partial[chunk] = value;
+		});
+
+		T result = identity;
+		for(size_type chunk = 0; chunk < num_chunks; chunk++) {
+			result = combine(result, partial[chunk]);
+		}
+		return result;
+	}
+
+	/*
+	 * Exclusive scan: output[ii] is init combined with input[0..ii-1].
+	 * Returns the combination of init and every input. input and output
+	 * may be the same array.
+	 */
+	template <typename T, typename Combine>
+	T parallel_scan(const T *input, T *output, size_type length, size_type grain, T init, Combine combine) {
+		if(length == 0) {
+			return init;
+		}
+
+		grain = std::max(grain, (size_type)1);
+		size_type num_chunks = (length + grain - 1) / grain;
+		std::vector<T> partial(num_chunks);
+
+		parallel_for(0, num_chunks, 1, [&](size_type chunk) {
+			size_type first = chunk * grain;
+			size_type last = std::min(first + grain, length);
+			T value = input[first];
+			for(size_type ii = first + 1; ii < last; ii++) {
+				value = combine(value, input[ii]);
+			}
+			partial[chunk] = value;
+		});
+
+		/* partial[chunk] becomes the carry into the chunk */
+		T carry = init;
+		for(size_type chunk = 0; chunk < num_chunks; chunk++) {
+			T next = combine(carry, partial[chunk]);
+			partial[chunk] = carry;
+			carry = next;
+		}
+
+		parallel_for(0, num_chunks, 1, [&](size_type chunk) {
+			size_type first = chunk * grain;
+			size_type last = std::min(first + grain, length);
+			T value = partial[chunk];
+			for(size_type ii = first; ii < last; ii++) {
+				T next = combine(value, input[ii]);
+				output[ii] = value;
+				value = next;
+			}
+		});
+
+		return carry;
+	}
+
+	/*
+	 * One copy of a value per thread, for scratch space and partial
+	 * results. A loop body must not hold on to local() across a nested
+	 * parallel call, since the thread may run another iteration of the
+	 * same loop while it waits.
+	 */
+	template <typename T>
+	class per_thread {
+		public:
+			typedef typename std::vector<T>::iterator iterator;
+			typedef typename std::vector<T>::const_iterator const_iterator;
+
+			explicit per_thread(const T &value=T()) : values(num_threads(), value) {
+
+			}
+
+			/*
+			 * Iterators
+			 */
+			iterator begin() {
+				return values.begin();
+			}
+
+			iterator end() {
+				return values.end();
+			}
+
+			const_iterator begin() const {
+				return values.begin();
+			}
+
+			const_iterator end() const {
+				return values.end();
+			}
+
+			/*
+			 * Element Access
+			 */
+			T & local() {
+				return values[thread_index()];
+			}
+
+		protected:
+			std::vector<T> values;
+	};
+}
+
+#endif
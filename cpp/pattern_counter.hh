@@ -0,0 +1,421 @@
+#ifndef _PATTERN_COUNTER_HH_
+#define _PATTERN_COUNTER_HH_
+
+#include <vector>
+#include <utility>
+
+#include <sstream>
+
+#include <algorithm>
+
+#include <stdexcept>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "labeled_graph.hh"
+#include "radix_sort.hh"
+#include "parallel.hh"
+
+/*
+ * Counts of the labeled patterns of one and two edges in a labeled_graph:
+ * edge patterns (vertex label, edge label, vertex label) and wedges, two
+ * edges sharing a center vertex.
+ *
+ * Labels are interned into dense ids once, at construction. An edge
+ * seen from one end is an arm, (edge label, label of the other end),
+ * and distinct arms get ids of their own, so an edge pattern packs
+ * into one 64-bit key (smaller end label, arm of the larger end) and a
+ * wedge into the center label and two arm ids. Edge patterns are
+ * counted by radix-sorting their keys. Wedges are counted per center
+ * from the center's arm multiset: arms of types a and b make
+ * count(a) * count(b) wedges, or count(a) choose 2 when a = b, so the
+ * work per center is the square of its distinct arm types, not of its
+ * degree. The per-center counts are buffered per thread and summed by
+ * radix-sorting them, as the buffers fill and once more at the end.
+ *
+ * The graph is undirected, so the ends of an edge pattern and the arms
+ * of a wedge are unordered: the smaller label or arm id comes first.
+ * Self-loops count as edge patterns but not as arms of a wedge.
+ */
+template <typename V, typename L>
+class pattern_counter {
+	public:
+		typedef size_t size_type;
+		typedef uint32_t id_type;
+
+		typedef typename labeled_graph<V,L>::label label;
+
+		struct edge_pattern {
+			label first;
+			label edge;
+			label second;
+			uint64_t count;
+		};
+
+		struct wedge_pattern {
+			label center;
+			label first_edge;
+			label first;
+			label second_edge;
+			label second;
+			uint64_t count;
+		};
+
+		explicit pattern_counter(const labeled_graph<V,L> &graph) {
+			intern(graph);
+		}
+
+		/*
+		 * Capacity
+		 */
+		size_type size_vertices() const {
+			return vertex_label.size();
+		}
+
+		size_type size_vertex_labels() const {
+			return vertex_labels.size();
+		}
+
+		size_type size_edge_labels() const {
+			return edge_labels.size();
+		}
+
+		/* distinct (edge label, vertex label) arms */
+		size_type size_arms() const {
+			return arms.size();
+		}
+
+		/*
+		 * Operations
+		 */
+
+		/* the top_k (0 for all) edge patterns seen at least min_count times, most frequent first */
+		std::vector<edge_pattern> edge_patterns(uint64_t min_count=1, size_type top_k=0) const {
+			std::vector<uint64_t> keys(edge_keys);
+			std::vector<uint64_t> scratch;
+			radix_sort::sort(keys, scratch, 32 + bits(vertex_labels.size()));
+
+			std::vector<std::pair<uint64_t,uint64_t> > counts;
+			for(size_type ii = 0; ii < keys.size(); ) {
+				size_type run = ii + 1;
+				while(run < keys.size() && keys[run] == keys[ii]) {
+					run++;
+				}
+				if(run - ii >= min_count) {
+					counts.push_back(std::pair<uint64_t,uint64_t>(keys[ii], run - ii));
+				}
+				ii = run;
+			}
+			rank(counts, top_k);
+
+			std::vector<edge_pattern> result(counts.size());
+			for(size_type ii = 0; ii < counts.size(); ii++) {
+				uint64_t arm = arms[counts[ii].first & 0xffffffff];
+				result[ii].first = vertex_labels[counts[ii].first >> 32];
+				result[ii].edge = edge_labels[arm >> 32];
+				result[ii].second = vertex_labels[arm & 0xffffffff];
+				result[ii].count = counts[ii].second;
+			}
+			return result;
+		}
+
+		/* the top_k (0 for all) wedge patterns seen at least min_count times, most frequent first */
+		std::vector<wedge_pattern> wedge_patterns(uint64_t min_count=1, size_type top_k=0) const {
+			parallel::per_thread<wedge_buffer> partial;
+			parallel::weighted_for(0, size_vertices(), 1 << 14, [&](size_type ii) {
+				return offsets[ii] + ii;
+			}, [&](size_type center) {
+				std::vector<wedge_count> &buffer = partial.local().records;
+				wedge_count record;
+				record.key.center = vertex_label[center];
+
+				/* the arm list is sorted, so each type is one run */
+				size_type first = offsets[center];
+				size_type last = offsets[center+1];
+				for(size_type ii = first; ii < last; ) {
+					size_type ii_end = ii;
+					while(ii_end < last && center_arms[ii_end] == center_arms[ii]) {
+						ii_end++;
+					}
+					uint64_t ii_count = ii_end - ii;
+
+					record.key.first = record.key.second = center_arms[ii];
+					if(ii_count > 1) {
+						record.count = ii_count * (ii_count - 1) / 2;
+						buffer.push_back(record);
+					}
+					for(size_type jj = ii_end; jj < last; ) {
+						size_type jj_end = jj;
+						while(jj_end < last && center_arms[jj_end] == center_arms[jj]) {
+							jj_end++;
+						}
+						record.key.second = center_arms[jj];
+						record.count = ii_count * (jj_end - jj);
+						buffer.push_back(record);
+						jj = jj_end;
+					}
+					ii = ii_end;
+				}
+
+				/* compact() is parallel, so the buffer is taken out of local() meanwhile */
+				if(buffer.size() >= partial.local().limit) {
+					std::vector<wedge_count> full;
+					full.swap(buffer);
+					compact(full);
+
+					wedge_buffer &after = partial.local();
+					after.records.insert(after.records.end(), full.begin(), full.end());
+					after.limit = std::max(after.limit, 4 * full.size());
+				}
+			});
+
+			std::vector<wedge_count> merged;
+			typename parallel::per_thread<wedge_buffer>::iterator buffer_iter = partial.begin();
+			merged.swap(buffer_iter->records);
+			for(++buffer_iter; buffer_iter != partial.end(); ++buffer_iter) {
+				merged.insert(merged.end(), buffer_iter->records.begin(), buffer_iter->records.end());
+				std::vector<wedge_count>().swap(buffer_iter->records);
+			}
+			compact(merged);
+
+			std::vector<std::pair<wedge_key,uint64_t> > counts;
+			for(size_type ii = 0; ii < merged.size(); ii++) {
+				if(merged[ii].count >= min_count) {
+					counts.push_back(std::pair<wedge_key,uint64_t>(merged[ii].key, merged[ii].count));
+				}
+			}
+			rank(counts, top_k);
+
+			std::vector<wedge_pattern> result(counts.size());
+			for(size_type ii = 0; ii < counts.size(); ii++) {
+				uint64_t first = arms[counts[ii].first.first];
+				uint64_t second = arms[counts[ii].first.second];
+				result[ii].center = vertex_labels[counts[ii].first.center];
+				result[ii].first_edge = edge_labels[first >> 32];
+				result[ii].first = vertex_labels[first & 0xffffffff];
+				result[ii].second_edge = edge_labels[second >> 32];
+				result[ii].second = vertex_labels[second & 0xffffffff];
+				result[ii].count = counts[ii].second;
+			}
+			return result;
+		}
+
+	protected:
+		struct wedge_key {
+			id_type center;
+			id_type first;
+			id_type second;
+
+			bool operator==(const wedge_key &other) const {
+				return center == other.center && first == other.first && second == other.second;
+			}
+
+			bool operator<(const wedge_key &other) const {
+				if(center != other.center) {
+					return center < other.center;
+				}
+				if(first != other.first) {
+					return first < other.first;
+				}
+				return second < other.second;
+			}
+		};
+
+		struct wedge_count {
+			wedge_key key;
+			uint64_t count;
+		};
+
+		/*
+		 * Wedge counts of one thread, compacted whenever they reach the
+		 * limit. The limit grows to four times what a compaction keeps, so
+		 * records with few duplicates are not sorted over and over.
+		 */
+		struct wedge_buffer {
+			std::vector<wedge_count> records;
+			size_type limit;
+
+			wedge_buffer() : limit(1 << 16) {
+			}
+		};
+
+		/* id -> label */
+		std::vector<label> vertex_labels;
+		std::vector<label> edge_labels;
+
+		/* label id of each vertex, in the graph's vertex order */
+		std::vector<id_type> vertex_label;
+
+		/* arm id -> edge label id << 32 | vertex label id, sorted */
+		std::vector<uint64_t> arms;
+
+		/* center_arms[offsets[vertex]..offsets[vertex+1]) are the vertex's arm ids, sorted */
+		std::vector<size_type> offsets;
+		std::vector<id_type> center_arms;
+
+		/* one key per edge: smaller end label id << 32 | arm id of the edge seen from it */
+		std::vector<uint64_t> edge_keys;
+
+		static unsigned int bits(uint64_t values) {
+			unsigned int result = 0;
+			while(result < 64 && (uint64_t(1) << result) < values) {
+				result++;
+			}
+			return result;
+		}
+
+		/* sorts by count, most frequent first, ties by key, and keeps top_k */
+		template <typename K>
+		static void rank(std::vector<std::pair<K,uint64_t> > &counts, size_type top_k) {
+			struct by_count {
+				bool operator()(const std::pair<K,uint64_t> &a, const std::pair<K,uint64_t> &b) const {
+					if(a.second != b.second) {
+						return a.second > b.second;
+					}
+					return a.first < b.first;
+				}
+			};
+
+			if(top_k != 0 && top_k < counts.size()) {
+				std::partial_sort(counts.begin(), counts.begin() + top_k, counts.end(), by_count());
+				counts.resize(top_k);
+			}
+			else {
+				std::sort(counts.begin(), counts.end(), by_count());
+			}
+		}
+
+		/* radix-sorts records by key and sums the counts of equal keys */
+		void compact(std::vector<wedge_count> &records) const {
+			unsigned int arm_bits = bits(arms.size());
+			unsigned int center_bits = bits(vertex_labels.size());
+			std::vector<wedge_count> scratch;
+			if(center_bits + 2 * arm_bits <= 64) {
+				radix_sort::sort(records, scratch, center_bits + 2 * arm_bits, [arm_bits](const wedge_count &record) {
+					return (uint64_t)record.key.center << 2 * arm_bits | (uint64_t)record.key.first << arm_bits | record.key.second;
+				});
+			}
+			else {
+				/* the passes are stable, so the arms sort first and the center last */
+				radix_sort::sort(records, scratch, 2 * arm_bits, [arm_bits](const wedge_count &record) {
+					return (uint64_t)record.key.first << arm_bits | record.key.second;
+				});
+				radix_sort::sort(records, scratch, center_bits, [](const wedge_count &record) {
+					return (uint64_t)record.key.center;
+				});
+			}
+
+			size_type kept = 0;
+			for(size_type ii = 0; ii < records.size(); ii++) {
+				if(kept > 0 && records[kept-1].key == records[ii].key) {
+					records[kept-1].count += records[ii].count;
+				}
+				else {
+					records[kept++] = records[ii];
+				}
+			}
+			records.resize(kept);
+		}
+
+		template <typename T>
+		static id_type id(const std::vector<T> &table, const T &value) {
+			return (id_type)(std::lower_bound(table.begin(), table.end(), value) - table.begin());
+		}
+
+		void intern(const labeled_graph<V,L> &graph) {
+			typedef typename labeled_graph<V,L>::vertex vertex;
+
+			if(graph.size_vertices() > 0xffffffff || graph.size_edges() >= 0x80000000) {
+				std::ostringstream oss;
+				oss << "too many vertices or edges for 32-bit pattern ids";
+
+				throw std::length_error(oss.str());
+			}
+
+			std::vector<vertex> vertices;
+			vertices.reserve(graph.size_vertices());
+			typename labeled_graph<V,L>::const_vertex_iterator vertex_iter = graph.begin_vertices();
+			for(; vertex_iter != graph.end_vertices(); ++vertex_iter) {
+				vertices.push_back(vertex_iter->first);
+				vertex_labels.push_back(vertex_iter->second);
+			}
+			std::sort(vertex_labels.begin(), vertex_labels.end());
+			vertex_labels.erase(std::unique(vertex_labels.begin(), vertex_labels.end()), vertex_labels.end());
+
+			vertex_label.reserve(vertices.size());
+			for(vertex_iter = graph.begin_vertices(); vertex_iter != graph.end_vertices(); ++vertex_iter) {
+				vertex_label.push_back(id(vertex_labels, vertex_iter->second));
+			}
+
+			typename labeled_graph<V,L>::const_edge_iterator edge_iter = graph.begin_edges();
+			for(; edge_iter != graph.end_edges(); ++edge_iter) {
+				edge_labels.push_back(edge_iter->second);
+			}
+			std::sort(edge_labels.begin(), edge_labels.end());
+			edge_labels.erase(std::unique(edge_labels.begin(), edge_labels.end()), edge_labels.end());
+
+			/* every edge gives an arm to each end, src's arm first */
+			std::vector<id_type> ends;
+			ends.reserve(2 * graph.size_edges());
+			for(edge_iter = graph.begin_edges(); edge_iter != graph.end_edges(); ++edge_iter) {
+				id_type src = id(vertices, edge_iter->first.first);
+				id_type dst = id(vertices, edge_iter->first.second);
+				uint64_t edge_label = id(edge_labels, edge_iter->second);
+
+				ends.push_back(src);
+				ends.push_back(dst);
+				arms.push_back(edge_label << 32 | vertex_label[dst]);
+				arms.push_back(edge_label << 32 | vertex_label[src]);
+			}
+
+			std::vector<uint64_t> edge_arms(arms);
+			std::vector<uint64_t> scratch;
+			radix_sort::sort(arms, scratch, 32 + bits(edge_labels.size()));
+			radix_sort::unique(arms, scratch);
+
+			offsets.assign(vertices.size() + 1, 0);
+			edge_keys.resize(edge_arms.size() / 2);
+			for(size_type ii = 0; ii < edge_arms.size(); ii += 2) {
+				id_type src = ends[ii];
+				id_type dst = ends[ii+1];
+				id_type src_arm = id(arms, edge_arms[ii]);
+				id_type dst_arm = id(arms, edge_arms[ii+1]);
+				edge_arms[ii] = src_arm;
+				edge_arms[ii+1] = dst_arm;
+
+				/* the end with the smaller label keeps the arm toward the larger */
+				if(vertex_label[src] <= vertex_label[dst]) {
+					edge_keys[ii/2] = (uint64_t)vertex_label[src] << 32 | src_arm;
+				}
+				else {
+					edge_keys[ii/2] = (uint64_t)vertex_label[dst] << 32 | dst_arm;
+				}
+
+				if(src != dst) {
+					offsets[src+1]++;
+					offsets[dst+1]++;
+				}
+			}
+
+			for(size_type ii = 0; ii < vertices.size(); ii++) {
+				offsets[ii+1] += offsets[ii];
+			}
+			center_arms.resize(offsets.back());
+			std::vector<size_type> fill(offsets.begin(), offsets.end() - 1);
+			for(size_type ii = 0; ii < edge_arms.size(); ii += 2) {
+				if(ends[ii] != ends[ii+1]) {
+					center_arms[fill[ends[ii]]++] = (id_type)edge_arms[ii];
+					center_arms[fill[ends[ii+1]]++] = (id_type)edge_arms[ii+1];
+				}
+			}
+
+			parallel::weighted_for(0, vertices.size(), 1 << 14, [&](size_type vertex) {
+				return offsets[vertex] + vertex;
+			}, [&](size_type vertex) {
+				std::sort(center_arms.begin() + offsets[vertex], center_arms.begin() + offsets[vertex+1]);
+			});
+		}
+};
+
+#endif
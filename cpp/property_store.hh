@@ -0,0 +1,1034 @@
+#ifndef _PROPERTY_STORE_HH_
+#define _PROPERTY_STORE_HH_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <utility>
+
+#include <sstream>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include <stdexcept>
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PROPERTY_STORE_X86 1
+#include <immintrin.h>
+#endif
+
+#include "memory_usage.hh"
+#include "binary_io.hh"
+#include "checkpoint.hh"
+#include "parallel.hh"
+
+/*
+ * Columnar vertex and edge properties keyed by dense ids: a vertex's row
+ * is its compact_graph index, and an edge's row is the position of the
+ * arc in the adjacency arrays, iter - begin_neighbors(0). An undirected
+ * edge therefore has a row for each direction, and a scan in row order
+ * reads the properties in the order a pass over the adjacency visits
+ * them.
+ *
+ * Columns are typed arrays (64-bit integers, doubles, interned strings
+ * and bitsets) with one value per row. Filters produce a selection, a
+ * bitset with one bit per row, 64 rows per word, which combines with
+ * other selections by word-wise and/or and restricts later scans. Range
+ * filters over numeric columns compare four values at a time with AVX2
+ * when the processor has it; filters and scans run on the parallel
+ * runtime in fixed chunks, so sums do not depend on the thread count.
+ *
+ * A store saves to and loads from one binary file kept next to the
+ * graph it describes.
+ */
+
+class bitset_column;
+typedef bitset_column selection;
+
+class property_column {
+	public:
+		typedef size_t size_type;
+
+		enum column_type {
+			INT = 1,
+			FLOAT = 2,
+			STRING = 3,
+			BITSET = 4
+		};
+
+		virtual ~property_column() {
+
+		}
+
+		virtual column_type type() const = 0;
+		virtual size_type size() const = 0;
+		virtual memory_report memory_usage() const = 0;
+
+		/* new rows are zero, empty or unset */
+		virtual void resize(size_type rows) = 0;
+
+		virtual void save(binary_io::writer &output) const = 0;
+		virtual void load(binary_io::reader &input, size_type rows) = 0;
+
+		static const char * type_name(column_type type) {
+			switch(type) {
+				case INT:
+					return "int";
+				case FLOAT:
+					return "float";
+				case STRING:
+					return "string";
+				case BITSET:
+					return "bitset";
+			}
+			return "unknown";
+		}
+};
+
+namespace column_scan {
+	const size_t WORD_BITS = 64;
+
+	/* rows whose value lies in [low, high], as bits of one word */
+	template <typename T>
+	inline uint64_t between_scalar(const T *values, size_t count, T low, T high) {
+		uint64_t bits = 0;
+		for(size_t ii = 0; ii < count; ii++) {
+			bits |= (uint64_t)(values[ii] >= low && values[ii] <= high) << ii;
+		}
+		return bits;
+	}
+
+	template <typename T>
+	inline uint64_t between_block(const T *values, T low, T high) {
+		return between_scalar(values, WORD_BITS, low, high);
+	}
+
+#ifdef PROPERTY_STORE_X86
+	__attribute__((target("avx2")))
+	inline uint64_t between_avx2(const int64_t *values, int64_t low, int64_t high) {
+		__m256i lower = _mm256_set1_epi64x(low);
+		__m256i upper = _mm256_set1_epi64x(high);
+		uint64_t bits = 0;
+		for(size_t ii = 0; ii < WORD_BITS; ii += 4) {
+			__m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + ii));
+			__m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(lower, value), _mm256_cmpgt_epi64(value, upper));
+			bits |= (uint64_t)(~_mm256_movemask_pd(_mm256_castsi256_pd(outside)) & 0xf) << ii;
+		}
+		return bits;
+	}
+
+	__attribute__((target("avx2")))
+	inline uint64_t between_avx2(const double *values, double low, double high) {
+		__m256d lower = _mm256_set1_pd(low);
+		__m256d upper = _mm256_set1_pd(high);
+		uint64_t bits = 0;
+		for(size_t ii = 0; ii < WORD_BITS; ii += 4) {
+			__m256d value = _mm256_loadu_pd(values + ii);
+			__m256d inside = _mm256_and_pd(_mm256_cmp_pd(value, lower, _CMP_GE_OQ), _mm256_cmp_pd(value, upper, _CMP_LE_OQ));
+			bits |= (uint64_t)_mm256_movemask_pd(inside) << ii;
+		}
+		return bits;
+	}
+#endif
+
+	/* the block filter for T, picked once from what the processor supports */
+	template <typename T>
+	struct block_filter {
+		typedef uint64_t (*function)(const T *values, T low, T high);
+
+		static function select() {
+			return between_block<T>;
+		}
+	};
+
+#ifdef PROPERTY_STORE_X86
+	template <>
+	struct block_filter<int64_t> {
+		typedef uint64_t (*function)(const int64_t *values, int64_t low, int64_t high);
+
+		static function select() {
+			__builtin_cpu_init();
+			if(__builtin_cpu_supports("avx2")) {
+				return between_avx2;
+			}
+			return between_block<int64_t>;
+		}
+	};
+
+	template <>
+	struct block_filter<double> {
+		typedef uint64_t (*function)(const double *values, double low, double high);
+
+		static function select() {
+			__builtin_cpu_init();
+			if(__builtin_cpu_supports("avx2")) {
+				return between_avx2;
+			}
+			return between_block<double>;
+		}
+	};
+#endif
+
+	/* words of a parallel pass over a bitset */
+	const size_t GRAIN_WORDS = 1024;
+}
+
+/* one bit per row; also the result of every filter */
+class bitset_column : public property_column {
+	public:
+		static const column_type TYPE = BITSET;
+
+		explicit bitset_column(size_type rows=0) : rows(rows), words((rows + column_scan::WORD_BITS - 1) / column_scan::WORD_BITS, 0) {
+
+		}
+
+		/*
+		 * Capacity
+		 */
+		column_type type() const {
+			return BITSET;
+		}
+
+		size_type size() const {
+			return rows;
+		}
+
+		size_type size_words() const {
+			return words.size();
+		}
+
+		memory_report memory_usage() const {
+			using namespace memory_accounting;
+
+			memory_report usage;
+			usage.nodes = sizeof(*this);
+			usage.payloads = words.capacity() * sizeof(uint64_t);
+			usage.overhead = allocation_overhead(words.capacity() * sizeof(uint64_t));
+
+			return usage;
+		}
+
+		/*
+		 * Element Access
+		 */
+		bool test(size_type row) const {
+			return (words[row / column_scan::WORD_BITS] >> (row % column_scan::WORD_BITS)) & 1;
+		}
+
+		uint64_t word(size_type index) const {
+			return words[index];
+		}
+
+		/* bits past size() must stay clear */
+		uint64_t * data() {
+			return words.empty() ? NULL : &words[0];
+		}
+
+		const uint64_t * data() const {
+			return words.empty() ? NULL : &words[0];
+		}
+
+		/*
+		 * Modifiers
+		 */
+		void set(size_type row, bool value=true) {
+			uint64_t bit = (uint64_t)1 << (row % column_scan::WORD_BITS);
+			if(value) {
+				words[row / column_scan::WORD_BITS] |= bit;
+			}
+			else {
+				words[row / column_scan::WORD_BITS] &= ~bit;
+			}
+		}
+
+		void fill(bool value) {
+			std::fill(words.begin(), words.end(), value ? ~(uint64_t)0 : 0);
+			clear_tail();
+		}
+
+		void resize(size_type size) {
+			rows = size;
+			words.resize((rows + column_scan::WORD_BITS - 1) / column_scan::WORD_BITS, 0);
+			clear_tail();
+		}
+
+		bitset_column & operator&=(const bitset_column &other) {
+			check_size(other);
+			uint64_t *target = data();
+			const uint64_t *source = other.data();
+			parallel::parallel_for(0, words.size(), column_scan::GRAIN_WORDS, [=](size_type ii) {
+				target[ii] &= source[ii];
+			});
+			return *this;
+		}
+
+		bitset_column & operator|=(const bitset_column &other) {
+			check_size(other);
+			uint64_t *target = data();
+			const uint64_t *source = other.data();
+			parallel::parallel_for(0, words.size(), column_scan::GRAIN_WORDS, [=](size_type ii) {
+				target[ii] |= source[ii];
+			});
+			return *this;
+		}
+
+		/* the rows not selected */
+		void flip() {
+			uint64_t *target = data();
+			parallel::parallel_for(0, words.size(), column_scan::GRAIN_WORDS, [=](size_type ii) {
+				target[ii] = ~target[ii];
+			});
+			clear_tail();
+		}
+
+		/*
+		 * Operations
+		 */
+		size_type count() const {
+			const uint64_t *source = data();
+			return parallel::parallel_reduce(0, words.size(), column_scan::GRAIN_WORDS, (size_type)0, [=](size_type ii) -> size_type {
+				return __builtin_popcountll(source[ii]);
+			}, std::plus<size_type>());
+		}
+
+		/* the selected rows in increasing order */
+		std::vector<size_type> selected() const {
+			std::vector<size_type> result;
+			result.reserve(count());
+			for(size_type ii = 0; ii < words.size(); ii++) {
+				for(uint64_t bits = words[ii]; bits != 0; bits &= bits - 1) {
+					result.push_back(ii * column_scan::WORD_BITS + __builtin_ctzll(bits));
+				}
+			}
+			return result;
+		}
+
+		void save(binary_io::writer &output) const {
+			output.array(words);
+		}
+
+		void load(binary_io::reader &input, size_type size) {
+			input.array(words, (size + column_scan::WORD_BITS - 1) / column_scan::WORD_BITS);
+			if(words.size() != (size + column_scan::WORD_BITS - 1) / column_scan::WORD_BITS) {
+				input.fail("bitset column has the wrong number of rows");
+			}
+			rows = size;
+			clear_tail();
+		}
+
+	protected:
+		size_type rows;
+		std::vector<uint64_t> words;
+
+		void clear_tail() {
+			if(rows % column_scan::WORD_BITS != 0) {
+				words.back() &= ((uint64_t)1 << (rows % column_scan::WORD_BITS)) - 1;
+			}
+		}
+
+		void check_size(const bitset_column &other) const {
+			if(other.rows != rows) {
+				std::ostringstream oss;
+				oss << "cannot combine selections of " << rows << " and " << other.rows << " rows";
+
+				throw std::domain_error(oss.str());
+			}
+		}
+};
+
+/* int_column and float_column */
+template <typename T, property_column::column_type COLUMN_TYPE>
+class numeric_column : public property_column {
+	public:
+		typedef T value_type;
+
+		static const column_type TYPE = COLUMN_TYPE;
+
+		explicit numeric_column(size_type rows=0) : values(rows, T()) {
+
+		}
+
+		/*
+		 * Capacity
+		 */
+		column_type type() const {
+			return TYPE;
+		}
+
+		size_type size() const {
+			return values.size();
+		}
+
+		memory_report memory_usage() const {
+			using namespace memory_accounting;
+
+			memory_report usage;
+			usage.nodes = sizeof(*this);
+			usage.payloads = values.capacity() * sizeof(T);
+			usage.overhead = allocation_overhead(values.capacity() * sizeof(T));
+
+			return usage;
+		}
+
+		/*
+		 * Element Access
+		 */
+		T & operator[](size_type row) {
+			return values[row];
+		}
+
+		const T & operator[](size_type row) const {
+			return values[row];
+		}
+
+		T * data() {
+			return values.empty() ? NULL : &values[0];
+		}
+
+		const T * data() const {
+			return values.empty() ? NULL : &values[0];
+		}
+
+		/*
+		 * Modifiers
+		 */
+		void resize(size_type rows) {
+			values.resize(rows, T());
+		}
+
+		void fill(T value) {
+			std::fill(values.begin(), values.end(), value);
+		}
+
+		/* copies a whole column, e.g. the per-vertex result of an algorithm */
+		void assign(const std::vector<T> &other) {
+			if(other.size() != values.size()) {
+				std::ostringstream oss;
+				oss << "expected " << values.size() << " values, got " << other.size();
+
+				throw std::domain_error(oss.str());
+			}
+			std::copy(other.begin(), other.end(), values.begin());
+		}
+
+		/*
+		 * Operations
+		 */
+
+		/* rows with low <= value <= high; NaN is never selected */
+		selection between(T low, T high) const {
+			static const typename column_scan::block_filter<T>::function filter = column_scan::block_filter<T>::select();
+
+			selection result(values.size());
+			size_type full = values.size() / column_scan::WORD_BITS;
+			const T *source = data();
+			uint64_t *target = result.data();
+
+			parallel::parallel_for(0, full, column_scan::GRAIN_WORDS, [=](size_type ii) {
+				target[ii] = filter(source + ii * column_scan::WORD_BITS, low, high);
+			});
+			if(full < result.size_words()) {
+				target[full] = column_scan::between_scalar(source + full * column_scan::WORD_BITS, values.size() % column_scan::WORD_BITS, low, high);
+			}
+			return result;
+		}
+
+		selection equal(T value) const {
+			return between(value, value);
+		}
+
+		selection at_least(T low) const {
+			return between(low, std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max());
+		}
+
+		selection at_most(T high) const {
+			return between(std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest(), high);
+		}
+
+		/* sum over the selected rows, or all rows without a mask */
+		T sum(const selection *mask=NULL) const {
+			return fold(mask, T(), std::plus<T>());
+		}
+
+		/* lowest selected value, or the largest T when nothing is selected */
+		T minimum(const selection *mask=NULL) const {
+			return fold(mask, std::numeric_limits<T>::max(), [](T lhs, T rhs) { return rhs < lhs ? rhs : lhs; });
+		}
+
+		/* highest selected value, or the lowest T when nothing is selected */
+		T maximum(const selection *mask=NULL) const {
+			return fold(mask, std::numeric_limits<T>::lowest(), [](T lhs, T rhs) { return lhs < rhs ? rhs : lhs; });
+		}
+
+		void save(binary_io::writer &output) const {
+			output.array(values);
+		}
+
+		void load(binary_io::reader &input, size_type rows) {
+			input.array(values, rows);
+			if(values.size() != rows) {
+				input.fail("column has the wrong number of rows");
+			}
+		}
+
+	protected:
+		std::vector<T> values;
+
+		/* folds 64-row blocks in parallel, then the blocks in order */
+		template <typename Combine>
+		T fold(const selection *mask, T identity, Combine combine) const {
+			if(mask != NULL && mask->size() != values.size()) {
+				std::ostringstream oss;
+				oss << "selection of " << mask->size() << " rows applied to a column of " << values.size();
+
+				throw std::domain_error(oss.str());
+			}
+
+			size_type num_rows = values.size();
+			size_type num_words = (num_rows + column_scan::WORD_BITS - 1) / column_scan::WORD_BITS;
+			const T *source = data();
+			const uint64_t *bits = mask == NULL ? NULL : mask->data();
+
+			return parallel::parallel_reduce(0, num_words, column_scan::GRAIN_WORDS, identity, [=](size_type ii) -> T {
+				T result = identity;
+				size_type first = ii * column_scan::WORD_BITS;
+				if(bits == NULL) {
+					size_type last = std::min(first + column_scan::WORD_BITS, num_rows);
+					for(size_type row = first; row < last; row++) {
+						result = combine(result, source[row]);
+					}
+				}
+				else {
+					for(uint64_t word = bits[ii]; word != 0; word &= word - 1) {
+						result = combine(result, source[first + __builtin_ctzll(word)]);
+					}
+				}
+				return result;
+			}, combine);
+		}
+};
+
+typedef numeric_column<int64_t,property_column::INT> int_column;
+typedef numeric_column<double,property_column::FLOAT> float_column;
+
+/* strings interned per column, one 32-bit id per row */
+class string_column : public property_column {
+	public:
+		typedef uint32_t id_type;
+
+		static const column_type TYPE = STRING;
+		static const id_type NONE = 0xffffffffu;
+
+		explicit string_column(size_type rows=0) : ids(rows, (id_type)NONE) {
+
+		}
+
+		/*
+		 * Capacity
+		 */
+		column_type type() const {
+			return STRING;
+		}
+
+		size_type size() const {
+			return ids.size();
+		}
+
+		/* distinct strings */
+		size_type size_strings() const {
+			return strings.size();
+		}
+
+		/* the lookup table follows the libstdc++ hashtable: buckets plus a node per string */
+		memory_report memory_usage() const {
+			using namespace memory_accounting;
+
+			typedef std::pair<const std::string,id_type> lookup_value;
+			size_type node_size = sizeof(void *) + sizeof(lookup_value);
+
+			memory_report usage;
+			usage.nodes = sizeof(*this) + lookup.bucket_count() * sizeof(void *) + lookup.size() * sizeof(void *);
+			usage.keys = strings.capacity() * sizeof(std::string) + lookup.size() * sizeof(lookup_value);
+			usage.payloads = ids.capacity() * sizeof(id_type);
+			usage.strings = 2 * heap_bytes(strings.begin(), strings.end(), (const std::string *)NULL);
+			usage.overhead = lookup.size() * allocation_overhead(node_size) + allocation_overhead(lookup.bucket_count() * sizeof(void *)) + allocation_overhead(strings.capacity() * sizeof(std::string)) + allocation_overhead(ids.capacity() * sizeof(id_type));
+
+			return usage;
+		}
+
+		/*
+		 * Element Access
+		 */
+		bool has(size_type row) const {
+			return ids[row] != NONE;
+		}
+
+		id_type id(size_type row) const {
+			return ids[row];
+		}
+
+		const std::string & get(size_type row) const {
+			if(ids[row] == NONE) {
+				std::ostringstream oss;
+				oss << "row " << row << " has no value";
+
+				throw std::domain_error(oss.str());
+			}
+			return strings[ids[row]];
+		}
+
+		const std::string & text(id_type id) const {
+			return strings[id];
+		}
+
+		/* NONE when the string is in no row */
+		id_type find(const std::string &value) const {
+			std::unordered_map<std::string,id_type>::const_iterator iter = lookup.find(value);
+			return iter == lookup.end() ? NONE : iter->second;
+		}
+
+		/*
+		 * Modifiers
+		 */
+		void set(size_type row, const std::string &value) {
+			std::pair<std::unordered_map<std::string,id_type>::iterator,bool> result = lookup.insert(std::make_pair(value, (id_type)strings.size()));
+			if(result.second) {
+				if(strings.size() == (size_type)NONE) {
+					lookup.erase(result.first);
+
+					std::ostringstream oss;
+					oss << "too many distinct strings";
+
+					throw std::length_error(oss.str());
+				}
+				strings.push_back(value);
+			}
+			ids[row] = result.first->second;
+		}
+
+		void unset(size_type row) {
+			ids[row] = NONE;
+		}
+
+		void resize(size_type rows) {
+			ids.resize(rows, (id_type)NONE);
+		}
+
+		/*
+		 * Operations
+		 */
+		selection equal(const std::string &value) const {
+			return equal_id(find(value));
+		}
+
+		/* equal_id(NONE) selects the rows without a value */
+		selection equal_id(id_type id) const {
+			selection result(ids.size());
+			size_type num_rows = ids.size();
+			const id_type *source = ids.empty() ? NULL : &ids[0];
+			uint64_t *target = result.data();
+
+			parallel::parallel_for(0, result.size_words(), column_scan::GRAIN_WORDS, [=](size_type ii) {
+				size_type first = ii * column_scan::WORD_BITS;
+				size_type count = std::min(column_scan::WORD_BITS, num_rows - first);
+				target[ii] = column_scan::between_scalar(source + first, count, id, id);
+			});
+			return result;
+		}
+
+		void save(binary_io::writer &output) const {
+			output.value((uint64_t)strings.size());
+			for(size_type ii = 0; ii < strings.size(); ii++) {
+				output.text(strings[ii]);
+			}
+			output.array(ids);
+		}
+
+		void load(binary_io::reader &input, size_type rows) {
+			uint64_t num_strings = 0;
+			input.value(num_strings);
+			if(num_strings > (uint64_t)NONE) {
+				input.fail("string column has too many strings");
+			}
+
+			std::vector<std::string> loaded;
+			std::unordered_map<std::string,id_type> loaded_lookup;
+			for(uint64_t ii = 0; ii < num_strings; ii++) {
+				std::string value;
+				input.text(value);
+				if(!loaded_lookup.insert(std::make_pair(value, (id_type)ii)).second) {
+					input.fail("string column repeats a string");
+				}
+				loaded.push_back(value);
+			}
+
+			std::vector<id_type> loaded_ids;
+			input.array(loaded_ids, rows);
+			if(loaded_ids.size() != rows) {
+				input.fail("column has the wrong number of rows");
+			}
+			for(size_type ii = 0; ii < loaded_ids.size(); ii++) {
+				if(loaded_ids[ii] != NONE && loaded_ids[ii] >= num_strings) {
+					input.fail("string column refers to a missing string");
+				}
+			}
+
+			strings.swap(loaded);
+			lookup.swap(loaded_lookup);
+			ids.swap(loaded_ids);
+		}
+
+	protected:
+		std::vector<std::string> strings;
+		std::unordered_map<std::string,id_type> lookup;
+		std::vector<id_type> ids;
+};
+
+/* named columns over the same rows */
+class property_table {
+	public:
+		typedef size_t size_type;
+
+		typedef std::map<std::string,std::unique_ptr<property_column> > column_map;
+		typedef column_map::const_iterator const_iterator;
+
+		explicit property_table(size_type rows=0) : rows(rows) {
+
+		}
+
+		property_table(property_table &&other) = default;
+		property_table & operator=(property_table &&other) = default;
+
+		property_table(const property_table &other) = delete;
+		property_table & operator=(const property_table &other) = delete;
+
+		/*
+		 * Iterators
+		 */
+
+		/* (name, column) pairs in name order */
+		const_iterator begin() const {
+			return columns.begin();
+		}
+
+		const_iterator end() const {
+			return columns.end();
+		}
+
+		/*
+		 * Capacity
+		 */
+		size_type size_rows() const {
+			return rows;
+		}
+
+		size_type size_columns() const {
+			return columns.size();
+		}
+
+		memory_report memory_usage() const {
+			using namespace memory_accounting;
+
+			typedef std::pair<const std::string,std::unique_ptr<property_column> > column_value;
+
+			memory_report usage;
+			usage.nodes = sizeof(*this) + columns.size() * TREE_NODE_HEADER;
+			usage.keys = columns.size() * sizeof(column_value);
+			usage.overhead = columns.size() * allocation_overhead(tree_node(sizeof(column_value)));
+
+			const_iterator iter = columns.begin();
+			for(; iter != columns.end(); ++iter) {
+				usage.strings += heap_usage<std::string>::bytes(iter->first);
+				usage += iter->second->memory_usage();
+			}
+
+			return usage;
+		}
+
+		/*
+		 * Element Access
+		 */
+		bool has(const std::string &name) const {
+			return columns.count(name) != 0;
+		}
+
+		const property_column & column(const std::string &name) const {
+			const_iterator iter = columns.find(name);
+			if(iter == columns.end()) {
+				std::ostringstream oss;
+				oss << "no column named " << name;
+
+				throw std::domain_error(oss.str());
+			}
+			return *iter->second;
+		}
+
+		int_column & ints(const std::string &name) {
+			return typed<int_column>(name);
+		}
+
+		const int_column & ints(const std::string &name) const {
+			return typed<int_column>(name);
+		}
+
+		float_column & floats(const std::string &name) {
+			return typed<float_column>(name);
+		}
+
+		const float_column & floats(const std::string &name) const {
+			return typed<float_column>(name);
+		}
+
+		string_column & strings(const std::string &name) {
+			return typed<string_column>(name);
+		}
+
+		const string_column & strings(const std::string &name) const {
+			return typed<string_column>(name);
+		}
+
+		bitset_column & bitsets(const std::string &name) {
+			return typed<bitset_column>(name);
+		}
+
+		const bitset_column & bitsets(const std::string &name) const {
+			return typed<bitset_column>(name);
+		}
+
+		/*
+		 * Modifiers
+		 */
+
+		/* the add functions return the existing column if it has the same type */
+		int_column & add_int(const std::string &name) {
+			return add<int_column>(name);
+		}
+
+		float_column & add_float(const std::string &name) {
+			return add<float_column>(name);
+		}
+
+		string_column & add_string(const std::string &name) {
+			return add<string_column>(name);
+		}
+
+		bitset_column & add_bitset(const std::string &name) {
+			return add<bitset_column>(name);
+		}
+
+		bool remove(const std::string &name) {
+			return columns.erase(name) != 0;
+		}
+
+		void resize(size_type size) {
+			rows = size;
+			column_map::iterator iter = columns.begin();
+			for(; iter != columns.end(); ++iter) {
+				iter->second->resize(rows);
+			}
+		}
+
+		void clear() {
+			columns.clear();
+		}
+
+		/*
+		 * Operations
+		 */
+		void save(binary_io::writer &output) const {
+			output.value((uint64_t)rows);
+			output.value((uint64_t)columns.size());
+
+			const_iterator iter = columns.begin();
+			for(; iter != columns.end(); ++iter) {
+				output.text(iter->first);
+				output.value((uint32_t)iter->second->type());
+				iter->second->save(output);
+			}
+		}
+
+		/* replaces every column; the file must have as many rows as the table */
+		void load(binary_io::reader &input) {
+			uint64_t file_rows = 0;
+			input.value(file_rows);
+			if(file_rows != rows) {
+				std::ostringstream oss;
+				oss << "table has " << file_rows << " rows, expected " << rows;
+				input.fail(oss.str());
+			}
+
+			uint64_t num_columns = 0;
+			input.value(num_columns);
+
+			column_map loaded;
+			for(uint64_t ii = 0; ii < num_columns; ii++) {
+				std::string name;
+				input.text(name);
+				uint32_t type = 0;
+				input.value(type);
+
+				std::unique_ptr<property_column> current(make_column((property_column::column_type)type));
+				if(!current) {
+					input.fail("unknown column type");
+				}
+				current->load(input, rows);
+				if(!loaded.insert(std::make_pair(name, std::move(current))).second) {
+					input.fail("repeated column " + name);
+				}
+			}
+			columns.swap(loaded);
+		}
+
+	protected:
+		size_type rows;
+		column_map columns;
+
+		static property_column * make_column(property_column::column_type type) {
+			switch(type) {
+				case property_column::INT:
+					return new int_column();
+				case property_column::FLOAT:
+					return new float_column();
+				case property_column::STRING:
+					return new string_column();
+				case property_column::BITSET:
+					return new bitset_column();
+			}
+			return NULL;
+		}
+
+		template <typename C>
+		C & add(const std::string &name) {
+			column_map::iterator iter = columns.find(name);
+			if(iter == columns.end()) {
+				iter = columns.insert(std::make_pair(name, std::unique_ptr<property_column>(new C(rows)))).first;
+			}
+			return checked<C>(name, *iter->second);
+		}
+
+		template <typename C>
+		C & typed(const std::string &name) {
+			return checked<C>(name, const_cast<property_column &>(column(name)));
+		}
+
+		template <typename C>
+		const C & typed(const std::string &name) const {
+			return checked<C>(name, const_cast<property_column &>(column(name)));
+		}
+
+		template <typename C>
+		static C & checked(const std::string &name, property_column &found) {
+			if(found.type() != C::TYPE) {
+				std::ostringstream oss;
+				oss << "column " << name << " holds " << property_column::type_name(found.type()) << " values, not " << property_column::type_name(C::TYPE);
+
+				throw std::domain_error(oss.str());
+			}
+			return static_cast<C &>(found);
+		}
+};
+
+/*
+ * Vertex and edge tables sized for one compact_graph or
+ * compact_digraph (whose edge rows are its outgoing arcs). The store
+ * remembers a fingerprint of that graph, which save() records and load()
+ * checks, so that values are never attached to another graph's rows.
+ */
+class property_store {
+	public:
+		typedef size_t size_type;
+
+		static const uint32_t VERSION = 2;
+
+		property_store() : fingerprint(0) {
+
+		}
+
+		template <typename G>
+		explicit property_store(const G &graph) : vertex_table(graph.size_vertices()), edge_table((size_type)(graph.begin_neighbors(graph.size_vertices()) - graph.begin_neighbors(0))), fingerprint(checkpointer::fingerprint(graph)) {
+
+		}
+
+		/*
+		 * Capacity
+		 */
+		memory_report memory_usage() const {
+			memory_report usage = vertex_table.memory_usage();
+			usage += edge_table.memory_usage();
+			return usage;
+		}
+
+		/*
+		 * Element Access
+		 */
+		property_table & vertices() {
+			return vertex_table;
+		}
+
+		const property_table & vertices() const {
+			return vertex_table;
+		}
+
+		property_table & edges() {
+			return edge_table;
+		}
+
+		const property_table & edges() const {
+			return edge_table;
+		}
+
+		/*
+		 * Operations
+		 */
+		void save(const std::string &filename) const {
+			binary_io::writer output(filename, "property_store", VERSION);
+			output.value(fingerprint);
+			vertex_table.save(output);
+			edge_table.save(output);
+			output.commit();
+		}
+
+		/*
+		 * Replaces both tables with the file's. The file must have been
+		 * saved for the graph this store was made for; on any error the
+		 * store is left unchanged.
+		 */
+		void load(const std::string &filename) {
+			uint32_t version = 0;
+			binary_io::reader input(filename, "property_store", version);
+			if(version != VERSION) {
+				std::ostringstream oss;
+				oss << "unsupported version " << version;
+				input.fail(oss.str());
+			}
+
+			uint64_t saved_fingerprint = 0;
+			input.value(saved_fingerprint);
+			if(saved_fingerprint != fingerprint) {
+				input.fail("properties were saved for a different graph");
+			}
+
+			property_table loaded_vertices(vertex_table.size_rows());
+			property_table loaded_edges(edge_table.size_rows());
+			loaded_vertices.load(input);
+			loaded_edges.load(input);
+			input.finish();
+
+			vertex_table = std::move(loaded_vertices);
+			edge_table = std::move(loaded_edges);
+		}
+
+	protected:
+		property_table vertex_table;
+		property_table edge_table;
+		uint64_t fingerprint;
+};
+
+#endif
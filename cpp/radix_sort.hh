@@ -0,0 +1,135 @@
+#ifndef _RADIX_SORT_HH_
+#define _RADIX_SORT_HH_
+
+#include <vector>
+
+#include <algorithm>
+#include <functional>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "parallel.hh"
+
+/*
+ * Parallel least-significant-digit radix sort and duplicate removal for
+ * packed 64-bit keys, or for records sorted on a packed key of their
+ * own. The input is cut into one contiguous slice per thread: each slice
+ * is histogrammed, the histograms are turned into per-slice bucket
+ * offsets, and each slice is scattered to its offsets, so every pass is
+ * stable and reads and writes memory sequentially. Passes whose digit is
+ * the same for every key are skipped.
+ */
+namespace radix_sort {
+	const unsigned int DIGIT_BITS = 11;
+	const size_t NUM_BUCKETS = size_t(1) << DIGIT_BITS;
+
+	/* sorts records on the low key_bits bits of key(record), using scratch as the second buffer */
+	template <typename T, typename Key>
+	void sort(std::vector<T> &keys, std::vector<T> &scratch, unsigned int key_bits, Key key) {
+		size_t num_keys = keys.size();
+		scratch.resize(num_keys);
+		if(num_keys < 2) {
+			return;
+		}
+
+		unsigned int num_passes = (std::min(key_bits, 64u) + DIGIT_BITS - 1) / DIGIT_BITS;
+		size_t num_slices = std::min(parallel::num_threads(), num_keys);
+		std::vector<size_t> counts(num_slices * NUM_BUCKETS);
+
+		T *source = &keys[0];
+		T *target = &scratch[0];
+		unsigned int swaps = 0;
+
+		for(unsigned int pass = 0; pass < num_passes; pass++) {
+			unsigned int shift = pass * DIGIT_BITS;
+
+			parallel::parallel_for(0, num_slices, 1, [&](size_t slice) {
+				size_t *count = &counts[slice * NUM_BUCKETS];
+				std::fill(count, count + NUM_BUCKETS, 0);
+				for(size_t ii = num_keys * slice / num_slices; ii < num_keys * (slice + 1) / num_slices; ii++) {
+					count[(key(source[ii]) >> shift) & (NUM_BUCKETS - 1)]++;
+				}
+			});
+
+			/* bucket-major, slice-minor, which is what keeps the pass stable */
+			size_t offset = 0;
+			bool skip = false;
+			for(size_t bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+				size_t bucket_total = 0;
+				for(size_t slice = 0; slice < num_slices; slice++) {
+					size_t tmp = counts[slice * NUM_BUCKETS + bucket];
+					counts[slice * NUM_BUCKETS + bucket] = offset;
+					offset += tmp;
+					bucket_total += tmp;
+				}
+				if(bucket_total == num_keys) {
+					skip = true;
+				}
+			}
+			if(skip) {
+				continue;
+			}
+
+			parallel::parallel_for(0, num_slices, 1, [&](size_t slice) {
+				size_t *count = &counts[slice * NUM_BUCKETS];
+				for(size_t ii = num_keys * slice / num_slices; ii < num_keys * (slice + 1) / num_slices; ii++) {
+					target[count[(key(source[ii]) >> shift) & (NUM_BUCKETS - 1)]++] = source[ii];
+				}
+			});
+			std::swap(source, target);
+			swaps++;
+		}
+
+		if(swaps % 2 == 1) {
+			keys.swap(scratch);
+		}
+	}
+
+	/* sorts keys on their low key_bits bits, using scratch as the second buffer */
+	inline void sort(std::vector<uint64_t> &keys, std::vector<uint64_t> &scratch, unsigned int key_bits=64) {
+		sort(keys, scratch, key_bits, [](uint64_t value) {
+			return value;
+		});
+	}
+
+	/* removes adjacent duplicates from sorted keys, using scratch as the second buffer */
+	inline void unique(std::vector<uint64_t> &keys, std::vector<uint64_t> &scratch) {
+		size_t num_keys = keys.size();
+		scratch.resize(num_keys);
+		if(num_keys < 2) {
+			return;
+		}
+
+		/* keys kept from each chunk, then where each chunk's keys go */
+		const size_t CHUNK = size_t(1) << 16;
+		size_t num_chunks = (num_keys + CHUNK - 1) / CHUNK;
+		std::vector<size_t> offsets(num_chunks);
+
+		parallel::parallel_for(0, num_chunks, 1, [&](size_t chunk) {
+			size_t kept = 0;
+			for(size_t ii = chunk * CHUNK; ii < std::min((chunk + 1) * CHUNK, num_keys); ii++) {
+				if(ii == 0 || keys[ii] != keys[ii-1]) {
+					kept++;
+				}
+			}
+			offsets[chunk] = kept;
+		});
+
+		size_t num_unique = parallel::parallel_scan(&offsets[0], &offsets[0], num_chunks, 1024, (size_t)0, std::plus<size_t>());
+
+		parallel::parallel_for(0, num_chunks, 1, [&](size_t chunk) {
+			size_t position = offsets[chunk];
+			for(size_t ii = chunk * CHUNK; ii < std::min((chunk + 1) * CHUNK, num_keys); ii++) {
+				if(ii == 0 || keys[ii] != keys[ii-1]) {
+					scratch[position++] = keys[ii];
+				}
+			}
+		});
+
+		scratch.resize(num_unique);
+		keys.swap(scratch);
+	}
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef _READ_GRAPH_HH_
+#define _READ_GRAPH_HH_
+
+
+#include <iostream>
+#include <ios>
+#include <iomanip>
+
+#include <string>
+
+#include "graph.hh"
+#include "labeled_graph.hh"
+#include "graph_builder.hh"
+#include "label_list.hh"
+#include "ntriples.hh"
+
+inline void progress(double progress, unsigned int width=50, char label='#') {
+	unsigned int ii;
+	unsigned int count = progress * width;
+
+	std::cerr << "\r[";
+	for(ii=0; ii < count; ii++) {
+		std::cerr << label;
+	}
+	for(; ii < width; ii++) {
+		std::cerr << ' ';
+	}
+	std::cerr << "] ";
+
+	std::cerr << std::setfill(' ') << std::setw(7) << std::fixed << std::setprecision(3) << (100*progress) << "%";
+	if(progress == 1.0) {
+		std::cerr << std::endl;
+	}
+
+	std::cerr.flush();
+}
+
+/* graph<V> has no edge labels, so predicates are not interned */
+inline void insert_triple(graph<std::string *> &graph, label_list<std::string> &labels, const std::string &src, const std::string &, const std::string &dst) {
+	std::string *src_vertex = labels[src];
+	std::string *dst_vertex = labels[dst];
+
+	graph.insert(src_vertex);
+	graph.insert(dst_vertex);
+
+	graph.insert(src_vertex, dst_vertex);
+}
+
+/* the predicate labels the edge; of several predicates between two vertices the first is kept */
+inline void insert_triple(labeled_graph<std::string *,std::string *> &graph, label_list<std::string> &labels, const std::string &src, const std::string &edg, const std::string &dst) {
+	std::string *src_vertex = labels[src];
+	std::string *dst_vertex = labels[dst];
+
+	graph.insert(src_vertex, src_vertex);
+	graph.insert(dst_vertex, dst_vertex);
+
+	graph.insert(src_vertex, dst_vertex, labels[edg]);
+}
+
+inline void insert_triple(graph_builder<std::string *> &builder, label_list<std::string> &labels, const std::string &src, const std::string &, const std::string &dst) {
+	builder.insert(labels[src], labels[dst]);
+}
+
+/*
+ * Reads an N-Triples file into graph, interning vertex labels in labels.
+ * Malformed lines throw std::runtime_error naming filename:line. A
+ * non-zero report_interval prints the memory held by the graph and the
+ * labels, and the live allocator totals, every report_interval triples.
+ */
+template <typename G>
+void read_graph(const std::string &filename, G &graph, label_list<std::string> &labels, unsigned int report_interval=0) {
+	ntriples::reader reader(filename);
+	ntriples::triple triple;
+
+	std::string src, edg, dst;
+	unsigned int count = 0;
+	while(reader.next(triple)) {
+		count++;
+		if(count % 10000 == 0) {
+			progress(reader.position()/(double)reader.size());
+		}
+
+		src.assign(triple.subject.data, triple.subject.length);
+		edg.assign(triple.predicate.data, triple.predicate.length);
+		dst.assign(triple.object.data, triple.object.length);
+
+		insert_triple(graph, labels, src, edg, dst);
+
+		if(report_interval != 0 && count % report_interval == 0) {
+			std::cerr << std::endl << filename << ":" << reader.line() << ": graph " << graph.memory_usage() << std::endl;
+			std::cerr << filename << ":" << reader.line() << ": labels " << labels.memory_usage() << std::endl;
+			std::cerr << filename << ":" << reader.line() << ": allocator " << allocation_counter::global().counts() << std::endl;
+		}
+	}
+
+	progress(1.0);
+}
+
+#endif
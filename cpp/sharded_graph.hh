@@ -0,0 +1,641 @@
+#ifndef _SHARDED_GRAPH_HH_
+#define _SHARDED_GRAPH_HH_
+
+#include <string>
+#include <vector>
+
+#include <sstream>
+
+#include <algorithm>
+#include <limits>
+
+#include <stdexcept>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "binary_io.hh"
+#include "transport.hh"
+
+/*
+ * Edge-cut partition of vertex indices 0..n-1 into contiguous ranges,
+ * one per worker. The ranges are cut so that each holds about the same
+ * number of vertices plus arcs, which is what a worker's memory and
+ * per-step work are proportional to. Because the ranges follow the
+ * vertex order, a vertex's owner is a binary search over the cut points.
+ */
+class graph_partition {
+	public:
+		typedef size_t size_type;
+
+		graph_partition() : bounds(1, 0) {
+
+		}
+
+		/* graph is a compact_graph or anything else with size_vertices() and degree() */
+		template <typename G>
+		graph_partition(const G &graph, size_type parts) : bounds(1, 0) {
+			if(parts == 0) {
+				throw std::domain_error("a partition needs at least one part");
+			}
+
+			size_type num_vertices = graph.size_vertices();
+			uint64_t total = 0;
+			for(size_type ii = 0; ii < num_vertices; ii++) {
+				total += graph.degree(ii) + 1;
+			}
+
+			uint64_t weight = 0;
+			size_type vertex = 0;
+			for(size_type part = 1; part < parts; part++) {
+				uint64_t target = total * part / parts;
+				while(vertex < num_vertices && weight + graph.degree(vertex) + 1 <= target) {
+					weight += graph.degree(vertex) + 1;
+					vertex++;
+				}
+				bounds.push_back(vertex);
+			}
+			bounds.push_back(num_vertices);
+		}
+
+		/*
+		 * Capacity
+		 */
+		size_type size() const {
+			return bounds.size() - 1;
+		}
+
+		size_type size_vertices() const {
+			return bounds.back();
+		}
+
+		/*
+		 * Element Access
+		 */
+		size_type begin(size_type part) const {
+			return bounds[part];
+		}
+
+		size_type end(size_type part) const {
+			return bounds[part + 1];
+		}
+
+		/*
+		 * Operations
+		 */
+		size_type owner(size_type vertex) const {
+			return (size_type)(std::upper_bound(bounds.begin() + 1, bounds.end(), vertex) - bounds.begin()) - 1;
+		}
+
+		/*
+		 * Serialization
+		 */
+		void save(binary_io::writer &output) const {
+			std::vector<uint64_t> data(bounds.begin(), bounds.end());
+			output.array(data);
+		}
+
+		void load(binary_io::reader &input) {
+			std::vector<uint64_t> data;
+			input.array(data);
+			if(data.size() < 2 || data[0] != 0 || !std::is_sorted(data.begin(), data.end())) {
+				input.fail("corrupt partition");
+			}
+			bounds.assign(data.begin(), data.end());
+		}
+
+	protected:
+		std::vector<size_type> bounds;
+};
+
+/*
+ * The part of a graph one worker holds: the neighbor lists of the
+ * vertices in its range of the partition, with neighbors as global
+ * vertex indices, plus the partition itself to find other vertices'
+ * owners. A shard is cut from a compact_graph in memory, or saved once
+ * per part so that each worker loads only its own file.
+ */
+class graph_shard {
+	public:
+		typedef size_t size_type;
+		typedef uint32_t index_type;
+
+		static const uint32_t VERSION = 1;
+
+		graph_shard() : part(0), offsets(1, 0) {
+
+		}
+
+		template <typename G>
+		graph_shard(const G &graph, const graph_partition &partition, size_type part) : partition(partition), part(part), offsets(1, 0) {
+			if(part >= partition.size() || partition.size_vertices() != graph.size_vertices()) {
+				std::ostringstream oss;
+				oss << "shard " << part << " does not match the partition";
+
+				throw std::domain_error(oss.str());
+			}
+
+			for(size_type vertex = partition.begin(part); vertex < partition.end(part); vertex++) {
+				neighbors.insert(neighbors.end(), graph.begin_neighbors(vertex), graph.end_neighbors(vertex));
+				offsets.push_back(neighbors.size());
+			}
+		}
+
+		/*
+		 * Capacity
+		 */
+
+		/* vertices of the whole graph */
+		size_type size_vertices() const {
+			return partition.size_vertices();
+		}
+
+		/* vertices this shard owns */
+		size_type size_local() const {
+			return offsets.size() - 1;
+		}
+
+		size_type size_arcs() const {
+			return neighbors.size();
+		}
+
+		/*
+		 * Element Access
+		 */
+		const graph_partition & parts() const {
+			return partition;
+		}
+
+		size_type rank() const {
+			return part;
+		}
+
+		/* global index of the first vertex this shard owns */
+		size_type first() const {
+			return partition.begin(part);
+		}
+
+		size_type degree(size_type local) const {
+			return offsets[local+1] - offsets[local];
+		}
+
+		const index_type * begin_neighbors(size_type local) const {
+			return neighbors.data() + offsets[local];
+		}
+
+		const index_type * end_neighbors(size_type local) const {
+			return neighbors.data() + offsets[local+1];
+		}
+
+		/*
+		 * Serialization
+		 */
+		void save(const std::string &filename) const {
+			binary_io::writer output(filename, "graph_shard", VERSION);
+			partition.save(output);
+			output.value((uint64_t)part);
+
+			std::vector<uint64_t> data(offsets.begin(), offsets.end());
+			output.array(data);
+			output.array(neighbors);
+			output.commit();
+		}
+
+		void load(const std::string &filename) {
+			uint32_t version = 0;
+			binary_io::reader input(filename, "graph_shard", version);
+			if(version != VERSION) {
+				std::ostringstream oss;
+				oss << "unsupported graph_shard version " << version;
+				input.fail(oss.str());
+			}
+
+			graph_partition other_partition;
+			other_partition.load(input);
+			uint64_t other_part = 0;
+			input.value(other_part);
+			if(other_part >= other_partition.size()) {
+				input.fail("part out of range");
+			}
+
+			size_type num_local = other_partition.end((size_type)other_part) - other_partition.begin((size_type)other_part);
+			std::vector<uint64_t> other_offsets;
+			std::vector<index_type> other_neighbors;
+			input.array(other_offsets, num_local + 1);
+			input.array(other_neighbors);
+			input.finish();
+
+			if(other_offsets.size() != num_local + 1 || other_offsets[0] != 0 || !std::is_sorted(other_offsets.begin(), other_offsets.end()) || other_offsets.back() != other_neighbors.size()) {
+				input.fail("corrupt offsets");
+			}
+			for(size_type ii = 0; ii < other_neighbors.size(); ii++) {
+				if(other_neighbors[ii] >= other_partition.size_vertices()) {
+					input.fail("neighbor out of range");
+				}
+			}
+
+			partition = other_partition;
+			part = (size_type)other_part;
+			offsets.assign(other_offsets.begin(), other_offsets.end());
+			neighbors.swap(other_neighbors);
+		}
+
+		/* writes one file per part, filename.0 through filename.(parts-1) */
+		template <typename G>
+		static void save_all(const G &graph, const graph_partition &partition, const std::string &filename) {
+			for(size_type part = 0; part < partition.size(); part++) {
+				std::ostringstream oss;
+				oss << filename << "." << part;
+				graph_shard(graph, partition, part).save(oss.str());
+			}
+		}
+
+	protected:
+		graph_partition partition;
+		size_type part;
+
+		std::vector<size_type> offsets;
+		std::vector<index_type> neighbors;
+};
+
+/*
+ * BFS, connected components and PageRank over a graph split across the
+ * workers of a transport, one graph_shard each, in bulk-synchronous
+ * supersteps: every worker runs a step over its own vertices, then all
+ * of them exchange what crossed the cut.
+ *
+ * At construction each worker lists the boundary vertices its arcs
+ * reach in every other shard (its ghosts) and sends each owner the list
+ * once. From then on values for ghosts travel as arrays aligned with
+ * those lists, so PageRank sends one double per ghost and no vertex ids
+ * at all, and BFS and components send the positions of the ghosts that
+ * changed. Values for one ghost are combined before they are sent.
+ *
+ * Every method is collective: all workers call it, in the same order,
+ * and each gets the values of the vertices it owns; gather() collects
+ * them on worker 0.
+ */
+class sharded_graph {
+	public:
+		typedef size_t size_type;
+		typedef uint32_t index_type;
+
+		static const index_type UNREACHED = 0xffffffff;
+
+		sharded_graph(const graph_shard &shard, transport &network) : shard(shard), network(network), steps(0) {
+			if(network.size() != shard.parts().size() || network.rank() != shard.rank()) {
+				std::ostringstream oss;
+				oss << "shard " << shard.rank() << " of " << shard.parts().size() << " given to worker " << network.rank() << " of " << network.size();
+
+				throw std::domain_error(oss.str());
+			}
+			initialize();
+		}
+
+		sharded_graph(const sharded_graph &other) = delete;
+		sharded_graph & operator=(const sharded_graph &other) = delete;
+
+		/*
+		 * Capacity
+		 */
+
+		/* supersteps taken by the last computation */
+		size_type size_steps() const {
+			return steps;
+		}
+
+		/* distinct vertices of other shards this shard has arcs to */
+		size_type size_ghosts() const {
+			return ghost_offsets.back();
+		}
+
+		/*
+		 * Operations
+		 */
+
+		/* hop distance from source (a global index) to each local vertex, or UNREACHED */
+		std::vector<index_type> bfs(size_type source) {
+			if(source >= shard.size_vertices()) {
+				std::ostringstream oss;
+				oss << "source " << source << " out of range";
+
+				throw std::domain_error(oss.str());
+			}
+
+			size_type num_local = shard.size_local();
+			std::vector<index_type> distance(num_local, (index_type)UNREACHED);
+			std::vector<bool> ghost_reached(size_ghosts(), false);
+			std::vector<index_type> frontier;
+			std::vector<index_type> next;
+			std::vector<std::vector<index_type> > outgoing(network.size());
+			std::vector<std::vector<index_type> > incoming;
+
+			if(shard.parts().owner(source) == shard.rank()) {
+				distance[source - shard.first()] = 0;
+				frontier.push_back((index_type)(source - shard.first()));
+			}
+
+			steps = 0;
+			for(index_type level = 0; network.sum((uint64_t)frontier.size()) != 0; level++) {
+				steps++;
+				next.clear();
+				for(size_type ii = 0; ii < frontier.size(); ii++) {
+					size_type local = frontier[ii];
+					for(size_type arc = offsets[local]; arc < offsets[local+1]; arc++) {
+						size_type target = targets[arc];
+						if(target < num_local) {
+							if(distance[target] == UNREACHED) {
+								distance[target] = level + 1;
+								next.push_back((index_type)target);
+							}
+						}
+						else if(!ghost_reached[target - num_local]) {
+							ghost_reached[target - num_local] = true;
+							size_type peer = ghost_owner(target - num_local);
+							outgoing[peer].push_back((index_type)(target - num_local - ghost_offsets[peer]));
+						}
+					}
+				}
+
+				network.exchange_records(outgoing, incoming);
+				for(size_type peer = 0; peer < incoming.size(); peer++) {
+					for(size_type ii = 0; ii < incoming[peer].size(); ii++) {
+						index_type local = boundary_vertex(peer, incoming[peer][ii]);
+						if(distance[local] == UNREACHED) {
+							distance[local] = level + 1;
+							next.push_back(local);
+						}
+					}
+				}
+				frontier.swap(next);
+			}
+
+			return distance;
+		}
+
+		/*
+		 * Component of each local vertex, named by the smallest global
+		 * index in it. Labels spread to a fixpoint inside each shard
+		 * before every exchange, so the number of supersteps grows with
+		 * the number of times a component crosses the cut, not with its
+		 * diameter.
+		 */
+		std::vector<index_type> components() {
+			size_type num_local = shard.size_local();
+			std::vector<index_type> label(num_local);
+			std::vector<bool> queued(num_local, true);
+
+			/* the smallest label sent or about to be sent to each ghost */
+			std::vector<index_type> ghost_label(size_ghosts(), (index_type)UNREACHED);
+			std::vector<bool> ghost_changed(size_ghosts(), false);
+			std::vector<index_type> changed;
+			std::vector<index_type> work(num_local);
+			std::vector<std::vector<ghost_value> > outgoing(network.size());
+			std::vector<std::vector<ghost_value> > incoming;
+
+			for(size_type local = 0; local < num_local; local++) {
+				label[local] = (index_type)(shard.first() + local);
+				work[local] = (index_type)local;
+			}
+
+			steps = 0;
+			for(;;) {
+				steps++;
+				while(!work.empty()) {
+					size_type local = work.back();
+					work.pop_back();
+					queued[local] = false;
+
+					for(size_type arc = offsets[local]; arc < offsets[local+1]; arc++) {
+						size_type target = targets[arc];
+						if(target < num_local) {
+							if(label[local] < label[target]) {
+								label[target] = label[local];
+								if(!queued[target]) {
+									queued[target] = true;
+									work.push_back((index_type)target);
+								}
+							}
+						}
+						else if(label[local] < ghost_label[target - num_local]) {
+							ghost_label[target - num_local] = label[local];
+							if(!ghost_changed[target - num_local]) {
+								ghost_changed[target - num_local] = true;
+								changed.push_back((index_type)(target - num_local));
+							}
+						}
+					}
+				}
+
+				/* a ghost is sent only its best label of the step */
+				for(size_type ii = 0; ii < changed.size(); ii++) {
+					size_type ghost = changed[ii];
+					size_type peer = ghost_owner(ghost);
+					ghost_value update;
+					update.slot = (index_type)(ghost - ghost_offsets[peer]);
+					update.value = ghost_label[ghost];
+					outgoing[peer].push_back(update);
+					ghost_changed[ghost] = false;
+				}
+				uint64_t num_sent = changed.size();
+				changed.clear();
+				if(network.sum(num_sent) == 0) {
+					break;
+				}
+
+				network.exchange_records(outgoing, incoming);
+				for(size_type peer = 0; peer < incoming.size(); peer++) {
+					for(size_type ii = 0; ii < incoming[peer].size(); ii++) {
+						index_type local = boundary_vertex(peer, incoming[peer][ii].slot);
+						if(incoming[peer][ii].value < label[local]) {
+							label[local] = incoming[peer][ii].value;
+							if(!queued[local]) {
+								queued[local] = true;
+								work.push_back(local);
+							}
+						}
+					}
+				}
+			}
+
+			return label;
+		}
+
+		/*
+		 * PageRank with uniform teleport; the rank of vertices without
+		 * neighbors is spread over every vertex. Stops when the L1 change
+		 * of an iteration falls below tolerance or after max_iterations.
+		 */
+		std::vector<double> pagerank(double damping=0.85, size_type max_iterations=100, double tolerance=1e-9) {
+			size_type num_local = shard.size_local();
+			double num_vertices = (double)shard.size_vertices();
+			std::vector<double> rank(num_local, 1.0 / num_vertices);
+			std::vector<double> sums(num_local + size_ghosts());
+			std::vector<std::vector<double> > outgoing(network.size());
+			std::vector<std::vector<double> > incoming;
+
+			steps = 0;
+			while(steps < max_iterations) {
+				steps++;
+				std::fill(sums.begin(), sums.end(), 0.0);
+
+				double dangling = 0.0;
+				for(size_type local = 0; local < num_local; local++) {
+					size_type degree = offsets[local+1] - offsets[local];
+					if(degree == 0) {
+						dangling += rank[local];
+						continue;
+					}
+					double share = rank[local] / (double)degree;
+					for(size_type arc = offsets[local]; arc < offsets[local+1]; arc++) {
+						sums[targets[arc]] += share;
+					}
+				}
+
+				for(size_type peer = 0; peer < network.size(); peer++) {
+					outgoing[peer].assign(sums.begin() + num_local + ghost_offsets[peer], sums.begin() + num_local + ghost_offsets[peer+1]);
+				}
+				network.exchange_records(outgoing, incoming);
+				for(size_type peer = 0; peer < incoming.size(); peer++) {
+					if(incoming[peer].size() != boundary[peer].size()) {
+						fail(peer, "sent the wrong number of ghost values");
+					}
+					for(size_type ii = 0; ii < incoming[peer].size(); ii++) {
+						sums[boundary[peer][ii]] += incoming[peer][ii];
+					}
+				}
+
+				dangling = network.sum(dangling);
+				double base = (1.0 - damping) / num_vertices + damping * dangling / num_vertices;
+				double change = 0.0;
+				for(size_type local = 0; local < num_local; local++) {
+					double updated = base + damping * sums[local];
+					change += std::fabs(updated - rank[local]);
+					rank[local] = updated;
+				}
+
+				if(network.sum(change) < tolerance) {
+					break;
+				}
+			}
+
+			return rank;
+		}
+
+		/* the whole vector in vertex order on worker 0; empty on the others */
+		template <typename T>
+		std::vector<T> gather(const std::vector<T> &local) {
+			std::vector<std::vector<T> > outgoing(network.size());
+			std::vector<std::vector<T> > incoming;
+			outgoing[0] = local;
+			network.exchange_records(outgoing, incoming);
+
+			std::vector<T> result;
+			if(network.rank() == 0) {
+				result.reserve(shard.size_vertices());
+				for(size_type peer = 0; peer < incoming.size(); peer++) {
+					result.insert(result.end(), incoming[peer].begin(), incoming[peer].end());
+				}
+			}
+			return result;
+		}
+
+	protected:
+		/* a value for one of the receiver's boundary vertices, by its slot */
+		struct ghost_value {
+			index_type slot;
+			index_type value;
+		};
+
+		const graph_shard &shard;
+		transport &network;
+		size_type steps;
+
+		/*
+		 * targets[arc] is the local index of a local neighbor, or
+		 * size_local() plus the ghost's slot. Ghost slots are grouped by
+		 * owner, ghost_offsets[peer] being the first slot owned by peer.
+		 */
+		std::vector<size_type> offsets;
+		std::vector<index_type> targets;
+		std::vector<size_type> ghost_offsets;
+
+		/* boundary[peer][ii] is the local vertex peer's ghost slot ii refers to */
+		std::vector<std::vector<index_type> > boundary;
+
+		void initialize() {
+			size_type num_local = shard.size_local();
+			size_type num_peers = network.size();
+			const graph_partition &partition = shard.parts();
+
+			/* distinct remote neighbors per owner, sorted */
+			std::vector<std::vector<index_type> > ghosts(num_peers);
+			offsets.assign(1, 0);
+			for(size_type local = 0; local < num_local; local++) {
+				for(const index_type *neighbor = shard.begin_neighbors(local); neighbor != shard.end_neighbors(local); ++neighbor) {
+					size_type peer = partition.owner(*neighbor);
+					if(peer != shard.rank()) {
+						ghosts[peer].push_back(*neighbor);
+					}
+				}
+				offsets.push_back(offsets.back() + shard.degree(local));
+			}
+
+			ghost_offsets.assign(1, 0);
+			for(size_type peer = 0; peer < num_peers; peer++) {
+				std::sort(ghosts[peer].begin(), ghosts[peer].end());
+				ghosts[peer].erase(std::unique(ghosts[peer].begin(), ghosts[peer].end()), ghosts[peer].end());
+				ghost_offsets.push_back(ghost_offsets.back() + ghosts[peer].size());
+			}
+			if(num_local + ghost_offsets.back() > UNREACHED) {
+				throw std::length_error("too many vertices in one shard");
+			}
+
+			targets.resize(shard.size_arcs());
+			for(size_type local = 0; local < num_local; local++) {
+				size_type arc = offsets[local];
+				for(const index_type *neighbor = shard.begin_neighbors(local); neighbor != shard.end_neighbors(local); ++neighbor, ++arc) {
+					size_type peer = partition.owner(*neighbor);
+					if(peer == shard.rank()) {
+						targets[arc] = (index_type)(*neighbor - shard.first());
+					}
+					else {
+						size_type slot = (size_type)(std::lower_bound(ghosts[peer].begin(), ghosts[peer].end(), *neighbor) - ghosts[peer].begin());
+						targets[arc] = (index_type)(num_local + ghost_offsets[peer] + slot);
+					}
+				}
+			}
+
+			/* each owner learns which of its vertices the slots stand for */
+			network.exchange_records(ghosts, boundary);
+			for(size_type peer = 0; peer < num_peers; peer++) {
+				for(size_type ii = 0; ii < boundary[peer].size(); ii++) {
+					if(partition.owner(boundary[peer][ii]) != shard.rank()) {
+						fail(peer, "asked for a vertex this shard does not own");
+					}
+					boundary[peer][ii] -= (index_type)shard.first();
+				}
+			}
+		}
+
+		size_type ghost_owner(size_type ghost) const {
+			return (size_type)(std::upper_bound(ghost_offsets.begin() + 1, ghost_offsets.end(), ghost) - ghost_offsets.begin()) - 1;
+		}
+
+		index_type boundary_vertex(size_type peer, index_type slot) const {
+			if(slot >= boundary[peer].size()) {
+				fail(peer, "sent a ghost slot out of range");
+			}
+			return boundary[peer][slot];
+		}
+
+		void fail(size_type peer, const char *message) const {
+			std::ostringstream oss;
+			oss << "worker " << peer << " " << message;
+
+			throw std::runtime_error(oss.str());
+		}
+};
+
+#endif
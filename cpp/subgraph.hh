@@ -0,0 +1,226 @@
+#ifndef _SUBGRAPH_HH_
+#define _SUBGRAPH_HH_
+
+#include <vector>
+#include <utility>
+
+#include <sstream>
+
+#include <algorithm>
+
+#include <stdexcept>
+
+#include <cstddef>
+
+#include "graph.hh"
+#include "compact_graph.hh"
+#include "parallel.hh"
+
+/*
+ * Induced subgraph and k-hop ego network extraction. Membership is kept
+ * in an array over the source graph that maps each member to its local
+ * index, so building a subgraph is a single pass over the adjacency of
+ * its vertices that writes the result directly as a compact_graph.
+ * Batches of seeds are extracted in parallel, each thread with its own
+ * array.
+ */
+template <typename V>
+class subgraph_extractor {
+	public:
+		typedef size_t size_type;
+		typedef typename compact_graph<V>::index_type index_type;
+
+		typedef typename compact_graph<V>::VERTEX VERTEX;
+
+		template <typename Storage>
+		explicit subgraph_extractor(const graph<V, Storage> &other) : owned(other), adjacency(owned) {
+
+		}
+
+		/* other is referenced, not copied, and must outlive the extractor */
+		explicit subgraph_extractor(const compact_graph<V> &other) : adjacency(other) {
+
+		}
+
+		subgraph_extractor(const subgraph_extractor &) = delete;
+		subgraph_extractor & operator=(const subgraph_extractor &) = delete;
+
+		/*
+		 * Element Access
+		 */
+		const compact_graph<V> & source() const {
+			return adjacency;
+		}
+
+		/*
+		 * Operations
+		 */
+
+		/* subgraph induced by the given vertices; duplicates are ignored */
+		void induced(const std::vector<VERTEX> &vertices, compact_graph<V> &result) const {
+			scratch state(adjacency.size_vertices());
+			typename std::vector<VERTEX>::const_iterator vertex_iter = vertices.begin();
+			for(; vertex_iter != vertices.end(); ++vertex_iter) {
+				state.add(lookup(*vertex_iter));
+			}
+			extract(state, result);
+		}
+
+		/* subgraph induced by every vertex within hops of seed */
+		void ego_network(const VERTEX &seed, size_type hops, compact_graph<V> &result) const {
+			scratch state(adjacency.size_vertices());
+			state.add(lookup(seed));
+			expand(state, hops);
+			extract(state, result);
+		}
+
+		/* subgraph induced by every vertex within hops of any of the seeds */
+		void ego_network(const std::vector<VERTEX> &seeds, size_type hops, compact_graph<V> &result) const {
+			scratch state(adjacency.size_vertices());
+			typename std::vector<VERTEX>::const_iterator seed_iter = seeds.begin();
+			for(; seed_iter != seeds.end(); ++seed_iter) {
+				state.add(lookup(*seed_iter));
+			}
+			expand(state, hops);
+			extract(state, result);
+		}
+
+		/* one ego network per seed, results[ii] belonging to seeds[ii] */
+		void ego_networks(const std::vector<VERTEX> &seeds, size_type hops, std::vector<compact_graph<V> > &results) const {
+			std::vector<index_type> indices(seeds.size());
+			for(size_type ii = 0; ii < seeds.size(); ii++) {
+				indices[ii] = lookup(seeds[ii]);
+			}
+
+			results.clear();
+			results.resize(seeds.size());
+
+			parallel::per_thread<scratch> states(scratch(adjacency.size_vertices()));
+			parallel::parallel_for(0, seeds.size(), 1, [&](size_type ii) {
+				scratch &state = states.local();
+				state.add(indices[ii]);
+				expand(state, hops);
+				extract(state, results[ii]);
+			});
+		}
+
+	protected:
+		static const index_type NONE = ~(index_type)0;
+
+		/*
+		 * Local index of every member, NONE elsewhere, and the member list
+		 * that clears it again. Indices are in insertion order until
+		 * extract() renumbers the members in vertex order.
+		 */
+		struct scratch {
+			std::vector<index_type> local;
+			std::vector<index_type> members;
+
+			scratch(size_type num_vertices) : local(num_vertices, (index_type)NONE) {
+
+			}
+
+			bool contains(index_type vertex) const {
+				return local[vertex] != NONE;
+			}
+
+			void add(index_type vertex) {
+				if(!contains(vertex)) {
+					local[vertex] = (index_type)members.size();
+					members.push_back(vertex);
+				}
+			}
+
+			void reset() {
+				typename std::vector<index_type>::const_iterator iter = members.begin();
+				for(; iter != members.end(); ++iter) {
+					local[*iter] = NONE;
+				}
+				members.clear();
+			}
+		};
+
+		compact_graph<V> owned;
+		const compact_graph<V> &adjacency;
+
+		index_type lookup(const VERTEX &vertex) const {
+			size_type index = adjacency.index(vertex);
+			if(index == adjacency.size_vertices()) {
+				std::ostringstream oss;
+				oss << "unexpected vertex";
+
+				throw std::domain_error(oss.str());
+			}
+			return (index_type)index;
+		}
+
+		/* breadth-first growth of the member set by up to hops levels */
+		void expand(scratch &state, size_type hops) const {
+			size_type begin = 0;
+			for(size_type hop = 0; hop < hops; hop++) {
+				size_type end = state.members.size();
+				if(begin == end) {
+					break;
+				}
+
+				for(size_type ii = begin; ii < end; ii++) {
+					index_type vertex = state.members[ii];
+					typename compact_graph<V>::const_neighbor_iterator iter = adjacency.begin_neighbors(vertex);
+					for(; iter != adjacency.end_neighbors(vertex); ++iter) {
+						state.add(*iter);
+					}
+				}
+
+				begin = end;
+			}
+		}
+
+		/*
+		 * Writes the subgraph induced by the members and resets the
+		 * scratch state. Members are sorted by source index and renumbered,
+		 * so local indices follow vertex order and filtered neighbor lists
+		 * stay sorted.
+		 */
+		void extract(scratch &state, compact_graph<V> &result) const {
+			std::vector<index_type> &members = state.members;
+			std::sort(members.begin(), members.end());
+
+			size_type num_members = members.size();
+			for(size_type ii = 0; ii < num_members; ii++) {
+				state.local[members[ii]] = (index_type)ii;
+			}
+
+			std::vector<VERTEX> vertices;
+			std::vector<size_type> offsets;
+			std::vector<index_type> neighbors;
+
+			vertices.reserve(num_members);
+			offsets.reserve(num_members + 1);
+			offsets.push_back(0);
+
+			size_type loops = 0;
+			for(size_type ii = 0; ii < num_members; ii++) {
+				index_type vertex = members[ii];
+				vertices.push_back(adjacency.vertex(vertex));
+
+				typename compact_graph<V>::const_neighbor_iterator iter = adjacency.begin_neighbors(vertex);
+				for(; iter != adjacency.end_neighbors(vertex); ++iter) {
+					index_type local = state.local[*iter];
+					if(local != NONE) {
+						if(*iter == vertex) {
+							loops++;
+						}
+						neighbors.push_back(local);
+					}
+				}
+				offsets.push_back(neighbors.size());
+			}
+
+			size_type num_edges = (neighbors.size() + loops) / 2;
+			result.assign(std::move(vertices), std::move(offsets), std::move(neighbors), num_edges);
+
+			state.reset();
+		}
+};
+
+#endif
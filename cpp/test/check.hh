@@ -0,0 +1,21 @@
+#ifndef _CHECK_HH_
+#define _CHECK_HH_
+
+#include <iostream>
+
+#include <cstdlib>
+
+/*
+ * Minimal checks for the programs under test/: a failed check reports
+ * where it failed and exits with a non-zero status, which stops make.
+ */
+#define CHECK(condition) check_that((condition), #condition, __FILE__, __LINE__)
+
+inline void check_that(bool condition, const char *text, const char *file, int line) {
+	if(!condition) {
+		std::cerr << file << ":" << line << ": check failed: " << text << std::endl;
+		std::exit(EXIT_FAILURE);
+	}
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include <iostream>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+#include <cstdint>
+
+#include "check.hh"
+#include "../graph.hh"
+#include "../compact_graph.hh"
+#include "../checkpoint.hh"
+#include "../binary_io.hh"
+
+/* a path 0-1-2-3 or a star around 0: same vertex and arc counts, different graphs */
+compact_graph<int> make_graph(bool star) {
+	graph<int> edges;
+	for(int vertex = 0; vertex < 4; vertex++) {
+		edges.insert(vertex);
+	}
+	for(int vertex = 1; vertex < 4; vertex++) {
+		edges.insert(star ? 0 : vertex - 1, vertex);
+	}
+	return compact_graph<int>(edges);
+}
+
+void test_fingerprint() {
+	CHECK(checkpointer::fingerprint(make_graph(false)) == checkpointer::fingerprint(make_graph(false)));
+	CHECK(checkpointer::fingerprint(make_graph(false)) != checkpointer::fingerprint(make_graph(true)));
+}
+
+/* resume() is expected to throw; returns whether it did */
+bool refused(checkpointer &checkpoints, const std::string &kind, uint64_t fingerprint) {
+	std::unique_ptr<binary_io::reader> input;
+	try {
+		checkpoints.resume(input, kind, fingerprint);
+	}
+	catch(std::runtime_error &) {
+		return true;
+	}
+	return false;
+}
+
+void test_round_trip() {
+	std::string filename = "test/checkpoint_test.tmp";
+	uint64_t key = checkpointer::fingerprint(make_graph(false));
+
+	checkpointer checkpoints(filename, 0.0);
+	CHECK(checkpoints.due());
+	CHECK(checkpoints.path() == filename);
+
+	std::unique_ptr<binary_io::reader> input;
+	CHECK(!checkpoints.resume(input, "engine", key));
+
+	std::vector<uint32_t> progress(3, 7);
+	for(uint32_t step = 0; step < 3; step++) {
+		binary_io::buffer &state = checkpoints.state("engine", key);
+		progress[step] = step;
+		state.value(step);
+		state.array(progress);
+		checkpoints.submit();
+	}
+	checkpoints.flush();
+	CHECK(checkpoints.size_written() == 3);
+
+	/* the file holds the last state submitted */
+	CHECK(checkpoints.resume(input, "engine", key));
+	uint32_t step = 0;
+	std::vector<uint32_t> found;
+	input->value(step);
+	input->array(found);
+	input->finish();
+	CHECK(step == 2 && found == progress);
+	input.reset();
+
+	CHECK(refused(checkpoints, "other engine", key));
+	CHECK(refused(checkpoints, "engine", checkpointer::fingerprint(make_graph(true))));
+
+	checkpoints.complete();
+	CHECK(!checkpoints.resume(input, "engine", key));
+}
+
+void test_interval() {
+	checkpointer checkpoints("test/checkpoint_test.tmp", 3600.0);
+	CHECK(!checkpoints.due());
+}
+
+/* a write that fails is reported to the engine rather than lost */
+void test_write_failure() {
+	checkpointer checkpoints("test/no such directory/checkpoint_test.tmp", 0.0);
+	checkpoints.state("engine", 0).value((uint32_t)1);
+	checkpoints.submit();
+	bool failed = false;
+	try {
+		checkpoints.flush();
+	}
+	catch(std::runtime_error &) {
+		failed = true;
+	}
+	CHECK(failed);
+	CHECK(checkpoints.size_written() == 0);
+}
+
+int main() {
+	test_fingerprint();
+	test_round_trip();
+	test_interval();
+	test_write_failure();
+
+	std::cout << "checkpoint_test: ok" << std::endl;
+	return 0;
+}
@@ -0,0 +1,101 @@
+#include <iostream>
+
+#include <vector>
+
+#include <cstddef>
+
+#include "check.hh"
+#include "../compact_digraph.hh"
+#include "../graph_builder.hh"
+
+typedef compact_digraph<int> digraph_type;
+
+/*
+ * Vertices 10..60 get indices 0..5. There is an arc each way between
+ * 10 and 20 and between 30 and 40, a self-loop at 40, a repeated arc
+ * 10->20, and 60 has no arcs at all.
+ */
+void build(digraph_type &result) {
+	graph_builder<int> builder;
+	builder.insert(10, 20);
+	builder.insert(20, 10);
+	builder.insert(10, 30);
+	builder.insert(30, 40);
+	builder.insert(40, 30);
+	builder.insert(40, 40);
+	builder.insert(20, 30);
+	builder.insert(10, 20);
+	builder.insert(50, 10);
+	builder.insert(60);
+	builder.build(result);
+}
+
+std::vector<size_t> list(digraph_type::const_neighbor_iterator begin, digraph_type::const_neighbor_iterator end) {
+	return std::vector<size_t>(begin, end);
+}
+
+std::vector<size_t> list(digraph_type::const_merged_iterator begin, digraph_type::const_merged_iterator end) {
+	return std::vector<size_t>(begin, end);
+}
+
+std::vector<size_t> expect(size_t size, size_t first=0, size_t second=0, size_t third=0) {
+	size_t values[] = { first, second, third };
+	return std::vector<size_t>(values, values + size);
+}
+
+void test_adjacency() {
+	digraph_type digraph;
+	build(digraph);
+	CHECK(digraph.size_vertices() == 6);
+	CHECK(digraph.size_arcs() == 8);
+	CHECK(digraph.size_reciprocal() == 2);
+	CHECK(digraph.vertex(3) == 40 && digraph.index(40) == 3 && digraph.index(45) == 6);
+
+	std::vector<size_t> out[] = { expect(2, 1, 2), expect(2, 0, 2), expect(1, 3), expect(2, 2, 3), expect(1, 0), expect(0) };
+	std::vector<size_t> in[] = { expect(2, 1, 4), expect(1, 0), expect(3, 0, 1, 3), expect(2, 2, 3), expect(0), expect(0) };
+	for(size_t vertex = 0; vertex < 6; vertex++) {
+		CHECK(list(digraph.begin_neighbors(vertex), digraph.end_neighbors(vertex)) == out[vertex]);
+		CHECK(list(digraph.begin_neighbors(vertex, digraph_type::INCOMING), digraph.end_neighbors(vertex, digraph_type::INCOMING)) == in[vertex]);
+		CHECK(digraph.degree(vertex) == out[vertex].size());
+		CHECK(digraph.degree(vertex, digraph_type::INCOMING) == in[vertex].size());
+	}
+
+	size_t num_arcs = 0;
+	for(size_t src = 0; src < 6; src++) {
+		for(size_t dst = 0; dst < 6; dst++) {
+			bool expected = false;
+			for(size_t ii = 0; ii < out[src].size(); ii++) {
+				expected |= out[src][ii] == dst;
+			}
+			CHECK(digraph.has_arc(src, dst) == expected);
+			num_arcs += expected;
+		}
+	}
+	CHECK(num_arcs == digraph.size_arcs());
+}
+
+/* reciprocal arcs and the self-loop appear once in the merged lists */
+void test_undirected() {
+	digraph_type digraph;
+	build(digraph);
+	digraph_type::undirected_view graph = digraph.undirected();
+	CHECK(graph.size_vertices() == 6);
+	CHECK(graph.size_edges() == 6);
+
+	std::vector<size_t> neighbors[] = { expect(3, 1, 2, 4), expect(2, 0, 2), expect(3, 0, 1, 3), expect(2, 2, 3), expect(1, 0), expect(0) };
+	for(size_t vertex = 0; vertex < 6; vertex++) {
+		CHECK(list(graph.begin_neighbors(vertex), graph.end_neighbors(vertex)) == neighbors[vertex]);
+		CHECK(graph.degree(vertex) == neighbors[vertex].size());
+		for(size_t other = 0; other < 6; other++) {
+			CHECK(graph.has_edge(vertex, other) == (digraph.has_arc(vertex, other) || digraph.has_arc(other, vertex)));
+		}
+	}
+}
+
+int main() {
+	test_adjacency();
+	test_undirected();
+
+	std::cout << "compact_digraph_test: ok" << std::endl;
+	return 0;
+}
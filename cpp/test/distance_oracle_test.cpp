@@ -0,0 +1,92 @@
+#include <iostream>
+
+#include <vector>
+#include <random>
+
+#include <cstddef>
+
+#include "check.hh"
+#include "../graph.hh"
+#include "../compact_graph.hh"
+#include "../distance_oracle.hh"
+
+typedef distance_oracle<int> oracle_type;
+
+/* a sparse random graph, so that there are long distances and several components */
+compact_graph<int> random_graph(int num_vertices, int num_edges, unsigned seed) {
+	std::mt19937 random(seed);
+	graph<int> edges;
+	for(int vertex = 0; vertex < num_vertices; vertex++) {
+		edges.insert(vertex);
+	}
+	for(int ii = 0; ii < num_edges; ii++) {
+		int src = (int)(random() % num_vertices);
+		int dst = (int)(random() % num_vertices);
+		if(src != dst) {
+			edges.insert(src, dst);
+		}
+	}
+	return compact_graph<int>(edges);
+}
+
+/* hop distances from root, INFINITE where unreachable */
+std::vector<size_t> bfs(const compact_graph<int> &adjacency, size_t root) {
+	std::vector<size_t> distance(adjacency.size_vertices(), (size_t)oracle_type::INFINITE);
+	std::vector<size_t> queue(1, root);
+	distance[root] = 0;
+	for(size_t head = 0; head < queue.size(); head++) {
+		size_t vertex = queue[head];
+		compact_graph<int>::const_neighbor_iterator iter = adjacency.begin_neighbors(vertex);
+		for(; iter != adjacency.end_neighbors(vertex); ++iter) {
+			if(distance[*iter] == oracle_type::INFINITE) {
+				distance[*iter] = distance[vertex] + 1;
+				queue.push_back(*iter);
+			}
+		}
+	}
+	return distance;
+}
+
+void test_against_bfs(oracle_type::selection by) {
+	compact_graph<int> adjacency = random_graph(400, 520, 7);
+	oracle_type oracle(adjacency);
+	oracle.build(4, by);
+	CHECK(oracle.size_landmarks() == 4);
+
+	for(size_t src = 0; src < adjacency.size_vertices(); src += 7) {
+		std::vector<size_t> distance = bfs(adjacency, src);
+		for(size_t dst = 0; dst < adjacency.size_vertices(); dst++) {
+			oracle_type::estimate bounds = oracle.bounds(src, dst);
+			CHECK(bounds.lower <= distance[dst] && distance[dst] <= bounds.upper);
+
+			/* a budget may stop the search early, but never past the truth */
+			oracle_type::estimate partial = oracle.refine(src, dst, 16);
+			CHECK(partial.lower <= distance[dst] && distance[dst] <= partial.upper);
+
+			oracle_type::estimate exact = oracle.refine(src, dst);
+			CHECK(exact.exact() && exact.lower == distance[dst]);
+		}
+	}
+}
+
+void test_vertex_lookup() {
+	graph<int> edges;
+	edges.insert(9);
+	for(int vertex = 10; vertex < 15; vertex++) {
+		edges.insert(vertex);
+		edges.insert(vertex - 1, vertex);
+	}
+	oracle_type oracle(edges);
+	oracle.build(1);
+	CHECK(oracle.refine(9, 14).lower == 5);
+	CHECK(oracle.bounds(12, 12).upper == 0);
+}
+
+int main() {
+	test_against_bfs(oracle_type::DEGREE);
+	test_against_bfs(oracle_type::CENTRALITY);
+	test_vertex_lookup();
+
+	std::cout << "distance_oracle_test: ok" << std::endl;
+	return 0;
+}
@@ -0,0 +1,94 @@
+#include <iostream>
+
+#include <string>
+#include <vector>
+#include <random>
+
+#include <cstddef>
+
+#include "check.hh"
+#include "../graph.hh"
+#include "../compact_graph.hh"
+#include "../graph_builder.hh"
+#include "../parallel.hh"
+
+/* the same vertices in the same order with the same neighbor lists */
+template <typename V>
+bool same_graph(const compact_graph<V> &lhs, const compact_graph<V> &rhs) {
+	if(lhs.size_vertices() != rhs.size_vertices() || lhs.size_edges() != rhs.size_edges()) {
+		return false;
+	}
+	for(size_t vertex = 0; vertex < lhs.size_vertices(); vertex++) {
+		if(lhs.vertex(vertex) != rhs.vertex(vertex)) {
+			return false;
+		}
+		std::vector<size_t> lhs_neighbors(lhs.begin_neighbors(vertex), lhs.end_neighbors(vertex));
+		std::vector<size_t> rhs_neighbors(rhs.begin_neighbors(vertex), rhs.end_neighbors(vertex));
+		if(lhs_neighbors != rhs_neighbors) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* duplicates both ways round, self-loops (some repeated) and isolated vertices */
+void test_against_graph(unsigned seed) {
+	std::mt19937 random(seed);
+	graph<int> expected_graph;
+	graph_builder<int> builder;
+	for(int ii = 0; ii < 2000; ii++) {
+		int src = (int)(random() % 500) * 7 - 1000;
+		int dst = ii % 50 == 0 ? src : (int)(random() % 500) * 7 - 1000;
+		expected_graph.insert(src);
+		expected_graph.insert(dst);
+		expected_graph.insert(src, dst);
+		builder.insert(src, dst);
+		if(ii % 3 == 0) {
+			builder.insert(dst, src);
+		}
+		if(ii % 10 == 0) {
+			builder.insert(src, dst);
+		}
+	}
+	for(int isolated = 5000; isolated < 5010; isolated++) {
+		expected_graph.insert(isolated);
+		builder.insert(isolated);
+	}
+
+	compact_graph<int> built;
+	builder.build(built);
+	CHECK(same_graph(built, compact_graph<int>(expected_graph)));
+}
+
+/* vertex order is the order of the values, not the order of arrival */
+void test_string_vertices() {
+	const char *names[] = { "pear", "apple", "fig", "apple", "kiwi", "date" };
+	graph<std::string> expected_graph;
+	graph_builder<std::string> builder;
+	for(size_t ii = 0; ii + 1 < sizeof(names) / sizeof(names[0]); ii++) {
+		expected_graph.insert(names[ii]);
+		expected_graph.insert(names[ii+1]);
+		expected_graph.insert(names[ii+1], names[ii]);
+		builder.insert(names[ii+1], names[ii]);
+	}
+	expected_graph.insert("plum");
+	builder.insert("plum");
+
+	compact_graph<std::string> built;
+	builder.build(built);
+	CHECK(same_graph(built, compact_graph<std::string>(expected_graph)));
+	CHECK(built.vertex(0) == "apple");
+}
+
+int main() {
+	/* several slices per sort even on a single-core machine */
+	parallel::configure(4);
+
+	for(unsigned seed = 0; seed < 4; seed++) {
+		test_against_graph(seed);
+	}
+	test_string_vertices();
+
+	std::cout << "graph_builder_test: ok" << std::endl;
+	return 0;
+}
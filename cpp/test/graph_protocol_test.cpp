@@ -0,0 +1,158 @@
+#include <iostream>
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <cstdint>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "check.hh"
+#include "../graph_protocol.hh"
+
+using namespace graph_protocol;
+
+void append_query(std::vector<char> &buffer, uint32_t op, uint32_t arg0, uint32_t arg1, uint32_t arg2, const std::string &text) {
+	append(buffer, op);
+	append(buffer, arg0);
+	append(buffer, arg1);
+	append(buffer, arg2);
+	append(buffer, (uint32_t)text.size());
+	append(buffer, text.data(), text.size());
+}
+
+/* a LOOKUP, an empty STATS and a DISTANCE */
+std::vector<char> make_batch() {
+	std::vector<char> buffer;
+	append(buffer, REQUEST_MAGIC);
+	append(buffer, 3);
+	append_query(buffer, LOOKUP, 0, 0, 0, "<http://example.org/a>");
+	append_query(buffer, STATS, 0, 0, 0, "");
+	append_query(buffer, DISTANCE, 7, 0x01020304, 3, "");
+	return buffer;
+}
+
+void check_batch(const std::vector<query> &batch) {
+	CHECK(batch.size() == 3);
+	CHECK(batch[0].op == LOOKUP && batch[0].text == "<http://example.org/a>");
+	CHECK(batch[1].op == STATS && batch[1].text.empty());
+	CHECK(batch[2].op == DISTANCE && batch[2].arg0 == 7 && batch[2].arg1 == 0x01020304 && batch[2].arg2 == 3);
+}
+
+void test_byte_order() {
+	std::vector<char> buffer;
+	append(buffer, 0x01020304);
+	CHECK(buffer.size() == 4);
+	CHECK(buffer[0] == 4 && buffer[1] == 3 && buffer[2] == 2 && buffer[3] == 1);
+	CHECK(decode(&buffer[0]) == 0x01020304);
+
+	buffer.clear();
+	append(buffer, 0xfffffffe);
+	CHECK(decode(&buffer[0]) == 0xfffffffe);
+	CHECK(std::string(&buffer[0], 4) == "\xfe\xff\xff\xff");
+}
+
+/* a batch fed a byte at a time completes with its last byte, and not before */
+void test_split_batches() {
+	std::vector<char> bytes = make_batch();
+	request_reader reader;
+	std::vector<query> batch;
+	CHECK(!reader.partial());
+	for(size_t ii = 0; ii + 1 < bytes.size(); ii++) {
+		reader.append(&bytes[ii], 1);
+		CHECK(!reader.next(batch));
+		CHECK(reader.partial());
+	}
+	reader.append(&bytes.back(), 1);
+	CHECK(reader.next(batch));
+	check_batch(batch);
+	CHECK(!reader.partial());
+
+	/* two pipelined batches and the start of a third in one read */
+	std::vector<char> pipelined(bytes);
+	pipelined.insert(pipelined.end(), bytes.begin(), bytes.end());
+	pipelined.insert(pipelined.end(), bytes.begin(), bytes.begin() + 13);
+	reader.append(&pipelined[0], pipelined.size());
+	CHECK(reader.next(batch));
+	check_batch(batch);
+	CHECK(reader.next(batch));
+	check_batch(batch);
+	CHECK(!reader.next(batch));
+	CHECK(reader.partial());
+	reader.append(&bytes[13], bytes.size() - 13);
+	CHECK(reader.next(batch));
+	check_batch(batch);
+}
+
+/* next() throws on the given bytes */
+bool rejected(const std::vector<char> &bytes) {
+	request_reader reader;
+	reader.append(&bytes[0], bytes.size());
+	std::vector<query> batch;
+	try {
+		reader.next(batch);
+	}
+	catch(std::runtime_error &) {
+		return true;
+	}
+	return false;
+}
+
+void test_malformed() {
+	std::vector<char> bytes = make_batch();
+	bytes[0] ^= 1;
+	CHECK(rejected(bytes));
+
+	bytes.clear();
+	append(bytes, REQUEST_MAGIC);
+	append(bytes, MAX_BATCH + 1);
+	CHECK(rejected(bytes));
+
+	/* an oversized length is refused before its payload arrives */
+	bytes.clear();
+	append(bytes, REQUEST_MAGIC);
+	append(bytes, 1);
+	append(bytes, LOOKUP);
+	append(bytes, 0);
+	append(bytes, 0);
+	append(bytes, 0);
+	append(bytes, MAX_LENGTH + 1);
+	CHECK(rejected(bytes));
+}
+
+void test_response() {
+	int pair[2];
+	CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+
+	std::vector<result> results(2);
+	results[0].status = OK;
+	append(results[0].payload, 42);
+	results[1].status = NOT_FOUND;
+	write_response(pair[0], results);
+	close(pair[0]);
+
+	std::vector<char> bytes;
+	char chunk[256];
+	ssize_t count;
+	while((count = read(pair[1], chunk, sizeof(chunk))) > 0) {
+		bytes.insert(bytes.end(), chunk, chunk + count);
+	}
+	close(pair[1]);
+
+	CHECK(bytes.size() == 2 * 4 + 3 * 4 + 2 * 4);
+	CHECK(decode(&bytes[0]) == RESPONSE_MAGIC && decode(&bytes[4]) == 2);
+	CHECK(decode(&bytes[8]) == OK && decode(&bytes[12]) == 4 && decode(&bytes[16]) == 42);
+	CHECK(decode(&bytes[20]) == NOT_FOUND && decode(&bytes[24]) == 0);
+}
+
+int main() {
+	test_byte_order();
+	test_split_batches();
+	test_malformed();
+	test_response();
+
+	std::cout << "graph_protocol_test: ok" << std::endl;
+	return 0;
+}
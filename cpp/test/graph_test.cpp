@@ -0,0 +1,136 @@
+#include <iostream>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "check.hh"
+#include "../graph.hh"
+#include "../compact_graph.hh"
+
+/* sparse ids are refused by dense storage instead of allocating their range */
+void test_dense_density() {
+	graph<long, dense_storage<long> > dense;
+	dense.insert(0L);
+	bool refused = false;
+	try {
+		dense.insert(1000000000000L);
+	}
+	catch(std::length_error &) {
+		refused = true;
+	}
+	CHECK(refused);
+	CHECK(dense.size_vertices() == 1);
+
+	refused = false;
+	try {
+		dense.insert(-1000000000000L);
+	}
+	catch(std::length_error &) {
+		refused = true;
+	}
+	CHECK(refused);
+
+	/* dense ids from any offset are fine */
+	graph<long, dense_storage<long> > offset;
+	for(long vertex = -1000; vertex < 100000; vertex++) {
+		offset.insert(vertex);
+	}
+	for(long vertex = -1000; vertex + 1 < 100000; vertex++) {
+		offset.insert(vertex, vertex + 1);
+	}
+	CHECK(offset.size_vertices() == 101000);
+	CHECK(offset.size_edges() == 100999);
+
+	graph<long, tree_storage<long> > tree;
+	tree.insert(0L);
+	tree.insert(1000000000000L);
+	tree.insert(0L, 1000000000000L);
+	CHECK(tree.size_vertices() == 2 && tree.size_edges() == 1);
+}
+
+/* sparse integer ids work with the default storage */
+void test_default_storage() {
+	graph<long> sparse;
+	sparse.insert(0L);
+	sparse.insert(1000000000000L);
+	sparse.insert(-1000000000000L);
+	sparse.insert(0L, 1000000000000L);
+	CHECK(sparse.size_vertices() == 3 && sparse.size_edges() == 1);
+}
+
+/* erase(it++) removes exactly the chosen edges, as it does for std::set */
+template <typename Storage>
+void test_erase_while_iterating() {
+	graph<int, Storage> complete;
+	for(int vertex = 0; vertex < 20; vertex++) {
+		complete.insert(vertex);
+	}
+	for(int src = 0; src < 20; src++) {
+		for(int dst = src + 1; dst < 20; dst++) {
+			complete.insert(src, dst);
+		}
+	}
+
+	typename graph<int, Storage>::edge_iterator edge_iter = complete.begin_edges();
+	while(edge_iter != complete.end_edges()) {
+		if((edge_iter->first + edge_iter->second) % 2 == 0) {
+			complete.erase(edge_iter++);
+		}
+		else {
+			++edge_iter;
+		}
+	}
+	CHECK(complete.size_edges() == 100);
+	for(edge_iter = complete.begin_edges(); edge_iter != complete.end_edges(); ++edge_iter) {
+		CHECK((edge_iter->first + edge_iter->second) % 2 == 1);
+	}
+
+	/* an iterator held across inserts and erases of other edges stays put */
+	edge_iter = complete.find(std::pair<int,int>(5, 6));
+	complete.insert(5, 5);
+	complete.erase(std::pair<int,int>(0, 1));
+	complete.erase(std::pair<int,int>(5, 8));
+	CHECK(*edge_iter == std::make_pair(5, 6));
+	++edge_iter;
+	CHECK(*edge_iter == std::make_pair(5, 10));
+}
+
+/* a snapshot of a dense graph matches one of the same graph in sets */
+void test_compact_from_dense() {
+	graph<int, dense_storage<int> > dense;
+	graph<int> tree;
+	for(int vertex = -5; vertex < 50; vertex++) {
+		dense.insert(vertex);
+		tree.insert(vertex);
+	}
+	for(int vertex = -5; vertex < 45; vertex++) {
+		dense.insert(vertex, ((vertex + 5) * 7 + 11) % 55 - 5);
+		tree.insert(vertex, ((vertex + 5) * 7 + 11) % 55 - 5);
+		dense.insert(vertex + 5, vertex);
+		tree.insert(vertex + 5, vertex);
+	}
+	dense.insert(3, 3);
+	tree.insert(3, 3);
+
+	compact_graph<int> from_dense(dense);
+	compact_graph<int> from_tree(tree);
+	CHECK(from_dense.size_vertices() == from_tree.size_vertices());
+	CHECK(from_dense.size_edges() == tree.size_edges());
+	CHECK(from_dense.size_edges() == from_tree.size_edges());
+	for(size_t ii = 0; ii < from_tree.size_vertices(); ii++) {
+		CHECK(from_dense.vertex(ii) == from_tree.vertex(ii));
+		CHECK(std::equal(from_tree.begin_neighbors(ii), from_tree.end_neighbors(ii), from_dense.begin_neighbors(ii)));
+		CHECK(from_dense.degree(ii) == from_tree.degree(ii));
+	}
+}
+
+int main() {
+	test_dense_density();
+	test_default_storage();
+	test_erase_while_iterating<tree_storage<int> >();
+	test_erase_while_iterating<dense_storage<int> >();
+	test_compact_from_dense();
+
+	std::cout << "graph_test: ok" << std::endl;
+	return 0;
+}
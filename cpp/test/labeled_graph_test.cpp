@@ -0,0 +1,70 @@
+#include <iostream>
+
+#include "check.hh"
+#include "../labeled_graph.hh"
+
+/* writes through the iterators of a copy must not reach the original */
+void test_copy_on_write() {
+	labeled_graph<int,int> original;
+	int one = 1;
+	int two = 2;
+	original.insert(1, one);
+	original.insert(2, two);
+	original.insert(1, 2, 10);
+
+	labeled_graph<int,int> copy = original;
+	copy.find(1)->second = 99;
+	CHECK(original.find(1)->second == 1);
+
+	copy = original;
+	int other = 7;
+	copy.insert(2, other).first->second = 55;
+	CHECK(original.find(2)->second == 2);
+
+	copy = original;
+	copy.begin_vertices()->second = 42;
+	copy.lower_bound(2)->second = 43;
+	copy.upper_bound(1)->second = 44;
+	CHECK(original.find(1)->second == 1);
+	CHECK(original.find(2)->second == 2);
+
+	copy = original;
+	copy.begin_edges()->second = 11;
+	CHECK(original.begin_edges()->second == 10);
+	copy = original;
+	copy.find(labeled_graph<int,int>::edge(1,2))->second = 12;
+	CHECK(original.begin_edges()->second == 10);
+
+	/* the original's own iterators write to its maps only */
+	copy = original;
+	original.find(1)->second = 5;
+	CHECK(copy.find(1)->second == 1);
+	CHECK(original.find(1)->second == 5);
+}
+
+void test_modifiers() {
+	labeled_graph<int,int> graph;
+	int one = 1;
+	int two = 2;
+	int three = 3;
+	graph.insert(1, one);
+	graph.insert(2, two);
+	graph.insert(3, three);
+	graph.insert(2, 1, 7);
+	graph.insert(2, 3, 8);
+
+	labeled_graph<int,int> copy = graph;
+	CHECK(copy.erase(2) == 1);
+	CHECK(copy.size_vertices() == 2 && copy.size_edges() == 0);
+	CHECK(graph.size_vertices() == 3 && graph.size_edges() == 2);
+	CHECK(graph.find(labeled_graph<int,int>::edge(1,2))->second == 7);
+	CHECK(copy.erase(2) == 0);
+}
+
+int main() {
+	test_copy_on_write();
+	test_modifiers();
+
+	std::cout << "labeled_graph_test: ok" << std::endl;
+	return 0;
+}
@@ -0,0 +1,89 @@
+#include <iostream>
+
+#include <vector>
+
+#include <cmath>
+#include <cstddef>
+
+#include "check.hh"
+#include "../graph.hh"
+#include "../louvain.hh"
+
+const int NUM_CLIQUES = 6;
+const int CLIQUE_SIZE = 5;
+
+/* cliques in a ring, each joined to the next by a single edge */
+graph<int> ring_of_cliques() {
+	graph<int> edges;
+	for(int vertex = 0; vertex < NUM_CLIQUES * CLIQUE_SIZE; vertex++) {
+		edges.insert(vertex);
+	}
+	for(int clique = 0; clique < NUM_CLIQUES; clique++) {
+		int first = clique * CLIQUE_SIZE;
+		for(int src = first; src < first + CLIQUE_SIZE; src++) {
+			for(int dst = src + 1; dst < first + CLIQUE_SIZE; dst++) {
+				edges.insert(src, dst);
+			}
+		}
+		edges.insert(first, (first + CLIQUE_SIZE + 1) % (NUM_CLIQUES * CLIQUE_SIZE));
+	}
+	return edges;
+}
+
+/* sum over communities of the fraction of edges inside minus the squared fraction of edge ends */
+double modularity(const graph<int> &edges, const louvain<int> &communities, size_t level) {
+	std::vector<double> inside(communities.size_communities(level), 0.0);
+	std::vector<double> ends(communities.size_communities(level), 0.0);
+	double num_edges = 0.0;
+	for(graph<int>::const_edge_iterator iter = edges.begin_edges(); iter != edges.end_edges(); ++iter) {
+		size_t src = communities.community(level, iter->first);
+		size_t dst = communities.community(level, iter->second);
+		if(src == dst) {
+			inside[src] += 1.0;
+		}
+		ends[src] += 1.0;
+		ends[dst] += 1.0;
+		num_edges += 1.0;
+	}
+
+	double score = 0.0;
+	for(size_t comm = 0; comm < inside.size(); comm++) {
+		score += inside[comm] / num_edges - (ends[comm] / (2.0 * num_edges)) * (ends[comm] / (2.0 * num_edges));
+	}
+	return score;
+}
+
+struct double_weight {
+	double operator()(const int &, const int &) const {
+		return 2.0;
+	}
+};
+
+/* every clique ends up as one community of its own */
+void check_cliques(const graph<int> &edges, const louvain<int> &communities) {
+	CHECK(communities.size_vertices() == (size_t)(NUM_CLIQUES * CLIQUE_SIZE));
+	CHECK(communities.size_levels() > 0);
+
+	size_t last = communities.size_levels() - 1;
+	CHECK(communities.size_communities(last) == (size_t)NUM_CLIQUES);
+	for(int vertex = 0; vertex < NUM_CLIQUES * CLIQUE_SIZE; vertex++) {
+		int first = vertex - vertex % CLIQUE_SIZE;
+		CHECK(communities.community(last, vertex) == communities.community(last, first));
+		CHECK(vertex < CLIQUE_SIZE || communities.community(last, vertex) != communities.community(last, first - CLIQUE_SIZE));
+	}
+
+	for(size_t level = 0; level <= last; level++) {
+		CHECK(std::fabs(communities.modularity(level) - modularity(edges, communities, level)) < 1e-9);
+		CHECK(level == 0 || communities.modularity(level) >= communities.modularity(level - 1));
+	}
+}
+
+int main() {
+	graph<int> edges = ring_of_cliques();
+	check_cliques(edges, louvain<int>(edges));
+	check_cliques(edges, louvain<int>(edges, false));
+	check_cliques(edges, louvain<int>(edges, double_weight()));
+
+	std::cout << "louvain_test: ok" << std::endl;
+	return 0;
+}
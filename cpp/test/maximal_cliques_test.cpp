@@ -0,0 +1,171 @@
+#include <iostream>
+
+#include <string>
+#include <vector>
+#include <random>
+#include <stdexcept>
+
+#include <algorithm>
+
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+
+#include "check.hh"
+#include "../graph.hh"
+#include "../compact_graph.hh"
+#include "../maximal_cliques.hh"
+#include "../checkpoint.hh"
+#include "../binary_io.hh"
+#include "../hashing.hh"
+
+const int NUM_VERTICES = 16;
+
+/* bit dst of rows[src] is set for every edge */
+graph<int> random_graph(std::vector<uint32_t> &rows, unsigned seed) {
+	std::mt19937 random(seed);
+	graph<int> edges;
+	rows.assign(NUM_VERTICES, 0);
+	for(int vertex = 0; vertex < NUM_VERTICES; vertex++) {
+		edges.insert(vertex);
+	}
+	for(int src = 0; src < NUM_VERTICES; src++) {
+		for(int dst = src + 1; dst < NUM_VERTICES; dst++) {
+			if(random() % 2 == 0) {
+				edges.insert(src, dst);
+				rows[src] |= uint32_t(1) << dst;
+				rows[dst] |= uint32_t(1) << src;
+			}
+		}
+	}
+	return edges;
+}
+
+/* every maximal clique, by trying every subset of the vertices */
+std::vector<std::vector<int> > brute_force(const std::vector<uint32_t> &rows) {
+	std::vector<std::vector<int> > result;
+	for(uint32_t subset = 1; subset < (uint32_t(1) << NUM_VERTICES); subset++) {
+		/* common holds the vertices adjacent to every member */
+		uint32_t common = (uint32_t(1) << NUM_VERTICES) - 1;
+		for(int vertex = 0; vertex < NUM_VERTICES; vertex++) {
+			if(subset & (uint32_t(1) << vertex)) {
+				common &= rows[vertex];
+			}
+		}
+		bool clique = true;
+		for(int vertex = 0; vertex < NUM_VERTICES; vertex++) {
+			if((subset & (uint32_t(1) << vertex)) && (subset & ~(uint32_t(1) << vertex) & ~rows[vertex]) != 0) {
+				clique = false;
+			}
+		}
+		if(clique && (common & ~subset) == 0) {
+			std::vector<int> members;
+			for(int vertex = 0; vertex < NUM_VERTICES; vertex++) {
+				if(subset & (uint32_t(1) << vertex)) {
+					members.push_back(vertex);
+				}
+			}
+			result.push_back(members);
+		}
+	}
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+/* the largest minimum degree seen while peeling off minimum degree vertices */
+size_t degeneracy(std::vector<uint32_t> rows) {
+	size_t result = 0;
+	uint32_t remaining = (uint32_t(1) << NUM_VERTICES) - 1;
+	while(remaining != 0) {
+		int smallest = -1;
+		size_t smallest_degree = 0;
+		for(int vertex = 0; vertex < NUM_VERTICES; vertex++) {
+			size_t degree = 0;
+			for(int other = 0; other < NUM_VERTICES; other++) {
+				degree += (remaining & rows[vertex] & (uint32_t(1) << other)) != 0;
+			}
+			if((remaining & (uint32_t(1) << vertex)) && (smallest == -1 || degree < smallest_degree)) {
+				smallest = vertex;
+				smallest_degree = degree;
+			}
+		}
+		result = std::max(result, smallest_degree);
+		remaining &= ~(uint32_t(1) << smallest);
+	}
+	return result;
+}
+
+size_t count_at_least(const std::vector<std::vector<int> > &cliques, size_t min_size) {
+	size_t total = 0;
+	for(size_t ii = 0; ii < cliques.size(); ii++) {
+		total += cliques[ii].size() >= min_size;
+	}
+	return total;
+}
+
+void test_against_brute_force(unsigned seed) {
+	std::vector<uint32_t> rows;
+	graph<int> edges = random_graph(rows, seed);
+	std::vector<std::vector<int> > expected = brute_force(rows);
+
+	maximal_cliques<int> cliques(edges);
+	CHECK(cliques.degeneracy() == degeneracy(rows));
+	CHECK(cliques.count() == expected.size());
+	CHECK(cliques.count(4) == count_at_least(expected, 4));
+
+	std::vector<std::vector<int> > found;
+	CHECK(cliques.enumerate(found) == expected.size());
+	for(size_t ii = 0; ii < found.size(); ii++) {
+		std::sort(found[ii].begin(), found[ii].end());
+	}
+	std::sort(found.begin(), found.end());
+	CHECK(found == expected);
+}
+
+/* a run continues from a checkpoint of its own and refuses one of another engine */
+void test_checkpoints() {
+	std::vector<uint32_t> rows;
+	graph<int> edges = random_graph(rows, 3);
+	std::vector<std::vector<int> > expected = brute_force(rows);
+	maximal_cliques<int> cliques(edges);
+	compact_graph<int> adjacency(edges);
+
+	std::string filename = "test/maximal_cliques_test.tmp";
+	checkpointer checkpoints(filename, 0.0);
+	CHECK(cliques.count(3, checkpoints) == count_at_least(expected, 3));
+	CHECK(std::fopen(filename.c_str(), "rb") == NULL);
+
+	/* a checkpoint at the end of the ordering leaves nothing to search */
+	uint64_t key = hashing::combine(checkpointer::fingerprint(adjacency), 3);
+	binary_io::buffer &state = checkpoints.state("maximal_cliques count", key);
+	state.value((uint64_t)NUM_VERTICES);
+	state.value((uint64_t)1234);
+	checkpoints.submit();
+	CHECK(cliques.count(3, checkpoints) == 1234);
+	CHECK(std::fopen(filename.c_str(), "rb") == NULL);
+
+	checkpoints.state("neighborhood_function", key);
+	checkpoints.submit();
+	bool refused = false;
+	try {
+		cliques.count(3, checkpoints);
+	}
+	catch(std::runtime_error &) {
+		refused = true;
+	}
+	CHECK(refused);
+	std::remove(filename.c_str());
+
+	std::vector<std::vector<int> > found;
+	CHECK(cliques.enumerate(found, 1, checkpoints) == expected.size());
+}
+
+int main() {
+	for(unsigned seed = 0; seed < 8; seed++) {
+		test_against_brute_force(seed);
+	}
+	test_checkpoints();
+
+	std::cout << "maximal_cliques_test: ok" << std::endl;
+	return 0;
+}
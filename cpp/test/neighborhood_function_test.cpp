@@ -0,0 +1,124 @@
+#include <iostream>
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <cmath>
+#include <cstdio>
+#include <cstddef>
+
+#include "check.hh"
+#include "../graph.hh"
+#include "../compact_graph.hh"
+#include "../neighborhood_function.hh"
+#include "../checkpoint.hh"
+
+const int PATH_LENGTH = 12;
+
+/* a path of PATH_LENGTH vertices and, apart from it, a triangle */
+compact_graph<int> path_and_triangle() {
+	graph<int> edges;
+	for(int vertex = 0; vertex < PATH_LENGTH + 3; vertex++) {
+		edges.insert(vertex);
+	}
+	for(int vertex = 1; vertex < PATH_LENGTH; vertex++) {
+		edges.insert(vertex - 1, vertex);
+	}
+	edges.insert(PATH_LENGTH, PATH_LENGTH + 1);
+	edges.insert(PATH_LENGTH + 1, PATH_LENGTH + 2);
+	edges.insert(PATH_LENGTH, PATH_LENGTH + 2);
+	return compact_graph<int>(edges);
+}
+
+/* hop distance, or -1 between the path and the triangle */
+int distance(int src, int dst) {
+	if((src < PATH_LENGTH) != (dst < PATH_LENGTH)) {
+		return -1;
+	}
+	if(src >= PATH_LENGTH) {
+		return src == dst ? 0 : 1;
+	}
+	return src < dst ? dst - src : src - dst;
+}
+
+bool close(double estimate, double exact) {
+	return std::fabs(estimate - exact) <= 0.1 * exact;
+}
+
+void test_against_exact() {
+	neighborhood_function<int> anf(path_and_triangle(), 10);
+	anf.run();
+	CHECK(anf.done());
+	CHECK(anf.size_steps() == (size_t)(PATH_LENGTH - 1));
+
+	const std::vector<double> &pairs = anf.function();
+	for(size_t t = 0; t < pairs.size(); t++) {
+		size_t exact = 0;
+		for(int src = 0; src < PATH_LENGTH + 3; src++) {
+			for(int dst = 0; dst < PATH_LENGTH + 3; dst++) {
+				exact += distance(src, dst) >= 0 && distance(src, dst) <= (int)t;
+			}
+		}
+		CHECK(close(pairs[t], (double)exact));
+	}
+
+	for(int vertex = 0; vertex < PATH_LENGTH + 3; vertex++) {
+		double exact = 0.0;
+		for(int other = 0; other < PATH_LENGTH + 3; other++) {
+			if(distance(vertex, other) > 0) {
+				exact += 1.0 / distance(vertex, other);
+			}
+		}
+		CHECK(close(anf.harmonic_centrality(vertex), exact));
+	}
+}
+
+/* a run stopped early keeps its checkpoint, and a run from it ends where an uninterrupted one does */
+void test_checkpoints() {
+	compact_graph<int> adjacency = path_and_triangle();
+	neighborhood_function<int> straight(adjacency, 8, 3);
+	straight.run();
+
+	std::string filename = "test/neighborhood_function_test.tmp";
+	checkpointer checkpoints(filename, 0.0);
+	{
+		neighborhood_function<int> first(adjacency, 8, 3);
+		first.run(checkpoints, 4);
+		CHECK(first.size_steps() == 4 && !first.done());
+	}
+	std::FILE *file = std::fopen(filename.c_str(), "rb");
+	CHECK(file != NULL);
+	std::fclose(file);
+
+	neighborhood_function<int> resumed(adjacency, 8, 3);
+	resumed.run(checkpoints);
+	CHECK(resumed.done());
+	CHECK(resumed.function() == straight.function());
+	for(int vertex = 0; vertex < PATH_LENGTH + 3; vertex++) {
+		CHECK(resumed.harmonic_centrality(vertex) == straight.harmonic_centrality(vertex));
+	}
+	CHECK(std::fopen(filename.c_str(), "rb") == NULL);
+
+	/* another seed is another set of counters */
+	neighborhood_function<int> other(adjacency, 8, 4);
+	other.run(checkpoints, 4);
+	neighborhood_function<int> mismatched(adjacency, 8, 3);
+	bool refused = false;
+	try {
+		mismatched.run(checkpoints);
+	}
+	catch(std::runtime_error &) {
+		refused = true;
+	}
+	CHECK(refused);
+	std::remove(filename.c_str());
+}
+
+int main() {
+	test_against_exact();
+	test_checkpoints();
+
+	std::cout << "neighborhood_function_test: ok" << std::endl;
+	return 0;
+}
@@ -0,0 +1,155 @@
+#include <iostream>
+#include <fstream>
+
+#include <string>
+#include <vector>
+#include <random>
+#include <stdexcept>
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include "check.hh"
+#include "../ntriples.hh"
+
+const char *FILENAME = "test/ntriples_test.tmp";
+
+void write_file(const std::string &contents) {
+	std::ofstream output(FILENAME, std::ios_base::out | std::ios_base::binary);
+	output << contents;
+}
+
+/* SCALAR always, the SIMD kernels where the processor has them */
+std::vector<ntriples::kernel> available_kernels() {
+	std::vector<ntriples::kernel> kernels(1, ntriples::SCALAR);
+	ntriples::kernel requested[] = { ntriples::SSE2, ntriples::AVX2 };
+	for(size_t ii = 0; ii < 2; ii++) {
+		try {
+			kernels.push_back(ntriples::resolve(requested[ii]));
+		}
+		catch(std::runtime_error &) {
+		}
+	}
+	return kernels;
+}
+
+/* every term of every triple, and the line each triple was on */
+void tokenize(ntriples::kernel selected, size_t chunk_size, std::vector<std::string> &terms, std::vector<size_t> &lines) {
+	ntriples::reader reader(FILENAME, selected, chunk_size);
+	CHECK(reader.active_kernel() == selected);
+	ntriples::triple triple;
+	while(reader.next(triple)) {
+		terms.push_back(triple.subject.str());
+		terms.push_back(triple.predicate.str());
+		terms.push_back(triple.object.str());
+		lines.push_back(reader.line());
+	}
+	CHECK(reader.position() == reader.size());
+}
+
+void test_terms() {
+	std::string long_iri = "<http://example.org/" + std::string(150, 'x') + ">";
+	std::string input =
+		"# a comment line\n"
+		"<http://a> <http://p> <http://b> .\r\n"
+		"\n"
+		"   \t\n"
+		"<http://a> <http://p> \"say \\\"hi\\\" \\\\ there\" .\n"
+		"<http://a> <http://p> \"bonjour\"@fr-CA .\n"
+		"<http://a> <http://p> \"5\"^^<http://www.w3.org/2001/XMLSchema#integer> .\n"
+		"_:b1 <http://p> _:b2.\n"
+		"_:b1\t<http://p>\t_:b3 . # trailing comment\r\n"
+		+ long_iri + " <http://p> \"\\\\\" .\n"
+		"<http://a> <http://p> <http://c> .";
+
+	const char *expected[] = {
+		"<http://a>", "<http://p>", "<http://b>",
+		"<http://a>", "<http://p>", "\"say \\\"hi\\\" \\\\ there\"",
+		"<http://a>", "<http://p>", "\"bonjour\"@fr-CA",
+		"<http://a>", "<http://p>", "\"5\"^^<http://www.w3.org/2001/XMLSchema#integer>",
+		"_:b1", "<http://p>", "_:b2",
+		"_:b1", "<http://p>", "_:b3",
+		"", "<http://p>", "\"\\\\\"",
+		"<http://a>", "<http://p>", "<http://c>"
+	};
+	size_t expected_lines[] = { 2, 5, 6, 7, 8, 9, 10, 11 };
+	std::vector<std::string> expected_terms(expected, expected + sizeof(expected) / sizeof(expected[0]));
+	expected_terms[18] = long_iri;
+
+	write_file(input);
+	std::vector<ntriples::kernel> kernels = available_kernels();
+	/* a 64-byte chunk makes most statements span a refill, including the long IRI */
+	size_t chunk_sizes[] = { 64, 1 << 20 };
+	for(size_t ii = 0; ii < kernels.size(); ii++) {
+		for(size_t jj = 0; jj < 2; jj++) {
+			std::vector<std::string> terms;
+			std::vector<size_t> lines;
+			tokenize(kernels[ii], chunk_sizes[jj], terms, lines);
+			CHECK(terms == expected_terms);
+			CHECK(lines == std::vector<size_t>(expected_lines, expected_lines + 8));
+		}
+	}
+	std::remove(FILENAME);
+}
+
+/* every kernel sets the same bits on the same bytes */
+void test_kernels_agree() {
+	std::mt19937 random(11);
+	const char alphabet[] = " \t\r\n>\"\\<a.#_:@^";
+	std::vector<ntriples::kernel> kernels = available_kernels();
+	char block[ntriples::BLOCK_SIZE];
+	for(int trial = 0; trial < 1000; trial++) {
+		for(size_t ii = 0; ii < ntriples::BLOCK_SIZE; ii++) {
+			block[ii] = trial % 2 == 0 ? alphabet[random() % (sizeof(alphabet) - 1)] : (char)random();
+		}
+
+		ntriples::block_masks reference;
+		ntriples::classify_scalar(block, reference);
+		for(size_t ii = 1; ii < kernels.size(); ii++) {
+			ntriples::block_masks masks;
+			ntriples::classifier(kernels[ii])(block, masks);
+			CHECK(masks.space == reference.space && masks.newline == reference.newline && masks.close == reference.close && masks.quote == reference.quote && masks.escape == reference.escape);
+		}
+	}
+}
+
+/* the error names the file and the line of the malformed statement */
+void test_errors() {
+	const char *malformed[] = {
+		"<http://a> <http://p> <http://b>\n",
+		"<http://a> <http://p> <http://b\n",
+		"<http://a> <http://p> \"open .\n",
+		"<http://a> <http://p> \"5\"^^xsd:integer .\n",
+		"<http://a> <http://p>\n",
+		"<http://a> <http://p> <http://b> . <http://c>\n"
+	};
+	std::string valid = "# header\n<http://a> <http://p> <http://b> .\n\n";
+	std::vector<ntriples::kernel> kernels = available_kernels();
+	for(size_t ii = 0; ii < sizeof(malformed) / sizeof(malformed[0]); ii++) {
+		write_file(valid + malformed[ii] + valid);
+		for(size_t jj = 0; jj < kernels.size(); jj++) {
+			ntriples::reader reader(FILENAME, kernels[jj], 64);
+			ntriples::triple triple;
+			CHECK(reader.next(triple));
+			std::string message;
+			try {
+				reader.next(triple);
+			}
+			catch(std::runtime_error &e) {
+				message = e.what();
+			}
+			CHECK(message.compare(0, std::strlen(FILENAME) + 4, std::string(FILENAME) + ":4: ") == 0);
+		}
+	}
+	std::remove(FILENAME);
+}
+
+int main() {
+	test_terms();
+	test_kernels_agree();
+	test_errors();
+
+	std::cout << "ntriples_test: ok" << std::endl;
+	return 0;
+}
@@ -0,0 +1,184 @@
+#include <iostream>
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include "check.hh"
+#include "../parallel.hh"
+
+const size_t THREAD_COUNTS[] = { 1, 2, 3, 8 };
+const size_t NUM_COUNTS = sizeof(THREAD_COUNTS) / sizeof(THREAD_COUNTS[0]);
+
+/* floating point sums depend on the order of the additions, so equal results mean equal chunking */
+double value(size_t ii) {
+	return 1.0 / (double)(ii + 1);
+}
+
+void test_reduce_and_scan() {
+	const size_t LENGTH = 100003;
+	std::vector<double> input(LENGTH);
+	for(size_t ii = 0; ii < LENGTH; ii++) {
+		input[ii] = value(ii);
+	}
+
+	uint64_t serial_sum = 0;
+	std::vector<uint64_t> serial_scan(LENGTH);
+	for(size_t ii = 0; ii < LENGTH; ii++) {
+		serial_scan[ii] = serial_sum;
+		serial_sum += ii * ii;
+	}
+
+	std::vector<double> first_scan;
+	double first_sum = 0.0;
+	for(size_t count = 0; count < NUM_COUNTS; count++) {
+		parallel::configure(THREAD_COUNTS[count]);
+		CHECK(parallel::num_threads() == THREAD_COUNTS[count]);
+
+		uint64_t sum = parallel::parallel_reduce(0, LENGTH, 1000, (uint64_t)0, [](size_t ii) {
+			return (uint64_t)(ii * ii);
+		}, [](uint64_t lhs, uint64_t rhs) {
+			return lhs + rhs;
+		});
+		CHECK(sum == serial_sum);
+
+		std::vector<uint64_t> squares(LENGTH);
+		for(size_t ii = 0; ii < LENGTH; ii++) {
+			squares[ii] = ii * ii;
+		}
+		/* in place, which the scan allows */
+		uint64_t total = parallel::parallel_scan(&squares[0], &squares[0], LENGTH, 1000, (uint64_t)0, [](uint64_t lhs, uint64_t rhs) {
+			return lhs + rhs;
+		});
+		CHECK(total == serial_sum && squares == serial_scan);
+
+		double float_sum = parallel::parallel_reduce(0, LENGTH, 777, 0.0, value, [](double lhs, double rhs) {
+			return lhs + rhs;
+		});
+		std::vector<double> float_scan(LENGTH);
+		parallel::parallel_scan(&input[0], &float_scan[0], LENGTH, 777, 0.0, [](double lhs, double rhs) {
+			return lhs + rhs;
+		});
+		if(count == 0) {
+			first_sum = float_sum;
+			first_scan = float_scan;
+		}
+		CHECK(float_sum == first_sum && float_scan == first_scan);
+	}
+
+	CHECK(parallel::parallel_reduce(5, 5, 10, 42, [](size_t ii) { return (int)ii; }, [](int lhs, int rhs) { return lhs + rhs; }) == 42);
+}
+
+void test_exceptions() {
+	parallel::configure(4);
+	for(int round = 0; round < 3; round++) {
+		std::string message;
+		try {
+			parallel::parallel_for(0, 10000, 16, [](size_t ii) {
+				if(ii == 7777) {
+					throw std::runtime_error("iteration 7777");
+				}
+			});
+		}
+		catch(std::runtime_error &e) {
+			message = e.what();
+		}
+		CHECK(message == "iteration 7777");
+	}
+
+	/* a failure inside a nested loop reaches the outermost caller */
+	bool caught = false;
+	try {
+		parallel::parallel_for(0, 8, 1, [](size_t outer) {
+			parallel::parallel_for(0, 100, 1, [outer](size_t inner) {
+				if(outer == 5 && inner == 50) {
+					throw std::length_error("nested");
+				}
+			});
+		});
+	}
+	catch(std::length_error &) {
+		caught = true;
+	}
+	CHECK(caught);
+
+	/* and the runtime still works afterwards */
+	std::atomic<size_t> count(0);
+	parallel::parallel_for(0, 1000, 10, [&](size_t) {
+		count++;
+	});
+	CHECK(count == 1000);
+}
+
+/* workers start loops of their own, as pattern_counter's compact() does from inside weighted_for */
+void test_nested() {
+	parallel::configure(4);
+	const size_t OUTER = 16;
+	const size_t INNER = 5000;
+	std::vector<std::atomic<uint32_t> > hits(OUTER * INNER);
+	for(size_t ii = 0; ii < hits.size(); ii++) {
+		hits[ii] = 0;
+	}
+	parallel::per_thread<size_t> visited(0);
+
+	parallel::parallel_for(0, OUTER, 1, [&](size_t outer) {
+		parallel::parallel_for(0, INNER, 64, [&](size_t inner) {
+			hits[outer * INNER + inner]++;
+			visited.local()++;
+		});
+		visited.local()++;
+	});
+
+	for(size_t ii = 0; ii < hits.size(); ii++) {
+		CHECK(hits[ii] == 1);
+	}
+	size_t total = 0;
+	for(parallel::per_thread<size_t>::const_iterator iter = visited.begin(); iter != visited.end(); ++iter) {
+		total += *iter;
+	}
+	CHECK(total == OUTER * INNER + OUTER);
+}
+
+/* every iteration runs once however the cost is spread */
+void test_weighted() {
+	parallel::configure(4);
+	const size_t LENGTH = 20000;
+	const size_t HEAVY = 1 << 24;
+	for(int shape = 0; shape < 3; shape++) {
+		std::vector<std::atomic<uint32_t> > hits(LENGTH);
+		for(size_t ii = 0; ii < LENGTH; ii++) {
+			hits[ii] = 0;
+		}
+
+		/* cumulative cost before ii: one heavy item first, last, or in the middle, the rest costing 1 */
+		size_t heavy = shape == 0 ? 0 : (shape == 1 ? LENGTH - 1 : LENGTH / 2);
+		parallel::weighted_for(0, LENGTH, 100, [=](size_t ii) {
+			return ii <= heavy ? ii : ii + HEAVY;
+		}, [&](size_t ii) {
+			hits[ii]++;
+		});
+
+		for(size_t ii = 0; ii < LENGTH; ii++) {
+			CHECK(hits[ii] == 1);
+		}
+	}
+}
+
+int main() {
+	/* the default comes from PARALLEL_THREADS when the runtime first starts */
+	setenv("PARALLEL_THREADS", "3", 1);
+	CHECK(parallel::num_threads() == 3);
+
+	test_reduce_and_scan();
+	test_exceptions();
+	test_nested();
+	test_weighted();
+
+	std::cout << "parallel_test: ok" << std::endl;
+	return 0;
+}
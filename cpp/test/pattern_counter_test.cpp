@@ -0,0 +1,145 @@
+#include <iostream>
+
+#include <vector>
+#include <map>
+#include <random>
+
+#include <algorithm>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "check.hh"
+#include "../labeled_graph.hh"
+#include "../pattern_counter.hh"
+
+typedef labeled_graph<int,int> graph_type;
+typedef pattern_counter<int,int> counter_type;
+typedef std::map<std::vector<int>,uint64_t> pattern_map;
+
+const int NUM_VERTICES = 60;
+
+/* three vertex labels, two edge labels, and a few self-loops */
+graph_type random_graph(unsigned seed) {
+	std::mt19937 random(seed);
+	graph_type graph;
+	for(int vertex = 0; vertex < NUM_VERTICES; vertex++) {
+		int label = (int)(random() % 3) * 10;
+		graph.insert(vertex, label);
+	}
+	for(int ii = 0; ii < 150; ii++) {
+		int src = (int)(random() % NUM_VERTICES);
+		int dst = ii % 25 == 0 ? src : (int)(random() % NUM_VERTICES);
+		graph.insert(src, dst, (int)(random() % 2) + 100);
+	}
+	return graph;
+}
+
+/* (end label, edge label, end label) with the smaller end label first */
+std::vector<int> edge_key(int first, int edge, int second) {
+	std::vector<int> key(3);
+	key[0] = std::min(first, second);
+	key[1] = edge;
+	key[2] = std::max(first, second);
+	return key;
+}
+
+/* (center label, first arm, second arm) with the smaller (edge label, end label) arm first */
+std::vector<int> wedge_key(int center, int first_edge, int first, int second_edge, int second) {
+	std::vector<int> key(5);
+	key[0] = center;
+	key[1] = first_edge;
+	key[2] = first;
+	key[3] = second_edge;
+	key[4] = second;
+	if(std::make_pair(second_edge, second) < std::make_pair(first_edge, first)) {
+		std::swap(key[1], key[3]);
+		std::swap(key[2], key[4]);
+	}
+	return key;
+}
+
+void brute_force(const graph_type &graph, pattern_map &edges, pattern_map &wedges) {
+	/* arms[vertex] holds (edge label, other end's label) for every edge but self-loops */
+	std::vector<std::vector<std::pair<int,int> > > arms(NUM_VERTICES);
+	for(graph_type::const_edge_iterator iter = graph.begin_edges(); iter != graph.end_edges(); ++iter) {
+		int src = iter->first.first;
+		int dst = iter->first.second;
+		int src_label = graph.find(src)->second;
+		int dst_label = graph.find(dst)->second;
+		edges[edge_key(src_label, iter->second, dst_label)]++;
+		if(src != dst) {
+			arms[src].push_back(std::make_pair(iter->second, dst_label));
+			arms[dst].push_back(std::make_pair(iter->second, src_label));
+		}
+	}
+
+	for(int center = 0; center < NUM_VERTICES; center++) {
+		int center_label = graph.find(center)->second;
+		for(size_t ii = 0; ii < arms[center].size(); ii++) {
+			for(size_t jj = ii + 1; jj < arms[center].size(); jj++) {
+				wedges[wedge_key(center_label, arms[center][ii].first, arms[center][ii].second, arms[center][jj].first, arms[center][jj].second)]++;
+			}
+		}
+	}
+}
+
+/* counts never increase down the list */
+template <typename T>
+bool ranked(const std::vector<T> &patterns) {
+	for(size_t ii = 1; ii < patterns.size(); ii++) {
+		if(patterns[ii].count > patterns[ii-1].count) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void test_against_brute_force(unsigned seed) {
+	graph_type graph = random_graph(seed);
+	pattern_map expected_edges;
+	pattern_map expected_wedges;
+	brute_force(graph, expected_edges, expected_wedges);
+
+	counter_type counter(graph);
+	CHECK(counter.size_vertices() == (size_t)NUM_VERTICES);
+	CHECK(counter.size_vertex_labels() == 3 && counter.size_edge_labels() == 2);
+
+	std::vector<counter_type::edge_pattern> edges = counter.edge_patterns();
+	CHECK(ranked(edges));
+	pattern_map found_edges;
+	for(size_t ii = 0; ii < edges.size(); ii++) {
+		found_edges[edge_key(edges[ii].first, edges[ii].edge, edges[ii].second)] += edges[ii].count;
+	}
+	CHECK(found_edges == expected_edges);
+
+	std::vector<counter_type::wedge_pattern> wedges = counter.wedge_patterns();
+	CHECK(ranked(wedges));
+	pattern_map found_wedges;
+	for(size_t ii = 0; ii < wedges.size(); ii++) {
+		const counter_type::wedge_pattern &wedge = wedges[ii];
+		found_wedges[wedge_key(wedge.center, wedge.first_edge, wedge.first, wedge.second_edge, wedge.second)] += wedge.count;
+	}
+	CHECK(found_wedges == expected_wedges);
+
+	/* the top of the list and the count threshold select from the same ranking */
+	std::vector<counter_type::wedge_pattern> top = counter.wedge_patterns(1, 3);
+	CHECK(top.size() == 3);
+	for(size_t ii = 0; ii < top.size(); ii++) {
+		CHECK(top[ii].count == wedges[ii].count);
+	}
+	uint64_t threshold = wedges[wedges.size() / 2].count;
+	std::vector<counter_type::wedge_pattern> frequent = counter.wedge_patterns(threshold);
+	for(size_t ii = 0; ii < wedges.size(); ii++) {
+		CHECK((ii < frequent.size()) == (wedges[ii].count >= threshold));
+	}
+}
+
+int main() {
+	for(unsigned seed = 0; seed < 4; seed++) {
+		test_against_brute_force(seed);
+	}
+
+	std::cout << "pattern_counter_test: ok" << std::endl;
+	return 0;
+}
@@ -0,0 +1,68 @@
+#include <iostream>
+
+#include <string>
+#include <stdexcept>
+
+#include <cstdio>
+
+#include "check.hh"
+#include "../graph.hh"
+#include "../compact_graph.hh"
+#include "../property_store.hh"
+
+/* a path 0-1-2-3 and a star around 0: same vertex and arc counts, different graphs */
+void make_graphs(compact_graph<int> &path, compact_graph<int> &star) {
+	graph<int> path_graph;
+	graph<int> star_graph;
+	for(int vertex = 0; vertex < 4; vertex++) {
+		path_graph.insert(vertex);
+		star_graph.insert(vertex);
+	}
+	for(int vertex = 1; vertex < 4; vertex++) {
+		path_graph.insert(vertex - 1, vertex);
+		star_graph.insert(0, vertex);
+	}
+	path = compact_graph<int>(path_graph);
+	star = compact_graph<int>(star_graph);
+}
+
+void test_save_load() {
+	compact_graph<int> path;
+	compact_graph<int> star;
+	make_graphs(path, star);
+	CHECK(path.size_vertices() == star.size_vertices());
+
+	std::string filename = "test/property_store_test.tmp";
+	property_store saved(path);
+	saved.vertices().add_int("weight");
+	for(size_t row = 0; row < path.size_vertices(); row++) {
+		saved.vertices().ints("weight")[row] = (int64_t)row * 10;
+	}
+	saved.save(filename);
+
+	property_store loaded(path);
+	loaded.load(filename);
+	CHECK(loaded.vertices().ints("weight")[3] == 30);
+
+	/* the same shape is not enough: the store belongs to one graph */
+	property_store other(star);
+	other.vertices().add_int("kept");
+	bool refused = false;
+	try {
+		other.load(filename);
+	}
+	catch(std::runtime_error &) {
+		refused = true;
+	}
+	CHECK(refused);
+	CHECK(other.vertices().has("kept") && !other.vertices().has("weight"));
+
+	std::remove(filename.c_str());
+}
+
+int main() {
+	test_save_load();
+
+	std::cout << "property_store_test: ok" << std::endl;
+	return 0;
+}
@@ -0,0 +1,86 @@
+#include <iostream>
+
+#include <vector>
+#include <random>
+
+#include <algorithm>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "check.hh"
+#include "../radix_sort.hh"
+#include "../parallel.hh"
+
+/* enough keys for every thread to get a slice of its own */
+const size_t NUM_KEYS = 300000;
+
+void test_keys(unsigned int key_bits, uint64_t num_distinct) {
+	std::mt19937_64 random(key_bits);
+	uint64_t mask = key_bits == 64 ? ~uint64_t(0) : (uint64_t(1) << key_bits) - 1;
+	std::vector<uint64_t> values;
+	for(uint64_t ii = 0; ii < num_distinct; ii++) {
+		values.push_back(random() & mask);
+	}
+
+	std::vector<uint64_t> keys;
+	for(size_t ii = 0; ii < NUM_KEYS; ii++) {
+		keys.push_back(values[random() % num_distinct]);
+	}
+	std::vector<uint64_t> expected(keys);
+	std::sort(expected.begin(), expected.end());
+
+	std::vector<uint64_t> scratch;
+	radix_sort::sort(keys, scratch, key_bits);
+	CHECK(keys == expected);
+
+	expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+	radix_sort::unique(keys, scratch);
+	CHECK(keys == expected);
+}
+
+struct record {
+	uint64_t key;
+	uint32_t position;
+};
+
+/* records sort on their key alone, and equal keys keep their order */
+void test_records() {
+	std::mt19937_64 random(1);
+	std::vector<record> records(NUM_KEYS);
+	for(size_t ii = 0; ii < NUM_KEYS; ii++) {
+		records[ii].key = random() & ((uint64_t(1) << 33) - 1);
+		records[ii].key &= ~uint64_t(0xfff);
+		records[ii].position = (uint32_t)ii;
+	}
+
+	std::vector<record> scratch;
+	radix_sort::sort(records, scratch, 33, [](const record &value) {
+		return value.key;
+	});
+	CHECK(records.size() == NUM_KEYS);
+	for(size_t ii = 1; ii < NUM_KEYS; ii++) {
+		CHECK(records[ii-1].key < records[ii].key || (records[ii-1].key == records[ii].key && records[ii-1].position < records[ii].position));
+	}
+}
+
+int main() {
+	/* several slices per sort even on a single-core machine */
+	parallel::configure(4);
+
+	/* one, two, four and six 11-bit digit passes */
+	test_keys(11, 100);
+	test_keys(22, 5000);
+	test_keys(40, 100000);
+	test_keys(64, 100000);
+	test_records();
+
+	std::vector<uint64_t> empty;
+	std::vector<uint64_t> scratch;
+	radix_sort::sort(empty, scratch);
+	radix_sort::unique(empty, scratch);
+	CHECK(empty.empty());
+
+	std::cout << "radix_sort_test: ok" << std::endl;
+	return 0;
+}
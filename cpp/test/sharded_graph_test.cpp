@@ -0,0 +1,131 @@
+#include <iostream>
+
+#include <vector>
+#include <random>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "check.hh"
+#include "../graph.hh"
+#include "../compact_graph.hh"
+#include "../transport.hh"
+#include "../sharded_graph.hh"
+
+typedef sharded_graph::index_type index_type;
+
+/* a sparse random graph, so that there are several components and some isolated vertices */
+compact_graph<int> random_graph(unsigned seed) {
+	std::mt19937 random(seed);
+	graph<int> edges;
+	for(int vertex = 0; vertex < 200; vertex++) {
+		edges.insert(vertex);
+	}
+	for(int ii = 0; ii < 220; ii++) {
+		edges.insert((int)(random() % 200), (int)(random() % 200));
+	}
+	return compact_graph<int>(edges);
+}
+
+std::vector<index_type> bfs(const compact_graph<int> &adjacency, size_t source) {
+	std::vector<index_type> distance(adjacency.size_vertices(), (index_type)sharded_graph::UNREACHED);
+	std::vector<size_t> queue(1, source);
+	distance[source] = 0;
+	for(size_t head = 0; head < queue.size(); head++) {
+		compact_graph<int>::const_neighbor_iterator iter = adjacency.begin_neighbors(queue[head]);
+		for(; iter != adjacency.end_neighbors(queue[head]); ++iter) {
+			if(distance[*iter] == sharded_graph::UNREACHED) {
+				distance[*iter] = distance[queue[head]] + 1;
+				queue.push_back(*iter);
+			}
+		}
+	}
+	return distance;
+}
+
+/* each component is named by its smallest vertex */
+std::vector<index_type> components(const compact_graph<int> &adjacency) {
+	std::vector<index_type> label(adjacency.size_vertices(), (index_type)sharded_graph::UNREACHED);
+	for(size_t vertex = 0; vertex < adjacency.size_vertices(); vertex++) {
+		if(label[vertex] == sharded_graph::UNREACHED) {
+			std::vector<index_type> distance = bfs(adjacency, vertex);
+			for(size_t other = 0; other < distance.size(); other++) {
+				if(distance[other] != sharded_graph::UNREACHED) {
+					label[other] = (index_type)vertex;
+				}
+			}
+		}
+	}
+	return label;
+}
+
+std::vector<double> pagerank(const compact_graph<int> &adjacency, double damping) {
+	double num_vertices = (double)adjacency.size_vertices();
+	std::vector<double> rank(adjacency.size_vertices(), 1.0 / num_vertices);
+	for(int iteration = 0; iteration < 500; iteration++) {
+		std::vector<double> sums(rank.size(), 0.0);
+		double dangling = 0.0;
+		for(size_t vertex = 0; vertex < rank.size(); vertex++) {
+			if(adjacency.degree(vertex) == 0) {
+				dangling += rank[vertex];
+			}
+			compact_graph<int>::const_neighbor_iterator iter = adjacency.begin_neighbors(vertex);
+			for(; iter != adjacency.end_neighbors(vertex); ++iter) {
+				sums[*iter] += rank[vertex] / (double)adjacency.degree(vertex);
+			}
+		}
+		for(size_t vertex = 0; vertex < rank.size(); vertex++) {
+			rank[vertex] = (1.0 - damping) / num_vertices + damping * (dangling / num_vertices + sums[vertex]);
+		}
+	}
+	return rank;
+}
+
+void test_partition() {
+	compact_graph<int> adjacency = random_graph(1);
+	graph_partition partition(adjacency, 3);
+	CHECK(partition.size() == 3);
+	CHECK(partition.size_vertices() == adjacency.size_vertices());
+	CHECK(partition.begin(0) == 0 && partition.end(2) == adjacency.size_vertices());
+	for(size_t part = 0; part < partition.size(); part++) {
+		CHECK(part == 0 || partition.begin(part) == partition.end(part - 1));
+		for(size_t vertex = partition.begin(part); vertex < partition.end(part); vertex++) {
+			CHECK(partition.owner(vertex) == part);
+		}
+	}
+}
+
+/* the gathered results of every worker match a computation on the whole graph */
+void test_against_sequential(size_t workers) {
+	compact_graph<int> adjacency = random_graph(2);
+	graph_partition partition(adjacency, workers);
+
+	std::vector<index_type> distance;
+	std::vector<index_type> label;
+	std::vector<double> rank;
+	local_cluster::run(workers, [&](transport &network) {
+		graph_shard shard(adjacency, partition, network.rank());
+		sharded_graph sharded(shard, network);
+		distance = sharded.gather(sharded.bfs(17));
+		label = sharded.gather(sharded.components());
+		rank = sharded.gather(sharded.pagerank(0.85, 500, 1e-12));
+	});
+
+	CHECK(distance == bfs(adjacency, 17));
+	CHECK(label == components(adjacency));
+	std::vector<double> expected = pagerank(adjacency, 0.85);
+	CHECK(rank.size() == expected.size());
+	for(size_t vertex = 0; vertex < expected.size(); vertex++) {
+		CHECK(std::fabs(rank[vertex] - expected[vertex]) < 1e-9);
+	}
+}
+
+int main() {
+	test_partition();
+	test_against_sequential(1);
+	test_against_sequential(3);
+
+	std::cout << "sharded_graph_test: ok" << std::endl;
+	return 0;
+}
@@ -0,0 +1,130 @@
+#include <iostream>
+
+#include <vector>
+#include <random>
+
+#include <algorithm>
+
+#include <cstddef>
+#include <cstdlib>
+
+#include "check.hh"
+#include "../graph.hh"
+#include "../compact_graph.hh"
+#include "../subgraph.hh"
+
+const int SIDE = 8;
+
+/* a SIDE by SIDE grid, so hop distances are Manhattan distances */
+graph<int> grid() {
+	graph<int> edges;
+	for(int vertex = 0; vertex < SIDE * SIDE; vertex++) {
+		edges.insert(vertex);
+	}
+	for(int row = 0; row < SIDE; row++) {
+		for(int column = 0; column < SIDE; column++) {
+			int vertex = row * SIDE + column;
+			if(column + 1 < SIDE) {
+				edges.insert(vertex, vertex + 1);
+			}
+			if(row + 1 < SIDE) {
+				edges.insert(vertex, vertex + SIDE);
+			}
+		}
+	}
+	return edges;
+}
+
+int hops(int src, int dst) {
+	return std::abs(src / SIDE - dst / SIDE) + std::abs(src % SIDE - dst % SIDE);
+}
+
+/* result has exactly the given vertices and the source's edges between them */
+void check_induced(const compact_graph<int> &source, const std::vector<int> &members, const compact_graph<int> &result) {
+	CHECK(std::vector<int>(result.begin_vertices(), result.end_vertices()) == members);
+	size_t num_edges = 0;
+	for(size_t src = 0; src < result.size_vertices(); src++) {
+		for(size_t dst = 0; dst < result.size_vertices(); dst++) {
+			bool expected = source.has_edge(source.index(members[src]), source.index(members[dst]));
+			CHECK(result.has_edge(src, dst) == expected);
+			num_edges += expected;
+		}
+	}
+	CHECK(result.size_edges() == num_edges / 2);
+}
+
+void test_induced() {
+	compact_graph<int> source(grid());
+	subgraph_extractor<int> extractor(source);
+	std::mt19937 random(5);
+
+	std::vector<int> chosen;
+	for(int ii = 0; ii < 40; ii++) {
+		chosen.push_back((int)(random() % (SIDE * SIDE)));
+	}
+	compact_graph<int> result;
+	extractor.induced(chosen, result);
+
+	/* the same graph held in dense storage gives the same subgraph */
+	graph<int> edges = grid();
+	graph<int, dense_storage<int> > dense;
+	for(graph<int>::const_vertex_iterator iter = edges.begin_vertices(); iter != edges.end_vertices(); ++iter) {
+		dense.insert(*iter);
+	}
+	for(graph<int>::const_edge_iterator iter = edges.begin_edges(); iter != edges.end_edges(); ++iter) {
+		dense.insert(*iter);
+	}
+	subgraph_extractor<int> from_dense(dense);
+	compact_graph<int> dense_result;
+	from_dense.induced(chosen, dense_result);
+
+	std::sort(chosen.begin(), chosen.end());
+	chosen.erase(std::unique(chosen.begin(), chosen.end()), chosen.end());
+	check_induced(source, chosen, result);
+	check_induced(source, chosen, dense_result);
+}
+
+void test_ego_networks() {
+	graph<int> edges = grid();
+	compact_graph<int> source(edges);
+	subgraph_extractor<int> extractor(edges);
+
+	std::vector<int> seeds;
+	seeds.push_back(0);
+	seeds.push_back(27);
+	seeds.push_back(SIDE * SIDE - 1);
+	for(int radius = 0; radius < 4; radius++) {
+		std::vector<compact_graph<int> > batch;
+		extractor.ego_networks(seeds, radius, batch);
+		CHECK(batch.size() == seeds.size());
+
+		std::vector<int> either;
+		for(size_t ii = 0; ii < seeds.size(); ii++) {
+			std::vector<int> members;
+			for(int vertex = 0; vertex < SIDE * SIDE; vertex++) {
+				if(hops(seeds[ii], vertex) <= radius) {
+					members.push_back(vertex);
+				}
+			}
+			compact_graph<int> result;
+			extractor.ego_network(seeds[ii], radius, result);
+			check_induced(source, members, result);
+			check_induced(source, members, batch[ii]);
+			either.insert(either.end(), members.begin(), members.end());
+		}
+
+		std::sort(either.begin(), either.end());
+		either.erase(std::unique(either.begin(), either.end()), either.end());
+		compact_graph<int> result;
+		extractor.ego_network(seeds, radius, result);
+		check_induced(source, either, result);
+	}
+}
+
+int main() {
+	test_induced();
+	test_ego_networks();
+
+	std::cout << "subgraph_test: ok" << std::endl;
+	return 0;
+}
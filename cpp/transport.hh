@@ -0,0 +1,457 @@
+#ifndef _TRANSPORT_HH_
+#define _TRANSPORT_HH_
+
+#include <iostream>
+#include <sstream>
+
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#include <algorithm>
+
+#include <stdexcept>
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+
+/*
+ * Message layer between the workers of a sharded computation. Workers
+ * are numbered 0..size()-1 and talk in bulk-synchronous rounds: every
+ * worker calls exchange() with one message for every worker, itself
+ * included, and gets back the message every worker addressed to it.
+ * Reductions are built on exchange(), so a transport only has to move
+ * bytes; socket_transport does it over Unix sockets between processes
+ * on one machine, and a network transport can take its place without
+ * changes to the algorithms.
+ */
+class transport {
+	public:
+		typedef size_t size_type;
+		typedef std::vector<char> message;
+
+		virtual ~transport() {
+
+		}
+
+		/*
+		 * Capacity
+		 */
+		virtual size_type rank() const = 0;
+
+		virtual size_type size() const = 0;
+
+		/*
+		 * Operations
+		 */
+
+		/* sends outgoing[peer] to every peer, leaving outgoing empty */
+		virtual void exchange(std::vector<message> &outgoing, std::vector<message> &incoming) = 0;
+
+		/* exchange() for arrays of trivially copyable records */
+		template <typename T>
+		void exchange_records(std::vector<std::vector<T> > &outgoing, std::vector<std::vector<T> > &incoming) {
+			static_assert(std::is_trivially_copyable<T>::value, "transport sends trivially copyable types only");
+
+			std::vector<message> raw_outgoing(size());
+			std::vector<message> raw_incoming;
+			for(size_type peer = 0; peer < size(); peer++) {
+				const char *data = reinterpret_cast<const char *>(outgoing[peer].data());
+				raw_outgoing[peer].assign(data, data + outgoing[peer].size() * sizeof(T));
+				std::vector<T>().swap(outgoing[peer]);
+			}
+
+			exchange(raw_outgoing, raw_incoming);
+
+			incoming.resize(size());
+			for(size_type peer = 0; peer < size(); peer++) {
+				if(raw_incoming[peer].size() % sizeof(T) != 0) {
+					std::ostringstream oss;
+					oss << "message from worker " << peer << " is not a whole number of records";
+
+					throw std::runtime_error(oss.str());
+				}
+				incoming[peer].resize(raw_incoming[peer].size() / sizeof(T));
+				if(!raw_incoming[peer].empty()) {
+					std::memcpy(&incoming[peer][0], &raw_incoming[peer][0], raw_incoming[peer].size());
+				}
+			}
+		}
+
+		/* sum over all workers, added in rank order so every worker gets the same value */
+		template <typename T>
+		T sum(const T &value) {
+			std::vector<std::vector<T> > outgoing(size(), std::vector<T>(1, value));
+			std::vector<std::vector<T> > incoming;
+			exchange_records(outgoing, incoming);
+
+			T total = T();
+			for(size_type peer = 0; peer < size(); peer++) {
+				total += incoming[peer].at(0);
+			}
+			return total;
+		}
+
+		/* waits until every worker has reached this point */
+		void barrier() {
+			sum((uint64_t)0);
+		}
+};
+
+/*
+ * Transport over one connected stream socket per pair of workers. An
+ * exchange writes and reads all sockets at once under poll(), so large
+ * messages in both directions cannot fill the socket buffers and
+ * deadlock. A peer that closes its end, e.g. because it failed, makes
+ * the exchange throw rather than wait forever.
+ */
+class socket_transport : public transport {
+	public:
+		/* sockets[peer] is connected to peer and sockets[rank] is unused; takes ownership */
+		socket_transport(size_type rank, const std::vector<int> &sockets) : my_rank(rank), sockets(sockets) {
+			for(size_type peer = 0; peer < sockets.size(); peer++) {
+				if(peer != my_rank && fcntl(sockets[peer], F_SETFL, fcntl(sockets[peer], F_GETFL) | O_NONBLOCK) == -1) {
+					fail("cannot configure socket");
+				}
+			}
+		}
+
+		~socket_transport() {
+			for(size_type peer = 0; peer < sockets.size(); peer++) {
+				if(peer != my_rank) {
+					close(sockets[peer]);
+				}
+			}
+		}
+
+		socket_transport(const socket_transport &other) = delete;
+		socket_transport & operator=(const socket_transport &other) = delete;
+
+		/*
+		 * Capacity
+		 */
+		size_type rank() const {
+			return my_rank;
+		}
+
+		size_type size() const {
+			return sockets.size();
+		}
+
+		/*
+		 * Operations
+		 */
+		void exchange(std::vector<message> &outgoing, std::vector<message> &incoming) {
+			size_type num_peers = sockets.size();
+			incoming.assign(num_peers, message());
+			incoming[my_rank].swap(outgoing[my_rank]);
+
+			/* each message goes out as a 64-bit length followed by its bytes */
+			std::vector<uint64_t> send_header(num_peers);
+			std::vector<uint64_t> receive_header(num_peers, 0);
+			std::vector<size_type> sent(num_peers, 0);
+			std::vector<size_type> received(num_peers, 0);
+			size_type pending = 0;
+			for(size_type peer = 0; peer < num_peers; peer++) {
+				send_header[peer] = outgoing[peer].size();
+				if(peer != my_rank) {
+					pending += 2;
+				}
+			}
+
+			std::vector<pollfd> polled;
+			std::vector<size_type> polled_peers;
+			while(pending != 0) {
+				polled.clear();
+				polled_peers.clear();
+				for(size_type peer = 0; peer < num_peers; peer++) {
+					if(peer == my_rank) {
+						continue;
+					}
+					short events = 0;
+					if(sent[peer] < sizeof(uint64_t) + outgoing[peer].size()) {
+						events |= POLLOUT;
+					}
+					if(received[peer] < sizeof(uint64_t) || received[peer] != sizeof(uint64_t) + receive_header[peer]) {
+						events |= POLLIN;
+					}
+					if(events != 0) {
+						pollfd entry;
+						entry.fd = sockets[peer];
+						entry.events = events;
+						entry.revents = 0;
+						polled.push_back(entry);
+						polled_peers.push_back(peer);
+					}
+				}
+
+				if(poll(&polled[0], polled.size(), -1) == -1) {
+					if(errno == EINTR) {
+						continue;
+					}
+					fail("poll failed");
+				}
+
+				for(size_type ii = 0; ii < polled.size(); ii++) {
+					size_type peer = polled_peers[ii];
+					if(polled[ii].revents == 0) {
+						continue;
+					}
+					if((polled[ii].events & POLLOUT) != 0 && send_some(peer, send_header[peer], outgoing[peer], sent[peer])) {
+						pending--;
+					}
+					if((polled[ii].events & POLLIN) != 0 && receive_some(peer, receive_header[peer], incoming[peer], received[peer])) {
+						pending--;
+					}
+				}
+			}
+
+			for(size_type peer = 0; peer < num_peers; peer++) {
+				message().swap(outgoing[peer]);
+			}
+		}
+
+	protected:
+		size_type my_rank;
+		std::vector<int> sockets;
+
+		/* true once the whole message has gone out */
+		bool send_some(size_type peer, const uint64_t &header, const message &data, size_type &sent) {
+			size_type total = sizeof(uint64_t) + data.size();
+			while(sent < total) {
+				const char *source;
+				size_type length;
+				if(sent < sizeof(uint64_t)) {
+					source = reinterpret_cast<const char *>(&header) + sent;
+					length = sizeof(uint64_t) - sent;
+				}
+				else {
+					source = &data[sent - sizeof(uint64_t)];
+					length = total - sent;
+				}
+
+				ssize_t count = send(sockets[peer], source, length, MSG_NOSIGNAL);
+				if(count == -1) {
+					if(errno == EAGAIN || errno == EWOULDBLOCK) {
+						return false;
+					}
+					if(errno == EINTR) {
+						continue;
+					}
+					fail(peer, "cannot send to");
+				}
+				sent += (size_type)count;
+			}
+			return true;
+		}
+
+		/* true once the whole message has arrived */
+		bool receive_some(size_type peer, uint64_t &header, message &data, size_type &received) {
+			for(;;) {
+				char *target;
+				size_type length;
+				if(received < sizeof(uint64_t)) {
+					target = reinterpret_cast<char *>(&header) + received;
+					length = sizeof(uint64_t) - received;
+				}
+				else {
+					if(received == sizeof(uint64_t)) {
+						data.resize((size_t)header);
+					}
+					if(received == sizeof(uint64_t) + data.size()) {
+						return true;
+					}
+					target = &data[received - sizeof(uint64_t)];
+					length = sizeof(uint64_t) + data.size() - received;
+				}
+
+				ssize_t count = recv(sockets[peer], target, length, 0);
+				if(count == 0) {
+					errno = 0;
+					fail(peer, "connection closed by");
+				}
+				if(count == -1) {
+					if(errno == EAGAIN || errno == EWOULDBLOCK) {
+						return false;
+					}
+					if(errno == EINTR) {
+						continue;
+					}
+					fail(peer, "cannot receive from");
+				}
+				received += (size_type)count;
+			}
+		}
+
+		void fail(const char *message) const {
+			std::ostringstream oss;
+			oss << message << ": " << std::strerror(errno);
+
+			throw std::runtime_error(oss.str());
+		}
+
+		void fail(size_type peer, const char *message) const {
+			int error = errno;
+			std::ostringstream oss;
+			oss << message << " worker " << peer;
+			if(error != 0) {
+				oss << ": " << std::strerror(error);
+			}
+
+			throw std::runtime_error(oss.str());
+		}
+};
+
+/*
+ * Runs a computation on workers processes of this machine, connected by
+ * socket_transport. Worker 0 is the calling process; the others are
+ * forked from it and so start with a copy of its memory, which is how
+ * they usually get the graph or the name of their shard file. body is
+ * called with each worker's transport. A worker that throws prints the
+ * error and exits, which makes the other workers fail too; run()
+ * rethrows worker 0's exception or reports the first failed worker.
+ *
+ * Forked workers must not use the parallel runtime: its threads belong
+ * to the calling process. Each worker is one process and one thread.
+ */
+class local_cluster {
+	public:
+		typedef size_t size_type;
+
+		template <typename Body>
+		static void run(size_type workers, Body body) {
+			if(workers == 0) {
+				throw std::domain_error("a cluster needs at least one worker");
+			}
+
+			/* ends[worker][peer] is worker's end of the socket to peer */
+			std::vector<std::vector<int> > ends(workers, std::vector<int>(workers, -1));
+			for(size_type worker = 0; worker < workers; worker++) {
+				for(size_type peer = worker + 1; peer < workers; peer++) {
+					int pair[2];
+					if(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == -1) {
+						std::ostringstream oss;
+						oss << "cannot create sockets: " << std::strerror(errno);
+
+						close_all(ends, workers);
+						throw std::runtime_error(oss.str());
+					}
+					ends[worker][peer] = pair[0];
+					ends[peer][worker] = pair[1];
+				}
+			}
+
+			/* buffered output would otherwise be written once per process */
+			std::cout.flush();
+			std::cerr.flush();
+			std::fflush(NULL);
+
+			std::vector<pid_t> children;
+			for(size_type worker = 1; worker < workers; worker++) {
+				pid_t child = fork();
+				if(child == -1) {
+					std::ostringstream oss;
+					oss << "cannot start worker " << worker << ": " << std::strerror(errno);
+
+					close_all(ends, workers);
+					wait_all(children);
+					throw std::runtime_error(oss.str());
+				}
+				if(child == 0) {
+					close_all(ends, worker);
+					_exit(work(worker, ends[worker], body));
+				}
+				children.push_back(child);
+			}
+			close_all(ends, 0);
+
+			try {
+				socket_transport network(0, ends[0]);
+				body(static_cast<transport &>(network));
+			}
+			catch(...) {
+				wait_all(children);
+				throw;
+			}
+
+			size_type failed = wait_all(children);
+			if(failed != 0) {
+				std::ostringstream oss;
+				oss << "worker " << failed << " failed";
+
+				throw std::runtime_error(oss.str());
+			}
+		}
+
+	protected:
+		/* the exit status of a forked worker */
+		template <typename Body>
+		static int work(size_type worker, const std::vector<int> &sockets, Body &body) {
+			int status = 0;
+			try {
+				socket_transport network(worker, sockets);
+				body(static_cast<transport &>(network));
+			}
+			catch(std::exception &e) {
+				report(worker, e.what());
+				status = 1;
+			}
+			catch(...) {
+				report(worker, "unknown error");
+				status = 1;
+			}
+			std::cout.flush();
+			std::cerr.flush();
+			std::fflush(NULL);
+			return status;
+		}
+
+		/* in one write, so that lines from different workers do not interleave */
+		static void report(size_type worker, const char *message) {
+			std::ostringstream oss;
+			oss << "worker " << worker << ": " << message << std::endl;
+			std::cerr << oss.str();
+		}
+
+		/* closes every socket end except those of keep */
+		static void close_all(std::vector<std::vector<int> > &ends, size_type keep) {
+			for(size_type worker = 0; worker < ends.size(); worker++) {
+				if(worker == keep) {
+					continue;
+				}
+				for(size_type peer = 0; peer < ends[worker].size(); peer++) {
+					if(ends[worker][peer] != -1) {
+						close(ends[worker][peer]);
+						ends[worker][peer] = -1;
+					}
+				}
+			}
+		}
+
+		/* the rank of the first worker that failed, or 0 */
+		static size_type wait_all(const std::vector<pid_t> &children) {
+			size_type failed = 0;
+			for(size_type ii = 0; ii < children.size(); ii++) {
+				int status = 0;
+				while(waitpid(children[ii], &status, 0) == -1 && errno == EINTR) {
+
+				}
+				if(failed == 0 && (!WIFEXITED(status) || WEXITSTATUS(status) != 0)) {
+					failed = ii + 1;
+				}
+			}
+			return failed;
+		}
+};
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef _TRIANGLE_SAMPLER_HH_
+#define _TRIANGLE_SAMPLER_HH_
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include <sstream>
+
+#include <algorithm>
+#include <random>
+
+#include <stdexcept>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "hashing.hh"
+
+/*
+ * Streaming triangle count estimate with a fixed-size edge reservoir
+ * (TRIEST-IMPR, De Stefani et al., 2016). Every arriving edge first adds
+ * the triangles it closes with the sample, each weighted by the inverse
+ * of the probability that the sample still holds both other edges, and
+ * is then offered to the reservoir. While the stream fits in the
+ * reservoir the count is exact.
+ *
+ * The stream is taken to be a simple graph: self-loops are ignored and
+ * an edge that is already in the sample is dropped, but a repeat of an
+ * edge that has since been evicted counts again.
+ */
+class triangle_sampler {
+	public:
+		typedef size_t size_type;
+		typedef uint64_t vertex_type;
+
+		/* at a hundred-odd bytes an edge, 2^28 edges take about 32GB */
+		static const size_type MAX_CAPACITY = (size_type)1 << 28;
+
+		explicit triangle_sampler(size_type capacity=1 << 20, uint64_t seed=1) : capacity(capacity), seen(0), triangles(0.0), variance(0.0), generator(seed) {
+			if(capacity < 2 || capacity > MAX_CAPACITY) {
+				std::ostringstream oss;
+				oss << "triangle sampler needs room for 2 to " << MAX_CAPACITY << " edges";
+
+				throw std::domain_error(oss.str());
+			}
+			sample.reserve(capacity);
+			members.reserve(capacity);
+			adjacency.reserve(capacity);
+		}
+
+		/*
+		 * Capacity
+		 */
+
+		/* edges offered so far, not counting the dropped ones */
+		size_type size_stream() const {
+			return seen;
+		}
+
+		size_type size_sample() const {
+			return sample.size();
+		}
+
+		size_type max_sample() const {
+			return capacity;
+		}
+
+		bool exact() const {
+			return seen <= capacity;
+		}
+
+		/*
+		 * Modifiers
+		 */
+		void insert(vertex_type src, vertex_type dst) {
+			if(src == dst) {
+				return;
+			}
+			if(dst < src) {
+				std::swap(src, dst);
+			}
+
+			edge current(src, dst);
+			if(members.count(current) != 0) {
+				return;
+			}
+
+			seen++;
+			count(src, dst);
+
+			if(sample.size() < capacity) {
+				add(current);
+			}
+			else if(std::uniform_int_distribution<size_type>(0, seen - 1)(generator) < capacity) {
+				size_type victim = std::uniform_int_distribution<size_type>(0, capacity - 1)(generator);
+				remove(sample[victim]);
+				sample[victim] = current;
+				link(current);
+			}
+		}
+
+		/*
+		 * Operations
+		 */
+		double estimate() const {
+			return triangles;
+		}
+
+		/*
+		 * Horvitz-Thompson standard error of the estimate. It leaves out
+		 * the covariance between triangles that share an edge, so on
+		 * graphs with many such triangles it is optimistic.
+		 */
+		double standard_error() const {
+			return std::sqrt(variance);
+		}
+
+	protected:
+		typedef std::pair<vertex_type,vertex_type> edge;
+
+		struct edge_hash {
+			size_t operator()(const edge &value) const {
+				return (size_t)hashing::combine(hashing::mix(value.first), value.second);
+			}
+		};
+
+		size_type capacity;
+		size_type seen;
+		double triangles;
+		double variance;
+		std::mt19937_64 generator;
+
+		std::vector<edge> sample;
+		std::unordered_set<edge,edge_hash> members;
+		std::unordered_map<vertex_type,std::vector<vertex_type> > adjacency;
+
+		bool contains(vertex_type src, vertex_type dst) const {
+			if(dst < src) {
+				std::swap(src, dst);
+			}
+			return members.count(edge(src, dst)) != 0;
+		}
+
+		/* triangles closed by src-dst with two sampled edges */
+		void count(vertex_type src, vertex_type dst) {
+			std::unordered_map<vertex_type,std::vector<vertex_type> >::const_iterator src_iter = adjacency.find(src);
+			std::unordered_map<vertex_type,std::vector<vertex_type> >::const_iterator dst_iter = adjacency.find(dst);
+			if(src_iter == adjacency.end() || dst_iter == adjacency.end()) {
+				return;
+			}
+			if(src_iter->second.size() > dst_iter->second.size()) {
+				std::swap(src_iter, dst_iter);
+			}
+
+			double previous = (double)(seen - 1);
+			double weight = std::max(1.0, previous * (previous - 1.0) / ((double)capacity * (double)(capacity - 1)));
+
+			std::vector<vertex_type>::const_iterator iter = src_iter->second.begin();
+			for(; iter != src_iter->second.end(); ++iter) {
+				if(contains(dst_iter->first, *iter)) {
+					triangles += weight;
+					variance += weight * (weight - 1.0);
+				}
+			}
+		}
+
+		void add(const edge &value) {
+			sample.push_back(value);
+			link(value);
+		}
+
+		void link(const edge &value) {
+			members.insert(value);
+			adjacency[value.first].push_back(value.second);
+			adjacency[value.second].push_back(value.first);
+		}
+
+		void unlink(vertex_type vertex, vertex_type neighbor) {
+			std::unordered_map<vertex_type,std::vector<vertex_type> >::iterator iter = adjacency.find(vertex);
+			std::vector<vertex_type> &neighbors = iter->second;
+			*std::find(neighbors.begin(), neighbors.end(), neighbor) = neighbors.back();
+			neighbors.pop_back();
+			if(neighbors.empty()) {
+				adjacency.erase(iter);
+			}
+		}
+
+		void remove(const edge &value) {
+			members.erase(value);
+			unlink(value.first, value.second);
+			unlink(value.second, value.first);
+		}
+};
+
+#endif